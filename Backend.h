@@ -0,0 +1,210 @@
+#ifndef _INCLUDE_BLOCKERPASSES_BACKEND_H_
+#define _INCLUDE_BLOCKERPASSES_BACKEND_H_
+
+// Everything the plugin asks of the server, behind one interface: entity
+// lifetime and fields, state-change notification, timers, ray traces,
+// players and access, chat and menus, and the game filesystem. The plugin
+// core (Core.h) runs on UtilsBackend (BlockerPasses.cpp) on a server and on
+// MockBackend (tools/MockBackend.h) in the offline tools. No SDK types cross
+// it: entities are opaque handles and vectors are BpVec.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include "Layout.h"
+
+// Behaves like a CHandle: once the entity is removed it stays dead and never
+// aliases a newer one.
+typedef void* BpEnt;
+
+// Spawn key values, converted to CEntityKeyValues by the production backend.
+struct BpSpawnKV
+{
+    enum Kind : uint8_t
+    {
+        KV_STRING,
+        KV_INT,
+        KV_FLOAT
+    };
+
+    struct Entry
+    {
+        std::string key;
+        Kind kind;
+        std::string s;
+        int i;
+        float f;
+    };
+
+    std::vector<Entry> entries;
+
+    void SetString(const char* key, const char* value)
+    {
+        entries.push_back({ key, KV_STRING, value, 0, 0.0f });
+    }
+    void SetInt(const char* key, int value)
+    {
+        entries.push_back({ key, KV_INT, "", value, 0.0f });
+    }
+    void SetFloat(const char* key, float value)
+    {
+        entries.push_back({ key, KV_FLOAT, "", 0, value });
+    }
+    bool empty() const
+    {
+        return entries.empty();
+    }
+};
+
+// Networked fields the plugin writes, one token each. The backend stores
+// the value; the core's dirty set (Core.cpp) decides when StateChanged goes
+// out for it.
+enum NetToken
+{
+    NF_EFFECTS = 0,
+    NF_BODY_COMPONENT,          // scene node scale
+    NF_CLR_RENDER,
+    NF_RENDER_MODE,
+    NF_BEAM_END_POS,
+    NF_BEAM_WIDTH,
+    NF_SOLID_TYPE,
+    NF_SURROUND_TYPE,
+    NF_MINS,
+    NF_MAXS,
+    NF_SURROUNDING_MINS,
+    NF_SURROUNDING_MAXS,
+    NF_COLLISION_ATTRIBUTE,     // collision group of the attribute
+    NF_COLLISION_GROUP,
+    NF_OTHER,
+    NF_COUNT
+};
+
+// Field values that stand for engine enums and flags; the production
+// backend maps them to the SDK's. Surround type and collision groups are
+// the engine's own numbers.
+static const int BP_EF_NODRAW = 1;      // NF_EFFECTS: the one effect flag the plugin reads or writes
+static const int BP_RENDER_NONE = 0;    // NF_RENDER_MODE
+
+enum BpSolid
+{
+    BP_SOLID_NONE = 0,
+    BP_SOLID_OBB
+};
+
+struct BpFieldValue
+{
+    int i = 0;
+    float f = 0.0f;
+    BpVec v;
+    uint8_t r = 255;        // NF_CLR_RENDER
+    uint8_t g = 255;
+    uint8_t b = 255;
+    uint8_t a = 255;
+
+    BpFieldValue() {}
+    BpFieldValue(int vi) : i(vi) {}
+    BpFieldValue(float vf) : f(vf) {}
+    BpFieldValue(const BpVec& vv) : v(vv) {}
+
+    static BpFieldValue Rgba(int cr, int cg, int cb, int ca)
+    {
+        BpFieldValue fv;
+        fv.r = (uint8_t)cr;
+        fv.g = (uint8_t)cg;
+        fv.b = (uint8_t)cb;
+        fv.a = (uint8_t)ca;
+        return fv;
+    }
+};
+
+// Same arguments as the Menus API callback: the item's key, its text, its
+// position and the player.
+typedef std::function<void(const char* back, const char* front, int item, int slot)> BpMenuCallback;
+
+struct BpMenu
+{
+    struct Item
+    {
+        std::string key;
+        std::string text;
+        bool enabled;
+    };
+
+    std::string name;       // the menu in traces and replays
+    std::string title;
+    std::vector<Item> items;
+    bool back = false;
+    bool exit = false;
+    BpMenuCallback callback;
+
+    void Add(const char* key, const char* text, bool enabled = true)
+    {
+        items.push_back({ key, text, enabled });
+    }
+};
+
+class IBpBackend
+{
+public:
+    virtual ~IBpBackend() {}
+
+    virtual BpEnt CreateEntity(const char* cls) = 0;
+    // 'kv' may be null for a spawn without key values.
+    virtual void Spawn(BpEnt ent, const BpSpawnKV* kv) = 0;
+    virtual void Teleport(BpEnt ent, const BpVec* pos, const BpVec* ang) = 0;
+    virtual void SetModel(BpEnt ent, const char* model) = 0;
+    virtual void Remove(BpEnt ent) = 0;
+    virtual bool Alive(BpEnt ent) = 0;
+    virtual void StateChanged(BpEnt ent, const char* cls, const char* field) = 0;
+    // False, writing nothing, when the entity has no such field (not a
+    // model entity, no scene node yet).
+    virtual bool SetField(BpEnt ent, NetToken field, const BpFieldValue& value) = 0;
+    virtual bool GetField(BpEnt ent, NetToken field, BpFieldValue& out) = 0;
+    // CBaseModelEntity::SetCollisionBounds, found by signature; false from
+    // HasCollisionBounds while it is unresolved.
+    virtual bool HasCollisionBounds() = 0;
+    virtual void SetCollisionBounds(BpEnt ent, const BpVec& mins, const BpVec& maxs) = 0;
+    // Every entity whose targetname starts with 'prefix'.
+    virtual void FindByName(const char* prefix, const std::function<void(BpEnt ent, const char* name)>& fn) = 0;
+
+    virtual void NextFrame(std::function<void()> fn) = 0;
+    // Same contract as IUtilsApi::CreateTimer: the callback returns the delay
+    // to the next call, negative to stop.
+    virtual void CreateTimer(float delay, std::function<float()> fn) = 0;
+    virtual double Time() = 0;
+
+    // World point under the player's crosshair and the eye the trace starts
+    // from; false if the slot has no pawn.
+    virtual bool RayTrace(int slot, BpVec& eye, BpVec& hit) = 0;
+    virtual bool IsConnected(int slot) = 0;
+    virtual bool IsInGame(int slot) = 0;
+    virtual bool IsFakeClient(int slot) = 0;
+    virtual int Team(int slot) = 0;
+    virtual uint64_t SteamID(int slot) = 0;
+    // Admin API checks; false when the Admin plugin is missing.
+    virtual bool HasPermission(int slot, const char* permission) = 0;
+    virtual bool HasFlag(int slot, const char* flag) = 0;
+    // Moves the player's pawn; false if it is missing or dead.
+    virtual bool TeleportPlayer(int slot, const BpVec& pos, const BpVec& ang) = 0;
+
+    // Chat text may carry the Utils colour tags ({RED}, {DEFAULT}, ...).
+    virtual void PrintToChat(int slot, const char* msg) = 0;
+    virtual void PrintToChatAll(const char* msg) = 0;
+    virtual void ShowMenu(int slot, const BpMenu& menu) = 0;
+    virtual void CloseMenu(int slot) = 0;
+
+    // Null or garbage while the server is between maps.
+    virtual const char* MapName() = 0;
+    virtual int TickCount() = 0;
+    virtual const char* Language() = 0;
+
+    // Game filesystem, paths relative to the game directory. FileSize is 0
+    // for a missing file.
+    virtual size_t FileSize(const char* path) = 0;
+    virtual bool ReadFile(const char* path, std::string& out) = 0;
+    virtual bool WriteFile(const char* path, const std::string& data) = 0;
+    virtual void RemoveFile(const char* path) = 0;
+};
+
+#endif //_INCLUDE_BLOCKERPASSES_BACKEND_H_
@@ -25,6 +25,7 @@ public:
 	bool Load(PluginId id, ISmmAPI* ismm, char* error, size_t maxlen, bool late);
 	bool Unload(char* error, size_t maxlen);
 	void AllPluginsLoaded();
+	void Hook_GameFrame(bool simulating, bool bFirstTick, bool bLastTick);
 private:
 	const char* GetAuthor();
 	const char* GetName();
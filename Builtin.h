@@ -0,0 +1,125 @@
+#ifndef _INCLUDE_BLOCKERPASSES_BUILTIN_H_
+#define _INCLUDE_BLOCKERPASSES_BUILTIN_H_
+
+// Built-in layouts: curated layouts for official maps (layouts/*.ini)
+// compiled into constant tables at build time by tools/bp_embed.py, which
+// reads them the way LoadDataForMap reads bp_data.ini. A server without a
+// data file, or without a section for the map, still gets its blockers,
+// with no file read and no parsing. The data file wins per map: the first
+// save of a built-in layout writes its section, which overrides the table
+// from then on.
+//
+// The plugin build defines BP_BUILTIN_LAYOUTS and puts the generated
+// BuiltinLayouts.gen.h on the include path; without it (the offline tools)
+// there are no built-in maps. No SDK types: items are filled through
+// .x/.y/.z like the rest of Layout.h.
+
+#include <stdint.h>
+#include <string.h>
+#include "Layout.h"
+
+enum BpBuiltinFlags
+{
+    BP_BUILTIN_WALL = 1 << 0,
+    BP_BUILTIN_INVISIBLE = 1 << 1,
+    BP_BUILTIN_RAINBOW = 1 << 2
+};
+
+// One BpItem, already read and checked; the fields BpReadItem fills.
+struct BpBuiltinItem
+{
+    const char* label;
+    const char* path;
+    float pos[3];
+    float ang[3];
+    float pos2[3];
+    float scale;
+    float wallYaw;
+    float polyHeight;
+    float polyThick;
+    int beam[3];
+    int color[3];
+    int minPlayers;
+    uint32_t layers;
+    uint32_t flags;
+    int firstPoint;     // polyline path: points[firstPoint * 3 ...] of the map
+    int numPoints;
+    const char* prefab;
+};
+
+struct BpBuiltinMap
+{
+    const char* name;   // normalized map name
+    int budget;
+    const char* const* layers;
+    int numLayers;
+    const BpBuiltinItem* items;
+    int numItems;
+    const float* points;
+};
+
+#ifdef BP_BUILTIN_LAYOUTS
+#include "BuiltinLayouts.gen.h"
+#else
+static constexpr const BpBuiltinMap* BP_BUILTIN_MAPS = nullptr;
+static constexpr int BP_BUILTIN_MAP_COUNT = 0;
+#endif
+
+// The generator sorts the maps by name (strcmp order).
+inline const BpBuiltinMap* BpFindBuiltin(const char* map)
+{
+    int lo = 0, hi = BP_BUILTIN_MAP_COUNT;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        int c = strcmp(BP_BUILTIN_MAPS[mid].name, map);
+        if (c == 0)
+        {
+            return &BP_BUILTIN_MAPS[mid];
+        }
+        if (c < 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return nullptr;
+}
+
+template <class V, class A>
+inline void BpBuiltinItemTo(const BpBuiltinMap& m, const BpBuiltinItem& b, BpItemT<V, A>& it)
+{
+    it.label = b.label;
+    it.path = b.path;
+    it.pos = V(b.pos[0], b.pos[1], b.pos[2]);
+    it.ang = A(b.ang[0], b.ang[1], b.ang[2]);
+    it.pos2 = V(b.pos2[0], b.pos2[1], b.pos2[2]);
+    it.scale = b.scale;
+    it.invisible = (b.flags & BP_BUILTIN_INVISIBLE) != 0;
+    it.isWall = (b.flags & BP_BUILTIN_WALL) != 0;
+    it.beamR = b.beam[0];
+    it.beamG = b.beam[1];
+    it.beamB = b.beam[2];
+    it.beamRainbow = (b.flags & BP_BUILTIN_RAINBOW) != 0;
+    it.wallYaw = b.wallYaw;
+    it.itemR = b.color[0];
+    it.itemG = b.color[1];
+    it.itemB = b.color[2];
+    it.minPlayers = b.minPlayers;
+    it.layers = b.layers;
+    it.prefab = b.prefab;
+    it.points.clear();
+    for (int k = 0; k < b.numPoints; ++k)
+    {
+        const float* p = m.points + (b.firstPoint + k) * 3;
+        it.points.push_back(V(p[0], p[1], p[2]));
+    }
+    it.polyHeight = b.polyHeight;
+    it.polyThick = b.polyThick;
+    BpPolyRefit(it);
+}
+
+#endif //_INCLUDE_BLOCKERPASSES_BUILTIN_H_
@@ -0,0 +1,4934 @@
+// Definitions for Core.h. What only this file uses -- the scheduler, the
+// entity registry, the round plan, the menus -- stays file-static here.
+
+#include "Core.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+#include <unordered_set>
+#include <unordered_map>
+#include <initializer_list>
+#include "Phrases.h"
+#include "Spatial.h"
+#include "WallBatch.h"
+#include "Prefab.h"
+#include "Builtin.h"
+
+BpConsoleFn g_ConsoleOut = nullptr;
+
+std::string g_BaseDir = ".";
+
+void ConPrint(BpColor color, const char* fmt, ...)
+{
+    if (!g_ConsoleOut)
+    {
+        return;
+    }
+    char buf[2048];
+    va_list va;
+    va_start(va, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, va);
+    va_end(va);
+    g_ConsoleOut(color, buf);
+}
+
+IBpBackend* g_Backend = nullptr;
+
+typedef BpPrefabT<BpVec, BpVec> Prefab;
+
+std::vector<ModelDef> g_ModelDefs;
+std::vector<BPItem>   g_Items;
+std::vector<LiveEnt>  g_Live;
+
+static std::vector<Prefab> g_Prefabs;
+static std::vector<BPItem> g_Instances;   // prefab instances of this map; BPItem::group indexes it
+static std::vector<int>    g_LiveSlot;    // item -> position in g_Live, -1 when it has none
+
+std::string g_CurrentMap;
+
+enum PingMode
+{
+    PING_NONE = 0,
+    PING_TELEPORT = 1,
+    PING_WALL_POS1 = 2,
+    PING_WALL_POS2 = 3,
+    PING_POLY = 4
+};
+
+static PingMode g_ePingMode[64];
+static int      g_iPingTargetIndex[64];
+static BpVec   g_vWallTempPos[64];
+static std::vector<BpVec> g_PolyPoints[64];
+
+int g_MinPlayersToOpen = 10;
+bool g_bIgnoreSpectators = true;
+std::string g_ChatCommand = "!bp";
+std::string g_ConCmdBp = "mm_bp";
+std::string g_ConCmdAccess = "mm_bp_access";
+std::string g_ConCmdProfile = "mm_bp_profile";
+
+static bool g_DebugLog = true;
+static bool g_bIdleMode = true;
+static bool g_bIdle = false;
+static std::string g_AccessPermission = "@admin/bp";
+static std::string g_AccessFlag = "";
+
+static float g_flRainbowHue = 0.0f;
+static bool  g_bRainbowTimerActive = false;
+
+int g_ItemsRevision = 0;
+
+static int              g_LivePlayerCount = 0;
+static int              g_ThresholdRevision = -1;
+static std::vector<int> g_ThresholdOrder;
+static BpItemIndex      g_PickIndex;
+
+struct LayerDiff
+{
+    std::vector<int> spawn;
+    std::vector<int> remove;
+};
+
+std::vector<std::string> g_LayerNames;
+int                      g_ActiveLayer = 0;
+int                      g_nPendingSolid = 0;
+
+static std::vector<LayerDiff> g_LayerDiffs;
+static int                    g_LayerDiffRevision = -1;
+static std::string            g_ProfileSetting = "default";
+static bool                   g_bProfileForced = false;
+static double                 g_flRoundStartTime = 0.0;
+static bool                   g_bMeasureSolid = false;
+
+std::set<uint64_t> g_TempAccessSteamIDs;
+
+static std::map<std::string, std::string> g_Phrases;
+
+static inline const char* Phrase(const char* key, const char* def = "")
+{
+    auto it = g_Phrases.find(key);
+    return (it != g_Phrases.end() && !it->second.empty()) ? it->second.c_str() : def;
+}
+
+// Chat phrases are formats filled with the fallback's arguments; a
+// translation whose conversions differ would read the wrong varargs, so it
+// is ignored in favour of the fallback.
+static inline const char* PhraseFormat(const char* key, const char* fallbackFmt)
+{
+    const char* fmt = Phrase(key, fallbackFmt);
+    return fmt == fallbackFmt || BpFormatCompatible(fmt, fallbackFmt) ? fmt : fallbackFmt;
+}
+
+// Files are read whole before parsing; anything over the BpKvLimits cap is
+// refused before it is read.
+static bool KvFileTooBig(const char* path)
+{
+    size_t size = g_Backend ? g_Backend->FileSize(path) : 0;
+    if (size <= BpKvLimits().maxBytes)
+    {
+        return false;
+    }
+    ConPrint(CON_ERROR, "[BlockerPasses] %s is %zu bytes, over the %zu byte limit; not loaded\n", path, size,
+        BpKvLimits().maxBytes);
+    return true;
+}
+
+// False when the file is missing, too big or does not parse to the end; in
+// the last case 'kv' still holds what parsed before the error.
+bool KvLoadFile(BpKv* kv, const char* path)
+{
+    std::string data;
+    if (!g_Backend || KvFileTooBig(path) || !g_Backend->ReadFile(path, data))
+    {
+        return false;
+    }
+    // Some editors save the configs with a UTF-8 BOM.
+    size_t skip = (data.size() >= 3 && !memcmp(data.data(), "\xEF\xBB\xBF", 3)) ? 3 : 0;
+    std::string error;
+    if (!kv->LoadFromBuffer(data.data() + skip, data.size() - skip, &error))
+    {
+        ConPrint(CON_ERROR, "[BlockerPasses] %s: %s\n", path, error.c_str());
+        return false;
+    }
+    return true;
+}
+
+void KvSaveFile(const BpKv* kv, const char* path)
+{
+    std::string out;
+    kv->SaveToString(out);
+    if (!g_Backend->WriteFile(path, out))
+    {
+        ConPrint(CON_ERROR, "[BlockerPasses] Cannot write %s\n", path);
+    }
+}
+
+void LoadPhrases()
+{
+    g_Phrases.clear();
+    BpKv kv("Phrases");
+    if (!KvLoadFile(&kv, "addons/translations/blockerpasses.phrases.txt"))
+    {
+        return;
+    }
+
+    const char* lang = g_Backend->Language();
+    for (BpKv* p = kv.GetFirstTrueSubKey(); p; p = p->GetNextTrueSubKey())
+    {
+        g_Phrases[p->GetName()] = p->GetString(lang);
+    }
+}
+
+static inline void PrintChatRaw(int slot, const char* fmt, va_list va)
+{
+    if (!g_Backend)
+    {
+        return;
+    }
+    char buf[1024];
+    vsnprintf(buf, sizeof(buf), fmt, va);
+
+    const char* tag = Phrase("Chat_Prefix", "");
+    if (*tag)
+    {
+        std::string out = " " + std::string(tag) + " " + std::string(buf);
+        g_Backend->PrintToChat(slot, out.c_str());
+    }
+    else
+    {
+        g_Backend->PrintToChat(slot, buf);
+    }
+}
+
+static inline void PrintChat(int slot, const char* fmt, ...)
+{
+    va_list va;
+    va_start(va, fmt);
+    PrintChatRaw(slot, fmt, va);
+    va_end(va);
+}
+
+static inline void PrintChatKey(int slot, const char* key, const char* fallbackFmt, ...)
+{
+    const char* fmt = PhraseFormat(key, fallbackFmt);
+    va_list va;
+    va_start(va, fallbackFmt);
+    PrintChatRaw(slot, fmt, va);
+    va_end(va);
+}
+
+static inline void PrintChatAllKey(const char* key, const char* fallbackFmt, ...)
+{
+    if (!g_Backend)
+    {
+        return;
+    }
+    const char* fmt = PhraseFormat(key, fallbackFmt);
+    char msg[1024];
+    va_list va;
+    va_start(va, fallbackFmt);
+    vsnprintf(msg, sizeof(msg), fmt, va);
+    va_end(va);
+
+    const char* tag = Phrase("Chat_Prefix", "");
+    if (*tag)
+    {
+        std::string out = " " + std::string(tag) + " " + std::string(msg);
+        g_Backend->PrintToChatAll(out.c_str());
+    }
+    else
+    {
+        g_Backend->PrintToChatAll(msg);
+    }
+}
+
+static bool IsValidMapName(const char* name)
+{
+    if (!name || !*name)
+        return false;
+    for (const char* p = name; *p; ++p)
+    {
+        unsigned char c = (unsigned char)*p;
+        if (c < 0x20 || c > 0x7E)
+            return false;
+    }
+    return true;
+}
+
+static inline void TeleportEnt(BpEnt ent, const BpVec* pos, const BpVec* ang)
+{
+    g_Backend->Teleport(ent, pos, ang);
+}
+
+static inline BpVec CrosshairPos(int slot)
+{
+    BpVec eye, hit;
+    g_Backend->RayTrace(slot, eye, hit);
+    return hit;
+}
+
+static inline int HumansOnline()
+{
+    int c = 0;
+    for (int i = 0; i < 64; ++i)
+    {
+        if (!g_Backend->IsInGame(i) || g_Backend->IsFakeClient(i))
+        {
+            continue;
+        }
+        if (g_bIgnoreSpectators && g_Backend->Team(i) <= 1)
+        {
+            continue;
+        }
+        ++c;
+    }
+    return c;
+}
+
+static inline int HumansConnected()
+{
+    int c = 0;
+    for (int i = 0; i < 64; ++i)
+    {
+        if (g_Backend->IsConnected(i) && !g_Backend->IsFakeClient(i))
+        {
+            ++c;
+        }
+    }
+    return c;
+}
+
+static inline int ItemThreshold(const BPItem& it)
+{
+    return BpThreshold(it, g_MinPlayersToOpen);
+}
+
+static void RebuildThresholdOrder()
+{
+    if (g_ThresholdRevision == g_ItemsRevision && g_ThresholdOrder.size() == g_Items.size())
+    {
+        return;
+    }
+    BpSortByThreshold(g_Items, g_MinPlayersToOpen, g_ThresholdOrder);
+    g_ThresholdRevision = g_ItemsRevision;
+}
+
+static inline size_t FirstAboveThreshold(int players)
+{
+    return BpFirstAbove(g_ThresholdOrder, g_Items, g_MinPlayersToOpen, players);
+}
+
+static inline bool ItemInProfile(const BPItem& it)
+{
+    return (it.layers & (1u << g_ActiveLayer)) != 0;
+}
+
+static inline bool ItemShouldBeOpen(int index)
+{
+    return !ItemInProfile(g_Items[index]) || g_LivePlayerCount >= ItemThreshold(g_Items[index]);
+}
+
+static int FindLayer(const char* name)
+{
+    for (int i = 0; i < (int)g_LayerNames.size(); ++i)
+    {
+        if (!BpStricmp(g_LayerNames[i].c_str(), name))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void RebuildLayerDiffs()
+{
+    int n = (int)g_LayerNames.size();
+    if (g_LayerDiffRevision == g_ItemsRevision && (int)g_LayerDiffs.size() == n * n)
+    {
+        return;
+    }
+    g_LayerDiffs.assign(n * n, LayerDiff());
+    for (int from = 0; from < n; ++from)
+    {
+        for (int to = 0; to < n; ++to)
+        {
+            if (from == to)
+            {
+                continue;
+            }
+            LayerDiff& d = g_LayerDiffs[from * n + to];
+            uint32_t fromBit = 1u << from;
+            uint32_t toBit = 1u << to;
+            for (int i = 0; i < (int)g_Items.size(); ++i)
+            {
+                bool inFrom = (g_Items[i].layers & fromBit) != 0;
+                bool inTo = (g_Items[i].layers & toBit) != 0;
+                if (inFrom && !inTo)
+                {
+                    d.remove.push_back(i);
+                }
+                else if (!inFrom && inTo)
+                {
+                    d.spawn.push_back(i);
+                }
+            }
+        }
+    }
+    g_LayerDiffRevision = g_ItemsRevision;
+}
+
+
+LogRecord             g_LogRing[LOG_RING_SIZE];
+std::atomic<uint32_t> g_LogHead(0);
+std::atomic<uint32_t> g_LogTail(0);
+std::atomic<uint64_t> g_LogDropped(0);
+int                   g_LogLevel = LVL_DEBUG;
+uint32_t              g_LogCatMask = 0xFFFFFFFFu;
+bool                  g_bLogToFile = false;
+
+static std::atomic<bool> g_bLogRun(false);
+static std::thread       g_LogThread;
+
+static void LogFormat(const LogRecord& r, std::string& out)
+{
+    int arg = 0;
+    char spec[32];
+    char tmp[256];
+    for (const char* p = r.fmt; *p; ++p)
+    {
+        if (*p != '%')
+        {
+            out += *p;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            out += '%';
+            ++p;
+            continue;
+        }
+        const char* start = p++;
+        while (*p && strchr("-+ #0123456789.", *p))
+        {
+            ++p;
+        }
+        const char* lenEnd = p;
+        while (*lenEnd && strchr("hlLzjt", *lenEnd))
+        {
+            ++lenEnd;
+        }
+        char conv = *lenEnd;
+        if (!conv || arg >= r.nargs || (size_t)(p - start) + 4 >= sizeof(spec))
+        {
+            out.append(start, lenEnd - start + (conv ? 1 : 0));
+            p = conv ? lenEnd : lenEnd - 1;
+            continue;
+        }
+        size_t base = (size_t)(p - start);
+        memcpy(spec, start, base);
+        int k = r.kinds[arg];
+        if (strchr("diouxXc", conv))
+        {
+            spec[base] = 'l';
+            spec[base + 1] = 'l';
+            spec[base + 2] = conv == 'c' ? 'd' : conv;
+            spec[base + 3] = 0;
+            if (conv == 'c')
+            {
+                tmp[0] = (char)r.vals[arg].i;
+                tmp[1] = 0;
+            }
+            else if (k == LARG_DBL)
+            {
+                snprintf(tmp, sizeof(tmp), spec, (long long)r.vals[arg].d);
+            }
+            else
+            {
+                snprintf(tmp, sizeof(tmp), spec, r.vals[arg].i);
+            }
+        }
+        else if (strchr("fFeEgGaA", conv))
+        {
+            spec[base] = conv;
+            spec[base + 1] = 0;
+            double d = k == LARG_DBL ? r.vals[arg].d : (k == LARG_UINT ? (double)r.vals[arg].u : (double)r.vals[arg].i);
+            snprintf(tmp, sizeof(tmp), spec, d);
+        }
+        else if (conv == 's')
+        {
+            spec[base] = 's';
+            spec[base + 1] = 0;
+            snprintf(tmp, sizeof(tmp), spec, k == LARG_STR ? r.strbuf + r.vals[arg].str : "?");
+        }
+        else if (conv == 'p')
+        {
+            snprintf(tmp, sizeof(tmp), "%p", r.vals[arg].p);
+        }
+        else
+        {
+            tmp[0] = 0;
+        }
+        out += tmp;
+        ++arg;
+        p = lenEnd;
+    }
+}
+
+static void LogWorker(std::string filePath)
+{
+    FILE* fp = nullptr;
+    uint64_t reportedDrops = 0;
+    std::string line;
+    while (true)
+    {
+        bool running = g_bLogRun.load(std::memory_order_acquire);
+        uint32_t tail = g_LogTail.load(std::memory_order_relaxed);
+        uint32_t head = g_LogHead.load(std::memory_order_acquire);
+        if (tail == head)
+        {
+            if (!running)
+            {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+        while (tail != head)
+        {
+            const LogRecord& r = g_LogRing[tail & (LOG_RING_SIZE - 1)];
+            line.clear();
+            LogFormat(r, line);
+            if (!filePath.empty())
+            {
+                if (!fp)
+                {
+                    fp = fopen(filePath.c_str(), "a");
+                }
+                if (fp)
+                {
+                    fprintf(fp, "%.3f [%s/%s] %s\n", r.time, g_LogLevelNames[r.level], g_LogCategoryNames[r.cat], line.c_str());
+                }
+            }
+            else
+            {
+                ConPrint(r.level <= LVL_WARN ? CON_WARN : CON_INFO, "[BlockerPasses] %s\n", line.c_str());
+            }
+            ++tail;
+            g_LogTail.store(tail, std::memory_order_release);
+        }
+        uint64_t drops = g_LogDropped.load(std::memory_order_relaxed);
+        if (drops != reportedDrops)
+        {
+            ConPrint(CON_WARN, "[BlockerPasses] Log ring full, %llu records dropped\n", (unsigned long long)(drops - reportedDrops));
+            reportedDrops = drops;
+        }
+        if (fp)
+        {
+            fflush(fp);
+        }
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+}
+
+void Log_Stop()
+{
+    g_bLogRun.store(false, std::memory_order_release);
+    if (g_LogThread.joinable())
+    {
+        g_LogThread.join();
+    }
+}
+
+void Log_Start()
+{
+    Log_Stop();
+    std::string path;
+    if (g_bLogToFile)
+    {
+        path = g_BaseDir + "/addons/logs/blockerpasses.log";
+    }
+    g_bLogRun.store(true, std::memory_order_release);
+    g_LogThread = std::thread(LogWorker, path);
+}
+
+bool Log_ParseLevel(const char* s, int& out)
+{
+    for (int i = 0; i <= LVL_TRACE; ++i)
+    {
+        if (!BpStricmp(s, g_LogLevelNames[i]))
+        {
+            out = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t Log_ParseCategories(const char* s)
+{
+    if (!s || !*s || !BpStricmp(s, "all"))
+    {
+        return 0xFFFFFFFFu;
+    }
+    uint32_t mask = 0;
+    char buf[128];
+    BpStrncpy(buf, s, sizeof(buf));
+    for (char* tok = strtok(buf, ","); tok; tok = strtok(nullptr, ","))
+    {
+        for (int i = 0; i < LOGC_COUNT; ++i)
+        {
+            if (!BpStricmp(tok, g_LogCategoryNames[i]))
+            {
+                mask |= 1u << i;
+            }
+        }
+    }
+    return mask;
+}
+
+
+static const char* g_PhaseNames[PH_COUNT] = {
+    "round_start", "clear_live", "apply_plan", "spawn_one", "spawn_wall_collisions",
+    "draw_wireframe", "save_data", "load_data", "rainbow_tick"
+};
+
+static const char* g_CounterNames[CNT_COUNT] = {
+    "entities_created", "entities_destroyed", "state_changed", "tasks_scheduled", "state_coalesced"
+};
+
+static const int HIST_BUCKETS = 24;
+
+struct PhaseHist
+{
+    uint64_t buckets[HIST_BUCKETS] = {};
+    uint64_t count = 0;
+    double sum = 0.0;
+    double max = 0.0;
+};
+
+uint64_t g_Counters[CNT_COUNT];
+bool     g_bReloadHandoff = false;
+int      g_MapBudget = -1;      // bp_data.ini per-map override, -1 = use settings
+bool     g_bLateLoad = false;
+
+static PhaseHist g_PhaseHist[PH_COUNT];
+static bool      g_bStatsDump = false;
+static int       g_EntityBudget = 0;    // settings.ini, 0 = unlimited
+
+static inline void Stats_Record(Phase ph, double sec)
+{
+    PhaseHist& h = g_PhaseHist[ph];
+    double us = sec * 1000000.0;
+    int b = 0;
+    while (b < HIST_BUCKETS - 1 && us >= (double)(2ull << b))
+    {
+        ++b;
+    }
+    ++h.buckets[b];
+    ++h.count;
+    h.sum += sec;
+    if (sec > h.max)
+    {
+        h.max = sec;
+    }
+}
+
+static inline void Stats_Count(Counter c, uint64_t n = 1)
+{
+    g_Counters[c] += n;
+}
+
+static double Stats_Percentile(const PhaseHist& h, double p)
+{
+    if (!h.count)
+    {
+        return 0.0;
+    }
+    uint64_t want = (uint64_t)ceil(p * (double)h.count);
+    uint64_t acc = 0;
+    for (int b = 0; b < HIST_BUCKETS; ++b)
+    {
+        acc += h.buckets[b];
+        if (acc >= want)
+        {
+            return fmin((double)(2ull << b) / 1000000.0, h.max);
+        }
+    }
+    return h.max;
+}
+
+struct TraceSpan
+{
+    const char* name;
+    char ph;
+    int tick;
+    double start;
+    double end;
+    uint32_t created;
+    uint32_t destroyed;
+    uint32_t stateChanged;
+};
+
+static const size_t TRACE_MAX_SPANS = 200000;
+
+std::thread g_TraceWriter;
+int         g_TraceRoundsLeft = 0;
+
+static std::vector<TraceSpan> g_TraceSpans;
+static bool                   g_bTracing = false;
+static uint64_t               g_TraceDropped = 0;
+
+static inline void Trace_Push(const char* name, char ph, double t0, double t1, const uint64_t* c0)
+{
+    if (g_TraceSpans.size() >= TRACE_MAX_SPANS)
+    {
+        ++g_TraceDropped;
+        return;
+    }
+    TraceSpan sp;
+    sp.name = name;
+    sp.ph = ph;
+    sp.tick = g_Backend ? g_Backend->TickCount() : 0;
+    sp.start = t0;
+    sp.end = t1;
+    sp.created = c0 ? (uint32_t)(g_Counters[CNT_ENT_CREATED] - c0[CNT_ENT_CREATED]) : 0;
+    sp.destroyed = c0 ? (uint32_t)(g_Counters[CNT_ENT_DESTROYED] - c0[CNT_ENT_DESTROYED]) : 0;
+    sp.stateChanged = c0 ? (uint32_t)(g_Counters[CNT_STATE_CHANGED] - c0[CNT_STATE_CHANGED]) : 0;
+    g_TraceSpans.push_back(sp);
+}
+
+static inline void Trace_Instant(const char* name)
+{
+    if (g_bTracing)
+    {
+        double now = BpClock();
+        Trace_Push(name, 'i', now, now, nullptr);
+    }
+}
+
+static void Trace_Write(std::vector<TraceSpan> spans, std::string path, uint64_t dropped)
+{
+    FILE* fp = fopen(path.c_str(), "w");
+    if (!fp)
+    {
+        return;
+    }
+    double base = spans.empty() ? 0.0 : spans[0].start;
+    for (const TraceSpan& sp : spans)
+    {
+        base = fmin(base, sp.start);
+    }
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%llu},\"traceEvents\":[\n", (unsigned long long)dropped);
+    for (size_t i = 0; i < spans.size(); ++i)
+    {
+        const TraceSpan& sp = spans[i];
+        double ts = (sp.start - base) * 1000000.0;
+        if (sp.ph == 'i')
+        {
+            fprintf(fp, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"args\":{\"tick\":%d}}%s\n",
+                sp.name, ts, sp.tick, i + 1 < spans.size() ? "," : "");
+        }
+        else
+        {
+            fprintf(fp, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+                "\"args\":{\"tick\":%d,\"created\":%u,\"destroyed\":%u,\"state_changed\":%u}}%s\n",
+                sp.name, ts, (sp.end - sp.start) * 1000000.0, sp.tick, sp.created, sp.destroyed, sp.stateChanged,
+                i + 1 < spans.size() ? "," : "");
+        }
+    }
+    fprintf(fp, "]}\n");
+    fclose(fp);
+}
+
+void Trace_Flush()
+{
+    g_bTracing = false;
+    if (g_TraceSpans.empty())
+    {
+        return;
+    }
+    char path[512];
+    snprintf(path, sizeof(path), "%s/addons/data/bp_trace_%lld.json", g_BaseDir.c_str(), (long long)time(nullptr));
+    if (g_TraceWriter.joinable())
+    {
+        g_TraceWriter.join();
+    }
+    ConPrint(CON_OK, "[BlockerPasses] Trace: %d spans (%llu dropped) -> %s\n",
+        (int)g_TraceSpans.size(), (unsigned long long)g_TraceDropped, path);
+    g_TraceWriter = std::thread(Trace_Write, std::move(g_TraceSpans), std::string(path), g_TraceDropped);
+    g_TraceSpans = std::vector<TraceSpan>();
+    g_TraceDropped = 0;
+}
+
+static void Trace_OnRoundStart()
+{
+    if (!g_TraceRoundsLeft)
+    {
+        if (g_bTracing)
+        {
+            Trace_Flush();
+        }
+        return;
+    }
+    --g_TraceRoundsLeft;
+    if (!g_bTracing)
+    {
+        g_bTracing = true;
+        g_TraceSpans.reserve(TRACE_MAX_SPANS / 4);
+    }
+}
+
+static const uint64_t REC_MAX_BYTES = 256ull << 20;
+
+BpRecWriter g_Rec;
+
+static BpRecBackend        g_RecBackend(g_Rec);
+static std::vector<BPItem> g_RecItems;         // item list as last written to the trace
+static std::string         g_RecMap;
+static bool                g_bRecLayout = false;   // a full layout has been written
+static int                 g_RecPlayer[64][2]; // flags, team as last written; -1 = not yet
+static int                 g_RecConfig[4];
+
+// Player state the next handler will read, queried past the recording
+// backend so the trace does not fill up with its own sampling.
+static void Rec_SyncPlayers(double now)
+{
+    IBpBackend* be = g_RecBackend.Inner();
+    for (int i = 0; i < 64; ++i)
+    {
+        int flags = (be->IsConnected(i) ? RPF_CONNECTED : 0) | (be->IsInGame(i) ? RPF_IN_GAME : 0) | (be->IsFakeClient(i) ? RPF_FAKE : 0);
+        int team = flags ? be->Team(i) : 0;
+        if (flags == g_RecPlayer[i][0] && team == g_RecPlayer[i][1])
+        {
+            continue;
+        }
+        g_RecPlayer[i][0] = flags;
+        g_RecPlayer[i][1] = team;
+        g_Rec.Begin(REC_PLAYER, now);
+        g_Rec.PutU(i);
+        g_Rec.PutU(flags);
+        g_Rec.PutS(team);
+        g_Rec.End();
+    }
+}
+
+// Layout and settings as the last handler left them: a full layout after a
+// map change, item diffs otherwise.
+static void Rec_SyncState(double now)
+{
+    int config[4] = { g_MinPlayersToOpen, g_MapBudget >= 0 ? g_MapBudget : g_EntityBudget, g_ActiveLayer, g_bIgnoreSpectators ? 1 : 0 };
+    if (memcmp(config, g_RecConfig, sizeof(config)))
+    {
+        memcpy(g_RecConfig, config, sizeof(config));
+        g_Rec.Begin(REC_CONFIG, now);
+        for (int v : config)
+        {
+            g_Rec.PutS(v);
+        }
+        g_Rec.End();
+    }
+    if (!g_bRecLayout || g_RecMap != g_CurrentMap)
+    {
+        g_bRecLayout = true;
+        g_RecMap = g_CurrentMap;
+        g_RecItems = g_Items;
+        g_Rec.Begin(REC_LAYOUT, now);
+        g_Rec.PutStr(g_CurrentMap.c_str());
+        g_Rec.PutU(g_Items.size());
+        for (const BPItem& it : g_Items)
+        {
+            g_Rec.PutItem(it);
+        }
+        g_Rec.End();
+        return;
+    }
+    g_Rec.SyncItems(now, g_Items, g_RecItems);
+}
+
+// One recorded entry point, written on construction with the payload its
+// type carries (see Record.h); the destructor adds whatever layout change the
+// handler made and the time it took.
+struct RecEntry
+{
+    bool on;
+    double t0;
+    RecEntry(BpRecType type, int slot = -1, const char* s1 = nullptr, const char* s2 = nullptr, int a = 0, const BpVec* v = nullptr)
+        : on(Rec_On()), t0(0.0)
+    {
+        if (!on)
+        {
+            return;
+        }
+        t0 = g_Backend->Time();
+        Rec_SyncPlayers(t0);
+        g_Rec.Begin(type, t0);
+        switch (type)
+        {
+            case REC_MAP_START:
+                g_Rec.PutStr(s1);
+                break;
+            case REC_PLAYER_PING:
+                g_Rec.PutU(slot);
+                g_Rec.PutVec(v ? *v : BpVec(0, 0, 0));
+                break;
+            case REC_PLAYER_EVENT:
+                g_Rec.PutU(slot);
+                g_Rec.PutU(a);
+                break;
+            case REC_MENU:
+                g_Rec.PutU(slot);
+                g_Rec.PutStr(s1);
+                g_Rec.PutStr(s2);
+                g_Rec.PutS(a);
+                break;
+            case REC_COMMAND:
+                g_Rec.PutS(slot);
+                g_Rec.PutStr(s1);
+                break;
+            default:
+                break;
+        }
+        g_Rec.End();
+    }
+    ~RecEntry()
+    {
+        if (!on || !Rec_On())
+        {
+            return;
+        }
+        double t1 = g_Backend->Time();
+        Rec_SyncState(t1);
+        g_Rec.Begin(REC_DONE, t1);
+        g_Rec.PutU((uint64_t)((t1 - t0) * 1000000.0 + 0.5));
+        g_Rec.End();
+    }
+};
+
+void Rec_Start()
+{
+    if (Rec_On() || !g_Backend)
+    {
+        return;
+    }
+    char path[512];
+    snprintf(path, sizeof(path), "%s/addons/data/bp_rec_%lld.bprec", g_BaseDir.c_str(), (long long)time(nullptr));
+    double now = g_Backend->Time();
+    if (!g_Rec.Open(path, now, REC_MAX_BYTES))
+    {
+        ConPrint(CON_ERROR, "[BlockerPasses] Record: cannot open %s\n", path);
+        return;
+    }
+    g_RecBackend.Attach(g_Backend);
+    g_Backend = &g_RecBackend;
+    g_bRecLayout = false;
+    memset(g_RecPlayer, 0xFF, sizeof(g_RecPlayer));
+    memset(g_RecConfig, 0xFF, sizeof(g_RecConfig));
+    Rec_SyncPlayers(now);
+    Rec_SyncState(now);
+    ConPrint(CON_OK, "[BlockerPasses] Recording to %s\n", path);
+}
+
+void Rec_Stop()
+{
+    if (!Rec_On())
+    {
+        return;
+    }
+    g_Backend = g_RecBackend.Inner();
+    uint64_t records = g_Rec.Records();
+    uint64_t dropped = g_Rec.Dropped();
+    uint64_t bytes = g_Rec.Bytes();
+    g_Rec.Close();
+    ConPrint(CON_OK, "[BlockerPasses] Recording stopped: %llu records, %llu bytes, %llu dropped\n",
+        (unsigned long long)records, (unsigned long long)bytes, (unsigned long long)dropped);
+}
+
+struct ScopedPhase
+{
+    Phase ph;
+    double t0;
+    uint64_t c0[CNT_COUNT];
+    explicit ScopedPhase(Phase p) : ph(p), t0(BpClock())
+    {
+        memcpy(c0, g_Counters, sizeof(c0));
+    }
+    ~ScopedPhase()
+    {
+        double t1 = BpClock();
+        Stats_Record(ph, t1 - t0);
+        if (g_bTracing)
+        {
+            Trace_Push(g_PhaseNames[ph], 'X', t0, t1, c0);
+        }
+    }
+};
+
+void Stats_Print()
+{
+    ConPrint(CON_INFO, "[BlockerPasses] %-22s %8s %10s %10s %10s\n", "phase", "count", "p50 ms", "p99 ms", "max ms");
+    for (int i = 0; i < PH_COUNT; ++i)
+    {
+        const PhaseHist& h = g_PhaseHist[i];
+        ConPrint(CON_INFO, "[BlockerPasses] %-22s %8llu %10.3f %10.3f %10.3f\n", g_PhaseNames[i],
+            (unsigned long long)h.count, Stats_Percentile(h, 0.50) * 1000.0, Stats_Percentile(h, 0.99) * 1000.0, h.max * 1000.0);
+    }
+    for (int i = 0; i < CNT_COUNT; ++i)
+    {
+        ConPrint(CON_INFO, "[BlockerPasses] %-22s %8llu\n", g_CounterNames[i], (unsigned long long)g_Counters[i]);
+    }
+}
+
+void Stats_Reset()
+{
+    for (int i = 0; i < PH_COUNT; ++i)
+    {
+        g_PhaseHist[i] = PhaseHist();
+    }
+    for (int i = 0; i < CNT_COUNT; ++i)
+    {
+        g_Counters[i] = 0;
+    }
+}
+
+static void Stats_DumpPrometheus(const char* map)
+{
+    std::string out;
+    char line[256];
+
+    out += "# TYPE bp_phase_seconds histogram\n";
+    for (int i = 0; i < PH_COUNT; ++i)
+    {
+        const PhaseHist& h = g_PhaseHist[i];
+        uint64_t acc = 0;
+        for (int b = 0; b < HIST_BUCKETS; ++b)
+        {
+            acc += h.buckets[b];
+            snprintf(line, sizeof(line), "bp_phase_seconds_bucket{map=\"%s\",phase=\"%s\",le=\"%.6f\"} %llu\n",
+                map, g_PhaseNames[i], (double)(2ull << b) / 1000000.0, (unsigned long long)acc);
+            out += line;
+        }
+        snprintf(line, sizeof(line), "bp_phase_seconds_bucket{map=\"%s\",phase=\"%s\",le=\"+Inf\"} %llu\n",
+            map, g_PhaseNames[i], (unsigned long long)h.count);
+        out += line;
+        snprintf(line, sizeof(line), "bp_phase_seconds_sum{map=\"%s\",phase=\"%s\"} %.9f\n", map, g_PhaseNames[i], h.sum);
+        out += line;
+        snprintf(line, sizeof(line), "bp_phase_seconds_count{map=\"%s\",phase=\"%s\"} %llu\n", map, g_PhaseNames[i], (unsigned long long)h.count);
+        out += line;
+    }
+    for (int i = 0; i < CNT_COUNT; ++i)
+    {
+        snprintf(line, sizeof(line), "# TYPE bp_%s_total counter\nbp_%s_total{map=\"%s\"} %llu\n",
+            g_CounterNames[i], g_CounterNames[i], map, (unsigned long long)g_Counters[i]);
+        out += line;
+    }
+
+    if (!g_Backend->WriteFile("addons/data/bp_stats.prom", out))
+    {
+        Dbg("Stats: cannot write addons/data/bp_stats.prom");
+    }
+}
+
+static void Registry_OnCreate(BpEnt ent, const char* cls);
+static void Registry_Remove(BpEnt ent);
+
+static inline BpEnt CreateEnt(const char* cls)
+{
+    BpEnt ent = (BpEnt)g_Backend->CreateEntity(cls);
+    if (ent)
+    {
+        Stats_Count(CNT_ENT_CREATED);
+        Trace_Instant(cls);
+        Registry_OnCreate(ent, cls);
+    }
+    return ent;
+}
+
+static inline void RemoveEnt(BpEnt ent)
+{
+    Registry_Remove(ent);
+    Stats_Count(CNT_ENT_DESTROYED);
+    Trace_Instant("remove");
+    g_Backend->Remove(ent);
+}
+
+enum NetSource
+{
+    NS_SPAWN = 0,
+    NS_REMOVE,
+    NS_RAINBOW,
+    NS_RESIZE,
+    NS_EDIT,
+    NS_COUNT
+};
+
+static const char* g_NetSourceNames[NS_COUNT] = { "spawn", "remove", "rainbow", "resize", "edit" };
+
+// Approximate wire cost of one changed field (payload bits rounded up) plus
+// a per-entity delta header; good enough to compare features, not packets.
+static const int NET_ENTITY_HEADER_BYTES = 4;
+static const int NET_FIELD_PATH_BYTES = 2;
+static const int NET_MINUTES = 10;
+
+NetField g_NetFields[NF_COUNT] = {
+    { "CBaseEntity", "m_fEffects", 4, 0, 0 },
+    { "CBaseEntity", "m_CBodyComponent", 16, 0, 0 },
+    { "CBaseModelEntity", "m_clrRender", 4, 0, 0 },
+    { "CBaseModelEntity", "m_nRenderMode", 1, 0, 0 },
+    { "CBeam", "m_vecEndPos", 12, 0, 0 },
+    { "CBeam", "m_fWidth", 4, 0, 0 },
+    { "CCollisionProperty", "m_nSolidType", 1, 0, 0 },
+    { "CCollisionProperty", "m_nSurroundType", 1, 0, 0 },
+    { "CCollisionProperty", "m_vecMins", 12, 0, 0 },
+    { "CCollisionProperty", "m_vecMaxs", 12, 0, 0 },
+    { "CCollisionProperty", "m_vecSpecifiedSurroundingMins", 12, 0, 0 },
+    { "CCollisionProperty", "m_vecSpecifiedSurroundingMaxs", 12, 0, 0 },
+    { "CCollisionProperty", "m_collisionAttribute", 8, 0, 0 },
+    { "CCollisionProperty", "m_CollisionGroup", 1, 0, 0 },
+    { "?", "?", 4, 0, 0 },
+};
+
+struct NetTotals
+{
+    uint64_t changes = 0;
+    uint64_t bytes = 0;
+};
+
+struct NetMinute
+{
+    int64_t minute = -1;
+    NetTotals t;
+};
+
+struct NetLedger
+{
+    int item = -1;
+    NetSource source = NS_EDIT;
+    int tick = -1;
+    uint64_t tickBytes = 0;
+    std::unordered_set<BpEnt> tickEnts;
+    BpEnt lastEnt = nullptr;
+    uint64_t snapshots = 0;
+    uint64_t snapshotBytes = 0;
+    uint64_t snapshotPeak = 0;
+    NetTotals total;
+    NetTotals round;
+    NetTotals lastRound;
+    NetTotals bySource[NS_COUNT];
+    std::map<int, NetTotals> byItem;
+    NetMinute minutes[NET_MINUTES];
+};
+
+static NetLedger g_Net;
+
+struct ScopedNet
+{
+    int prevItem;
+    NetSource prevSource;
+    ScopedNet(int item, NetSource src) : prevItem(g_Net.item), prevSource(g_Net.source)
+    {
+        g_Net.item = item;
+        g_Net.source = src;
+    }
+    ~ScopedNet()
+    {
+        g_Net.item = prevItem;
+        g_Net.source = prevSource;
+    }
+};
+
+static void Net_CloseSnapshot()
+{
+    if (g_Net.tick < 0)
+    {
+        return;
+    }
+    ++g_Net.snapshots;
+    g_Net.snapshotBytes += g_Net.tickBytes;
+    if (g_Net.tickBytes > g_Net.snapshotPeak)
+    {
+        g_Net.snapshotPeak = g_Net.tickBytes;
+    }
+    g_Net.tickBytes = 0;
+    g_Net.tickEnts.clear();
+    g_Net.lastEnt = nullptr;
+    g_Net.tick = -1;
+}
+
+static void Net_Record(BpEnt ent, NetToken tok)
+{
+    int tick = g_Backend ? g_Backend->TickCount() : 0;
+    if (tick != g_Net.tick)
+    {
+        Net_CloseSnapshot();
+        g_Net.tick = tick;
+    }
+
+    NetField& nf = g_NetFields[tok];
+    uint64_t bytes = (uint64_t)(nf.bytes + NET_FIELD_PATH_BYTES);
+    if (ent != g_Net.lastEnt)
+    {
+        g_Net.lastEnt = ent;
+        if (g_Net.tickEnts.insert(ent).second)
+        {
+            bytes += NET_ENTITY_HEADER_BYTES;
+        }
+    }
+    g_Net.tickBytes += bytes;
+
+    ++nf.total;
+    ++nf.round;
+    g_Net.total.changes++;
+    g_Net.total.bytes += bytes;
+    g_Net.round.changes++;
+    g_Net.round.bytes += bytes;
+    g_Net.bySource[g_Net.source].changes++;
+    g_Net.bySource[g_Net.source].bytes += bytes;
+    if (g_Net.item >= 0)
+    {
+        NetTotals& it = g_Net.byItem[g_Net.item];
+        it.changes++;
+        it.bytes += bytes;
+    }
+
+    int64_t minute = (int64_t)(BpClock() / 60.0);
+    NetMinute& m = g_Net.minutes[minute % NET_MINUTES];
+    if (m.minute != minute)
+    {
+        m.minute = minute;
+        m.t = NetTotals();
+    }
+    m.t.changes++;
+    m.t.bytes += bytes;
+}
+
+static void Net_OnRoundStart()
+{
+    Net_CloseSnapshot();
+    g_Net.lastRound = g_Net.round;
+    g_Net.round = NetTotals();
+    for (int i = 0; i < NF_COUNT; ++i)
+    {
+        g_NetFields[i].round = 0;
+    }
+}
+
+void Net_Reset()
+{
+    NetLedger fresh;
+    g_Net = fresh;
+    for (int i = 0; i < NF_COUNT; ++i)
+    {
+        g_NetFields[i].total = 0;
+        g_NetFields[i].round = 0;
+    }
+}
+
+void Net_Print()
+{
+    ConPrint(CON_INFO, "[BlockerPasses] Net: total %llu changes, ~%llu bytes; round %llu / ~%llu B (last round %llu / ~%llu B)\n",
+        (unsigned long long)g_Net.total.changes, (unsigned long long)g_Net.total.bytes,
+        (unsigned long long)g_Net.round.changes, (unsigned long long)g_Net.round.bytes,
+        (unsigned long long)g_Net.lastRound.changes, (unsigned long long)g_Net.lastRound.bytes);
+    ConPrint(CON_INFO, "[BlockerPasses] Net: %llu snapshots, avg ~%.1f B, peak ~%llu B\n", (unsigned long long)g_Net.snapshots,
+        g_Net.snapshots ? (double)g_Net.snapshotBytes / (double)g_Net.snapshots : 0.0, (unsigned long long)g_Net.snapshotPeak);
+
+    int64_t now = (int64_t)(BpClock() / 60.0);
+    for (int back = 0; back < NET_MINUTES; ++back)
+    {
+        const NetMinute& m = g_Net.minutes[(now - back) % NET_MINUTES];
+        if (m.minute != now - back || !m.t.changes)
+        {
+            continue;
+        }
+        ConPrint(CON_INFO, "[BlockerPasses]   minute -%d: %llu changes, ~%llu B\n", back,
+            (unsigned long long)m.t.changes, (unsigned long long)m.t.bytes);
+    }
+
+    ConPrint(CON_INFO, "[BlockerPasses] %-48s %10s %10s\n", "field", "total", "round");
+    for (int i = 0; i < NF_COUNT; ++i)
+    {
+        const NetField& nf = g_NetFields[i];
+        if (!nf.total)
+        {
+            continue;
+        }
+        char name[96];
+        snprintf(name, sizeof(name), "%s::%s", nf.cls, nf.field);
+        ConPrint(CON_INFO, "[BlockerPasses] %-48s %10llu %10llu\n", name, (unsigned long long)nf.total, (unsigned long long)nf.round);
+    }
+
+    for (int i = 0; i < NS_COUNT; ++i)
+    {
+        if (g_Net.bySource[i].changes)
+        {
+            ConPrint(CON_INFO, "[BlockerPasses] source %-10s %10llu changes ~%llu B\n", g_NetSourceNames[i],
+                (unsigned long long)g_Net.bySource[i].changes, (unsigned long long)g_Net.bySource[i].bytes);
+        }
+    }
+
+    std::vector<std::pair<uint64_t, int>> items;
+    for (auto& kv : g_Net.byItem)
+    {
+        items.push_back(std::make_pair(kv.second.bytes, kv.first));
+    }
+    std::sort(items.begin(), items.end(), [](const std::pair<uint64_t, int>& a, const std::pair<uint64_t, int>& b) {
+        return a.first > b.first;
+    });
+    for (size_t i = 0; i < items.size() && i < 10; ++i)
+    {
+        int idx = items[i].second;
+        const char* label = (idx < (int)g_Items.size()) ? g_Items[idx].label.c_str() : "?";
+        ConPrint(CON_INFO, "[BlockerPasses] item #%d %-24s %8llu changes ~%llu B\n", idx, label,
+            (unsigned long long)g_Net.byItem[idx].changes, (unsigned long long)items[i].first);
+    }
+}
+
+static inline void StateChanged(BpEnt ent, NetToken tok)
+{
+    Stats_Count(CNT_STATE_CHANGED);
+    Net_Record(ent, tok);
+    g_Backend->StateChanged(ent, g_NetFields[tok].cls, g_NetFields[tok].field);
+}
+
+// Property writes only mark (entity, field) dirty; one flush at the end of
+// the same server frame (GameFrame post) sends each distinct field once and
+// drops entities removed meanwhile. Event handlers, menu callbacks, commands
+// and Utils timers all run before that point, so their changes make the
+// snapshot of the tick they happened in.
+struct DirtyEnt
+{
+    BpEnt ent;
+    uint32_t mask;
+    int item;
+    NetSource source;
+};
+
+bool g_bDirtyFlush = false;
+
+static std::vector<DirtyEnt> g_Dirty;
+static std::unordered_map<BpEnt, size_t> g_DirtyIndex;
+
+void FlushDirty()
+{
+    g_bDirtyFlush = false;
+    std::vector<DirtyEnt> batch;
+    batch.swap(g_Dirty);
+    g_DirtyIndex.clear();
+    for (const DirtyEnt& d : batch)
+    {
+        if (!g_Backend->Alive(d.ent))
+        {
+            for (uint32_t m = d.mask; m; m &= m - 1)
+            {
+                Stats_Count(CNT_STATE_COALESCED);
+            }
+            continue;
+        }
+        ScopedNet net(d.item, d.source);
+        for (int tok = 0; tok < NF_COUNT; ++tok)
+        {
+            if (d.mask & (1u << tok))
+            {
+                StateChanged(d.ent, (NetToken)tok);
+            }
+        }
+    }
+}
+
+static void MarkDirty(BpEnt ent, NetToken tok)
+{
+    if (!ent)
+    {
+        return;
+    }
+    auto found = g_DirtyIndex.find(ent);
+    if (found == g_DirtyIndex.end())
+    {
+        DirtyEnt d;
+        d.ent = ent;
+        d.mask = 0;
+        d.item = g_Net.item;
+        d.source = g_Net.source;
+        found = g_DirtyIndex.emplace(ent, g_Dirty.size()).first;
+        g_Dirty.push_back(d);
+    }
+    DirtyEnt& d = g_Dirty[found->second];
+    if (d.mask & (1u << tok))
+    {
+        Stats_Count(CNT_STATE_COALESCED);
+        return;
+    }
+    d.mask |= 1u << tok;
+    g_bDirtyFlush = true;
+}
+
+// Several fields of one entity written together. The Utils API takes one
+// field per notification, so the batch only saves the bookkeeping.
+static inline void MarkDirty(BpEnt ent, std::initializer_list<NetToken> toks)
+{
+    for (NetToken tok : toks)
+    {
+        MarkDirty(ent, tok);
+    }
+}
+
+// Every entity spawned for an item carries a deterministic targetname,
+// "bp:<index>:<hash>:<role>", role being p (prop), c<N> (collision) or b<N>
+// (beam). A reloaded plugin re-adopts entities whose hash still matches.
+static const char* BP_NAME_PREFIX = "bp:";
+
+static inline void HashBytes(uint32_t& h, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h = (h ^ p[i]) * 16777619u;
+    }
+}
+
+static uint32_t ItemHash(const BPItem& it)
+{
+    uint32_t h = 2166136261u;
+    HashBytes(h, it.path.data(), it.path.size());
+    HashBytes(h, &it.pos, sizeof(it.pos));
+    HashBytes(h, &it.ang, sizeof(it.ang));
+    HashBytes(h, &it.scale, sizeof(it.scale));
+    HashBytes(h, &it.invisible, sizeof(it.invisible));
+    HashBytes(h, &it.isWall, sizeof(it.isWall));
+    HashBytes(h, &it.pos2, sizeof(it.pos2));
+    HashBytes(h, &it.wallYaw, sizeof(it.wallYaw));
+    int colors[] = { it.beamR, it.beamG, it.beamB, it.beamRainbow ? 1 : 0, it.itemR, it.itemG, it.itemB };
+    HashBytes(h, colors, sizeof(colors));
+    if (!it.points.empty())
+    {
+        HashBytes(h, it.points.data(), it.points.size() * sizeof(BpVec));
+        HashBytes(h, &it.polyHeight, sizeof(it.polyHeight));
+        HashBytes(h, &it.polyThick, sizeof(it.polyThick));
+    }
+    return h;
+}
+
+struct SpawnOwner
+{
+    int item = -1;
+    uint32_t hash = 0;
+    int colls = 0;
+    int beams = 0;
+};
+
+static SpawnOwner g_SpawnOwner;
+
+struct ScopedOwner
+{
+    SpawnOwner prev;
+    explicit ScopedOwner(int item) : prev(g_SpawnOwner)
+    {
+        g_SpawnOwner = SpawnOwner();
+        if (item >= 0 && item < (int)g_Items.size())
+        {
+            g_SpawnOwner.item = item;
+            g_SpawnOwner.hash = ItemHash(g_Items[item]);
+        }
+    }
+    ~ScopedOwner()
+    {
+        g_SpawnOwner = prev;
+    }
+};
+
+static void TagSpawn(BpSpawnKV& kv, char role)
+{
+    if (g_SpawnOwner.item < 0)
+    {
+        return;
+    }
+    char name[64];
+    if (role == 'p')
+    {
+        snprintf(name, sizeof(name), "%s%d:%08x:p", BP_NAME_PREFIX, g_SpawnOwner.item, g_SpawnOwner.hash);
+    }
+    else
+    {
+        int n = (role == 'c') ? g_SpawnOwner.colls++ : g_SpawnOwner.beams++;
+        snprintf(name, sizeof(name), "%s%d:%08x:%c%d", BP_NAME_PREFIX, g_SpawnOwner.item, g_SpawnOwner.hash, role, n);
+    }
+    kv.SetString("targetname", name);
+}
+
+static bool ParseEntName(const char* name, int& item, uint32_t& hash, char& role, int& n)
+{
+    if (!name || strncmp(name, BP_NAME_PREFIX, 3) != 0)
+    {
+        return false;
+    }
+    unsigned h = 0;
+    char r = 0;
+    int consumed = 0;
+    if (sscanf(name + 3, "%d:%8x:%c%n", &item, &h, &r, &consumed) != 3)
+    {
+        return false;
+    }
+    hash = h;
+    role = r;
+    n = (r == 'p') ? 0 : atoi(name + 3 + consumed);
+    return r == 'p' || r == 'c' || r == 'b';
+}
+
+typedef uint32_t TaskToken;
+
+struct SchedTask
+{
+    double due;
+    uint64_t seq;
+    TaskToken token;
+    TaskScope scope;
+    const char* name;
+    int stat;                       // slot in g_TaskStats
+    std::function<float()> fn;
+};
+
+struct TaskStats
+{
+    uint64_t runs = 0;
+    double total = 0.0;
+    double max = 0.0;
+};
+
+int g_SchedDriverGen = 0;
+
+static std::vector<SchedTask>                         g_SchedHeap;
+static std::set<TaskToken>                            g_SchedAlive;
+static std::vector<std::pair<const char*, TaskStats>> g_TaskStats;
+static TaskToken                                      g_NextTaskToken = 1;
+static uint64_t                                       g_NextTaskSeq = 0;
+static bool                                           g_bSchedDriver = false;
+static double                                         g_SchedWake = 0.0;     // when the driver timer fires next
+
+// Task names are literals, so stats are interned once per name at Sched_Add
+// and the run path indexes them directly.
+static int Sched_StatSlot(const char* name)
+{
+    for (size_t i = 0; i < g_TaskStats.size(); ++i)
+    {
+        if (g_TaskStats[i].first == name || !strcmp(g_TaskStats[i].first, name))
+        {
+            return (int)i;
+        }
+    }
+    g_TaskStats.emplace_back(name, TaskStats());
+    return (int)g_TaskStats.size() - 1;
+}
+
+static inline bool SchedLater(const SchedTask& a, const SchedTask& b)
+{
+    return a.due != b.due ? a.due > b.due : a.seq > b.seq;
+}
+
+static void Sched_RunDue()
+{
+    double now = g_Backend->Time();
+    while (!g_SchedHeap.empty() && g_SchedHeap.front().due <= now)
+    {
+        std::pop_heap(g_SchedHeap.begin(), g_SchedHeap.end(), SchedLater);
+        SchedTask task = std::move(g_SchedHeap.back());
+        g_SchedHeap.pop_back();
+        if (!g_SchedAlive.count(task.token))
+        {
+            continue;
+        }
+
+        uint64_t c0[CNT_COUNT];
+        memcpy(c0, g_Counters, sizeof(c0));
+        double t0 = BpClock();
+        float next = task.fn();
+        double dt = BpClock() - t0;
+        if (g_bTracing)
+        {
+            Trace_Push(task.name, 'X', t0, t0 + dt, c0);
+        }
+
+        TaskStats& st = g_TaskStats[task.stat].second;
+        ++st.runs;
+        st.total += dt;
+        if (dt > st.max)
+        {
+            st.max = dt;
+        }
+
+        if (next < 0.0f || !g_SchedAlive.count(task.token))
+        {
+            g_SchedAlive.erase(task.token);
+            continue;
+        }
+        task.due = now + (next > 0.0f ? next : 1e-6);
+        task.seq = g_NextTaskSeq++;
+        g_SchedHeap.push_back(std::move(task));
+        std::push_heap(g_SchedHeap.begin(), g_SchedHeap.end(), SchedLater);
+    }
+}
+
+// Delay from now until the earliest pending task; the driver timer sleeps
+// that long instead of firing every tick.
+static float Sched_NextDelay()
+{
+    double now = g_Backend->Time();
+    g_SchedWake = g_SchedHeap.front().due;
+    return g_SchedWake > now ? (float)(g_SchedWake - now) : 0.0f;
+}
+
+static void Sched_EnsureDriver()
+{
+    if (g_bSchedDriver || !g_Backend || g_SchedHeap.empty())
+    {
+        return;
+    }
+    g_bSchedDriver = true;
+    int gen = g_SchedDriverGen;
+    g_Backend->CreateTimer(Sched_NextDelay(), [gen]() -> float {
+        if (gen != g_SchedDriverGen)
+        {
+            return -1.0f;
+        }
+        Sched_RunDue();
+        if (g_SchedHeap.empty())
+        {
+            g_bSchedDriver = false;
+            return -1.0f;
+        }
+        return Sched_NextDelay();
+    });
+}
+
+static void Sched_ResetDriver()
+{
+    ++g_SchedDriverGen;
+    g_bSchedDriver = false;
+    if (!g_SchedHeap.empty())
+    {
+        Sched_EnsureDriver();
+    }
+}
+
+static TaskToken Sched_Add(const char* name, float delay, TaskScope scope, std::function<float()> fn)
+{
+    SchedTask task;
+    task.due = g_Backend->Time() + delay;
+    task.seq = g_NextTaskSeq++;
+    task.token = g_NextTaskToken++;
+    if (!task.token)
+    {
+        task.token = g_NextTaskToken++;
+    }
+    task.scope = scope;
+    task.name = name;
+    task.stat = Sched_StatSlot(name);
+    task.fn = std::move(fn);
+    TaskToken token = task.token;
+    bool sooner = g_bSchedDriver && task.due < g_SchedWake;
+    Stats_Count(CNT_TASKS_SCHEDULED);
+    g_SchedAlive.insert(token);
+    g_SchedHeap.push_back(std::move(task));
+    std::push_heap(g_SchedHeap.begin(), g_SchedHeap.end(), SchedLater);
+    if (sooner)
+    {
+        // The sleeping driver would wake too late; start a new one.
+        Sched_ResetDriver();
+    }
+    else
+    {
+        Sched_EnsureDriver();
+    }
+    return token;
+}
+
+static inline void Sched_Cancel(TaskToken& token)
+{
+    if (token)
+    {
+        g_SchedAlive.erase(token);
+        token = 0;
+    }
+}
+
+void Sched_CancelScope(TaskScope upTo)
+{
+    auto it = std::remove_if(g_SchedHeap.begin(), g_SchedHeap.end(), [upTo](const SchedTask& t) {
+        if (t.scope > upTo)
+        {
+            return false;
+        }
+        g_SchedAlive.erase(t.token);
+        return true;
+    });
+    g_SchedHeap.erase(it, g_SchedHeap.end());
+    std::make_heap(g_SchedHeap.begin(), g_SchedHeap.end(), SchedLater);
+}
+
+void Sched_PrintStats()
+{
+    ConPrint(CON_INFO, "[BlockerPasses] Pending tasks: %d\n", (int)g_SchedAlive.size());
+    for (auto& kv : g_TaskStats)
+    {
+        const TaskStats& st = kv.second;
+        ConPrint(CON_INFO, "[BlockerPasses]   %-20s runs=%llu total=%.3f ms avg=%.3f ms max=%.3f ms\n",
+            kv.first, (unsigned long long)st.runs, st.total * 1000.0,
+            st.runs ? st.total * 1000.0 / (double)st.runs : 0.0, st.max * 1000.0);
+    }
+}
+
+static TaskToken g_RainbowTask = 0;
+
+static void KillWallCollision(BpEnt ent);
+
+void ClearLive(bool removeEntities)
+{
+    ScopedPhase sp(PH_CLEAR_LIVE);
+    if (removeEntities)
+    {
+        for (auto& le : g_Live)
+        {
+            bool isWall = (le.index >= 0 && le.index < (int)g_Items.size() && g_Items[le.index].isWall);
+            if (isWall)
+            {
+                for (auto& wc : le.wallColls)
+                {
+                    if (EntAlive(wc))
+                    {
+                        KillWallCollision(wc);
+                    }
+                }
+                le.wallColls.clear();
+            }
+            else if (EntAlive(le.ent))
+            {
+                RemoveEnt(le.ent);
+            }
+            for (auto& bh : le.beams)
+            {
+                if (EntAlive(bh))
+                {
+                    RemoveEnt(bh);
+                }
+            }
+        }
+    }
+    g_Live.clear();
+    g_LiveSlot.assign(g_Items.size(), -1);
+    g_bRainbowTimerActive = false;
+    Sched_Cancel(g_RainbowTask);
+}
+
+static inline void RemoveLiveBeams(LiveEnt& le)
+{
+    for (auto& bh : le.beams)
+    {
+        if (EntAlive(bh))
+        {
+            RemoveEnt(bh);
+        }
+    }
+    le.beams.clear();
+}
+
+static inline int LiveSlot(int index)
+{
+    return index >= 0 && index < (int)g_LiveSlot.size() ? g_LiveSlot[index] : -1;
+}
+
+static void Registry_Own(const LiveEnt& le);
+
+static void Live_Push(LiveEnt&& le)
+{
+    Registry_Own(le);
+    if (le.index >= (int)g_LiveSlot.size())
+    {
+        g_LiveSlot.resize(std::max(g_Items.size(), (size_t)le.index + 1), -1);
+    }
+    if (le.index >= 0)
+    {
+        g_LiveSlot[le.index] = (int)g_Live.size();
+    }
+    g_Live.push_back(std::move(le));
+}
+
+// Called after entries leave g_Live or items are renumbered.
+void Live_Reindex()
+{
+    g_LiveSlot.assign(g_Items.size(), -1);
+    for (int k = 0; k < (int)g_Live.size(); ++k)
+    {
+        int i = g_Live[k].index;
+        if (i >= 0 && i < (int)g_LiveSlot.size())
+        {
+            g_LiveSlot[i] = k;
+        }
+    }
+}
+
+static void DestroyLiveEntry(LiveEnt& le)
+{
+    ScopedNet net(le.index, NS_REMOVE);
+    bool isWall = (le.index >= 0 && le.index < (int)g_Items.size() && g_Items[le.index].isWall);
+    if (isWall)
+    {
+        for (auto& wc : le.wallColls)
+        {
+            if (EntAlive(wc))
+            {
+                KillWallCollision(wc);
+            }
+        }
+        le.wallColls.clear();
+    }
+    else if (EntAlive(le.ent))
+    {
+        RemoveEnt(le.ent);
+    }
+    RemoveLiveBeams(le);
+}
+
+// Destroys the live entries of the given items, then drops them from g_Live
+// in one compaction.
+int Live_Destroy(const int* items, size_t n)
+{
+    int destroyed = 0;
+    for (size_t k = 0; k < n; ++k)
+    {
+        int slot = LiveSlot(items[k]);
+        if (slot < 0)
+        {
+            continue;
+        }
+        DestroyLiveEntry(g_Live[slot]);
+        g_Live[slot].index = -1;
+        g_LiveSlot[items[k]] = -1;
+        ++destroyed;
+    }
+    if (destroyed)
+    {
+        g_Live.erase(std::remove_if(g_Live.begin(), g_Live.end(), [](const LiveEnt& le) { return le.index < 0; }), g_Live.end());
+        Live_Reindex();
+    }
+    return destroyed;
+}
+
+static void KillWallCollision(BpEnt ent)
+{
+    if (!ent)
+    {
+        return;
+    }
+    BpVec zero(0, 0, 0);
+    if (g_Backend->SetField(ent, NF_SOLID_TYPE, BP_SOLID_NONE))
+    {
+        g_Backend->SetField(ent, NF_MINS, zero);
+        g_Backend->SetField(ent, NF_MAXS, zero);
+        g_Backend->SetField(ent, NF_SURROUNDING_MINS, zero);
+        g_Backend->SetField(ent, NF_SURROUNDING_MAXS, zero);
+        MarkDirty(ent, { NF_SOLID_TYPE, NF_MINS, NF_MAXS, NF_SURROUNDING_MINS, NF_SURROUNDING_MAXS });
+
+        if (g_Backend->HasCollisionBounds())
+        {
+            g_Backend->SetCollisionBounds(ent, zero, zero);
+        }
+    }
+
+    BpVec voidPos(0, 0, -15000);
+    BpVec noAng(0, 0, 0);
+    TeleportEnt(ent, &voidPos, &noAng);
+
+    RemoveEnt(ent);
+}
+
+enum EntRole
+{
+    ROLE_PROP = 0,
+    ROLE_COLLISION,
+    ROLE_BEAM,
+    ROLE_COUNT
+};
+
+static const char* g_RoleNames[ROLE_COUNT] = { "prop", "collision", "beam" };
+
+struct RegEntry
+{
+    BpEnt ent;
+    EntRole role;
+    int item;
+    double created;
+    bool owned;                     // held by a g_Live entry; set by Registry_Own
+};
+
+// Every entity the plugin creates, whether or not g_Live still points at
+// it. The sweep walks a few entries per tick and removes the ones nobody
+// owns any more; entries whose entity is already gone are just dropped.
+// Ownership is a flag kept current by the live paths (Live_Push, beam
+// redraws), so entities spawned mid-pass are never judged on stale state.
+static std::vector<RegEntry> g_Registry;
+static std::unordered_map<BpEnt, size_t> g_RegistryIndex;
+static int g_RoleCount[ROLE_COUNT];
+static uint64_t g_OrphansRemoved = 0;
+static TaskToken g_SweepTask = 0;
+static size_t g_SweepCursor = 0;
+static const int SWEEP_BUDGET = 32;
+static const double SWEEP_GRACE = 2.0;
+
+static void Registry_Erase(size_t i)
+{
+    --g_RoleCount[g_Registry[i].role];
+    g_RegistryIndex.erase(g_Registry[i].ent);
+    if (i + 1 != g_Registry.size())
+    {
+        g_Registry[i] = g_Registry.back();
+        g_RegistryIndex[g_Registry[i].ent] = i;
+    }
+    g_Registry.pop_back();
+}
+
+static void Registry_Remove(BpEnt ent)
+{
+    auto found = g_RegistryIndex.find(ent);
+    if (found != g_RegistryIndex.end())
+    {
+        Registry_Erase(found->second);
+    }
+}
+
+static inline void Registry_SetOwned(BpEnt ent)
+{
+    auto found = ent ? g_RegistryIndex.find(ent) : g_RegistryIndex.end();
+    if (found != g_RegistryIndex.end())
+    {
+        g_Registry[found->second].owned = true;
+    }
+}
+
+// Marks every entity of a live entry as owned. Entities leave the registry
+// through RemoveEnt, so nothing clears the flag.
+static void Registry_Own(const LiveEnt& le)
+{
+    Registry_SetOwned(le.ent);
+    for (const auto& h : le.wallColls)
+    {
+        Registry_SetOwned(h);
+    }
+    for (const auto& h : le.beams)
+    {
+        Registry_SetOwned(h);
+    }
+}
+
+static float Sweep_Tick()
+{
+    if (g_Registry.empty())
+    {
+        g_SweepTask = 0;
+        return -1.0f;
+    }
+    if (g_SweepCursor >= g_Registry.size())
+    {
+        g_SweepCursor = 0;
+    }
+    double now = g_Backend->Time();
+    for (int budget = SWEEP_BUDGET; budget > 0 && g_SweepCursor < g_Registry.size(); --budget)
+    {
+        RegEntry& e = g_Registry[g_SweepCursor];
+        if (!g_Backend->Alive(e.ent))
+        {
+            Registry_Erase(g_SweepCursor);
+            continue;
+        }
+        if (e.owned || now - e.created < SWEEP_GRACE)
+        {
+            ++g_SweepCursor;
+            continue;
+        }
+        LogAt(LVL_WARN, LOGC_SPAWN, "Sweep: orphan %s of item %d (age %.1fs), removing", g_RoleNames[e.role], e.item, now - e.created);
+        ++g_OrphansRemoved;
+        BpEnt ent = e.ent;
+        if (e.role == ROLE_COLLISION)
+        {
+            KillWallCollision(ent);
+        }
+        else
+        {
+            RemoveEnt(ent);
+        }
+    }
+    if (g_SweepCursor >= g_Registry.size())
+    {
+        g_SweepCursor = 0;
+    }
+    return 0.1f;
+}
+
+static void Registry_Add(BpEnt ent, EntRole role, int item)
+{
+    RegEntry e;
+    e.ent = ent;
+    e.role = role;
+    e.item = item;
+    e.created = g_Backend->Time();
+    e.owned = false;
+    g_RegistryIndex[ent] = g_Registry.size();
+    g_Registry.push_back(e);
+    ++g_RoleCount[role];
+    if (!g_SweepTask)
+    {
+        g_SweepCursor = 0;
+        g_SweepTask = Sched_Add("leak_sweep", 0.1f, SCOPE_PLUGIN, Sweep_Tick);
+    }
+}
+
+static EntRole RoleForClass(const char* cls)
+{
+    if (!strcmp(cls, "env_beam"))
+    {
+        return ROLE_BEAM;
+    }
+    if (!strcmp(cls, "func_brush"))
+    {
+        return ROLE_COLLISION;
+    }
+    return ROLE_PROP;
+}
+
+static void Registry_OnCreate(BpEnt ent, const char* cls)
+{
+    Registry_Add(ent, RoleForClass(cls), g_SpawnOwner.item);
+}
+
+void Registry_Print()
+{
+    int expected[ROLE_COUNT] = {};
+    for (const LiveEnt& le : g_Live)
+    {
+        bool isWall = le.index >= 0 && le.index < (int)g_Items.size() && g_Items[le.index].isWall;
+        if (isWall)
+        {
+            expected[ROLE_COLLISION] += (int)le.wallColls.size();
+        }
+        else if (EntAlive(le.ent))
+        {
+            ++expected[ROLE_PROP];
+        }
+        expected[ROLE_BEAM] += (int)le.beams.size();
+    }
+    for (int r = 0; r < ROLE_COUNT; ++r)
+    {
+        ConPrint(CON_INFO, "[BlockerPasses] %-10s registered %6d, owned by live items %6d\n",
+            g_RoleNames[r], g_RoleCount[r], expected[r]);
+    }
+    ConPrint(CON_INFO, "[BlockerPasses] orphans removed: %llu, sweep %s\n",
+        (unsigned long long)g_OrphansRemoved, g_SweepTask ? "running" : "idle");
+}
+
+int EntityBudget()
+{
+    return g_MapBudget >= 0 ? g_MapBudget : g_EntityBudget;
+}
+
+int EntitiesInUse()
+{
+    int n = 0;
+    for (int r = 0; r < ROLE_COUNT; ++r)
+    {
+        n += g_RoleCount[r];
+    }
+    return n;
+}
+
+typedef BpWallGeomT<BpVec> WallGeom;
+
+// Outline detail for a wall spawned outside the round plan (edits, tier
+// changes): whatever still fits in the budget. Both callers run after the
+// wall's collision boxes exist, so EntitiesInUse() already counts them.
+static int Budget_BeamDetail(const WallGeom& g)
+{
+    int budget = EntityBudget();
+    if (budget <= 0)
+    {
+        return BEAMS_FULL;
+    }
+    int left = budget - EntitiesInUse();
+    if (left >= BpWallBeams(g, BEAMS_FULL))
+    {
+        return BEAMS_FULL;
+    }
+    if (left >= BpWallBeams(g, BEAMS_EDGES))
+    {
+        return BEAMS_EDGES;
+    }
+    LogAt(LVL_WARN, LOGC_SPAWN, "Entity budget %d reached on %s: wall spawned without outline", budget, g_CurrentMap.c_str());
+    return BEAMS_NONE;
+}
+
+static inline float ClampScale(float v)
+{
+    if (v < 0.05f)
+    {
+        v = 0.05f;
+    }
+    if (v > 20.0f)
+    {
+        v = 20.0f;
+    }
+    return v;
+}
+
+static inline void ApplyRenderAlpha(BpEnt ent, uint8_t a)
+{
+    BpFieldValue cur;
+    if (!ent || !g_Backend->GetField(ent, NF_CLR_RENDER, cur))
+    {
+        return;
+    }
+    if (cur.a == a)
+    {
+        return;
+    }
+    g_Backend->SetField(ent, NF_CLR_RENDER, BpFieldValue::Rgba(cur.r, cur.g, cur.b, a));
+    MarkDirty(ent, NF_CLR_RENDER);
+}
+
+static inline void ApplyRenderColor(BpEnt ent, int r, int g, int b)
+{
+    BpFieldValue cur;
+    if (!ent || !g_Backend->GetField(ent, NF_CLR_RENDER, cur))
+    {
+        return;
+    }
+    g_Backend->SetField(ent, NF_CLR_RENDER, BpFieldValue::Rgba(r, g, b, cur.a));
+    MarkDirty(ent, NF_CLR_RENDER);
+}
+
+static inline void SetNoDraw(BpEnt ent, bool on)
+{
+    BpFieldValue fx;
+    if (!ent || !g_Backend->GetField(ent, NF_EFFECTS, fx))
+    {
+        return;
+    }
+    if (((fx.i & BP_EF_NODRAW) != 0) == on)
+    {
+        return;
+    }
+    g_Backend->SetField(ent, NF_EFFECTS, on ? BP_EF_NODRAW : 0);
+    MarkDirty(ent, NF_EFFECTS);
+}
+
+static BpEnt CreateBeamLine(const BpVec& start, const BpVec& end, int cr, int cg, int cb, float width = 1.0f)
+{
+    BpEnt ent = CreateEnt("env_beam");
+    if (!ent)
+    {
+        Dbg("CreateBeamLine: CreateEntityByName failed");
+        return nullptr;
+    }
+
+    char colorStr[32];
+    snprintf(colorStr, sizeof(colorStr), "%d %d %d", cr, cg, cb);
+
+    BpSpawnKV kv;
+    kv.SetFloat("BoltWidth", width);
+    kv.SetString("rendercolor", colorStr);
+    kv.SetInt("renderamt", 255);
+    kv.SetFloat("life", 0.0f);
+    TagSpawn(kv, 'b');
+    g_Backend->Spawn(ent, &kv);
+
+    BpVec noAng(0, 0, 0);
+    TeleportEnt(ent, &start, &noAng);
+
+    g_Backend->SetField(ent, NF_BEAM_END_POS, end);
+    MarkDirty(ent, NF_BEAM_END_POS);
+
+    g_Backend->SetField(ent, NF_BEAM_WIDTH, width);
+    MarkDirty(ent, NF_BEAM_WIDTH);
+
+    LogAt(LVL_TRACE, LOGC_BEAM, "CreateBeamLine: (%.0f %.0f %.0f) -> (%.0f %.0f %.0f)", start.x, start.y, start.z, end.x, end.y, end.z);
+    return ent;
+}
+
+static std::vector<BpEnt> DrawWireframe(const WallGeom& g, int bR, int bG, int bB, bool rainbow, float width = 1.0f,
+    int detail = BEAMS_FULL)
+{
+    ScopedPhase sp(PH_DRAW_WIREFRAME);
+    std::vector<BpEnt> beams;
+    int n = BpWallBeams(g, detail);
+    for (int i = 0; i < n; ++i)
+    {
+        int cr, cg, cb;
+        if (rainbow)
+        {
+            BpHueToRGB(g_flRainbowHue, cr, cg, cb);
+        }
+        else
+        {
+            cr = bR;
+            cg = bG;
+            cb = bB;
+        }
+        BpVec a, b;
+        BpWallBeam(g, i, a, b);
+        BpEnt ent = CreateBeamLine(a, b, cr, cg, cb, width);
+        if (ent)
+        {
+            beams.push_back(BpEnt(ent));
+        }
+    }
+    return beams;
+}
+
+static void StartRainbowTimer()
+{
+    if (g_bRainbowTimerActive || g_bIdle)
+    {
+        return;
+    }
+    g_bRainbowTimerActive = true;
+    g_RainbowTask = Sched_Add("rainbow", 0.1f, SCOPE_MAP, []() -> float {
+        ScopedPhase sp(PH_RAINBOW_TICK);
+        g_flRainbowHue += 10.0f;
+        if (g_flRainbowHue >= 360.0f)
+        {
+            g_flRainbowHue -= 360.0f;
+        }
+
+        bool anyRainbow = false;
+        for (auto& le : g_Live)
+        {
+            if (le.index < 0 || le.index >= (int)g_Items.size())
+            {
+                continue;
+            }
+            if (!g_Items[le.index].isWall || !g_Items[le.index].beamRainbow)
+            {
+                continue;
+            }
+            anyRainbow = true;
+            ScopedNet net(le.index, NS_RAINBOW);
+            int rv, gv, bv;
+            BpHueToRGB(g_flRainbowHue, rv, gv, bv);
+            for (auto& bh : le.beams)
+            {
+                BpEnt beam = bh;
+                if (beam && g_Backend->SetField(beam, NF_CLR_RENDER, BpFieldValue::Rgba(rv, gv, bv, 255)))
+                {
+                    MarkDirty(beam, NF_CLR_RENDER);
+                }
+            }
+        }
+
+        if (!anyRainbow)
+        {
+            g_bRainbowTimerActive = false;
+            g_RainbowTask = 0;
+            return -1.0f;
+        }
+        return 0.1f;
+    });
+}
+
+static void NoteBlockerSolid()
+{
+    if (g_nPendingSolid > 0)
+    {
+        --g_nPendingSolid;
+    }
+    if (g_nPendingSolid == 0 && g_bMeasureSolid)
+    {
+        g_bMeasureSolid = false;
+        LogAt(LVL_DEBUG, LOGC_ROUND, "Round start -> last blocker solid: %.2f ms", (g_Backend->Time() - g_flRoundStartTime) * 1000.0);
+    }
+}
+
+// 'surround' is the half-extents of the world box around the turned box
+// (WallGeom::surround).
+static BpEnt SpawnOneCollisionBox(const BpVec& boxCenter, const BpVec& vmins, const BpVec& vmaxs,
+    const BpVec& surround, float yaw = 0.0f)
+{
+    BpEnt ent = CreateEnt("func_brush");
+    if (!ent)
+    {
+        Dbg("SpawnOneCollisionBox: CreateEntityByName func_brush failed");
+        return nullptr;
+    }
+
+    bool model = g_Backend->SetField(ent, NF_RENDER_MODE, BP_RENDER_NONE);
+    if (model)
+    {
+        MarkDirty(ent, NF_RENDER_MODE);
+    }
+
+    BpVec ang(0, yaw, 0);
+    TeleportEnt(ent, &boxCenter, &ang);
+
+    BpSpawnKV kv;
+    TagSpawn(kv, 'c');
+    g_Backend->Spawn(ent, &kv);
+
+    BpVec surroundMins(-surround.x, -surround.y, vmins.z);
+    BpVec surroundMaxs(surround.x, surround.y, vmaxs.z);
+
+    if (model)
+    {
+        g_Backend->SetField(ent, NF_SURROUND_TYPE, 3);
+        g_Backend->SetField(ent, NF_SURROUNDING_MAXS, surroundMaxs);
+        g_Backend->SetField(ent, NF_SURROUNDING_MINS, surroundMins);
+        g_Backend->SetField(ent, NF_MINS, vmins);
+        g_Backend->SetField(ent, NF_MAXS, vmaxs);
+        g_Backend->SetField(ent, NF_COLLISION_ATTRIBUTE, 0);
+        g_Backend->SetField(ent, NF_COLLISION_GROUP, 0);
+        g_Backend->SetField(ent, NF_SOLID_TYPE, BP_SOLID_OBB);
+        MarkDirty(ent, { NF_SURROUND_TYPE, NF_SURROUNDING_MAXS, NF_SURROUNDING_MINS, NF_MINS, NF_MAXS,
+            NF_COLLISION_ATTRIBUTE, NF_COLLISION_GROUP, NF_SOLID_TYPE });
+
+        g_Backend->SetField(ent, NF_CLR_RENDER, BpFieldValue::Rgba(0, 0, 0, 0));
+        MarkDirty(ent, NF_CLR_RENDER);
+    }
+
+    BpEnt hEnt(ent);
+    BpVec capturedMins = vmins;
+    BpVec capturedMaxs = vmaxs;
+
+    ++g_nPendingSolid;
+    Sched_Add("collision_bounds", 0.0f, SCOPE_ROUND, [hEnt, capturedMins, capturedMaxs]() -> float {
+        BpEnt e = hEnt;
+        if (!EntAlive(e))
+        {
+            NoteBlockerSolid();
+            return -1.0f;
+        }
+
+        g_Backend->SetModel(e, "models/props/de_dust/hr_dust/dust_soccerball/dust_soccer_ball001.vmdl");
+
+        g_Backend->SetCollisionBounds(e, capturedMins, capturedMaxs);
+
+        LogAt(LVL_TRACE, LOGC_SPAWN, "SpawnOneCollisionBox: deferred SetCollisionBounds applied (OBB)");
+        NoteBlockerSolid();
+        return -1.0f;
+    });
+
+    return ent;
+}
+
+static std::vector<BpEnt> SpawnWallCollisions(const WallGeom& g)
+{
+    ScopedPhase sp(PH_SPAWN_WALL_COLL);
+    std::vector<BpEnt> result;
+
+    if (!g_Backend->HasCollisionBounds())
+    {
+        LogAt(LVL_ERROR, LOGC_SPAWN, "SpawnWallCollisions: SetCollisionBounds not found, see mm_bp_sig");
+        return result;
+    }
+
+    for (int k = 0; k < BpWallBoxes(g); ++k)
+    {
+        const WallGeom& box = BpWallBox(g, k);
+        BpEnt ent = SpawnOneCollisionBox(box.center, box.mins, box.maxs, box.surround, box.yaw);
+        if (ent)
+        {
+            result.push_back(ent);
+        }
+        LogAt(LVL_DEBUG, LOGC_SPAWN, "SpawnWallCollisions: yaw=%.1f center(%.1f %.1f %.1f) half(%.1f %.1f %.1f)",
+            box.yaw, box.center.x, box.center.y, box.center.z, box.maxs.x, box.maxs.y, box.maxs.z);
+    }
+
+    return result;
+}
+
+static BpEnt SpawnOne(const BPItem& it)
+{
+    ScopedPhase sp(PH_SPAWN_ONE);
+    if (it.path.empty())
+    {
+        Dbg("SpawnOne: empty path");
+        return nullptr;
+    }
+    if (!strstr(it.path.c_str(), ".vmdl"))
+    {
+        Dbg("SpawnOne: invalid model '%s'", it.path.c_str());
+        return nullptr;
+    }
+
+    const char* classes[] = { "prop_dynamic", "prop_dynamic_override" };
+    for (const char* cls : classes)
+    {
+        BpEnt ent = CreateEnt(cls);
+        if (!ent)
+        {
+            Dbg("SpawnOne: CreateEntityByName failed for %s", cls);
+            continue;
+        }
+
+        BpSpawnKV kv;
+        kv.SetString("model", it.path.c_str());
+        kv.SetInt("solid", 6);
+        kv.SetInt("DisableBoneFollowers", 1);
+
+        float safeScale = ClampScale(it.scale);
+        kv.SetFloat("uniformscale", safeScale);
+        TagSpawn(kv, 'p');
+
+        g_Backend->Spawn(ent, &kv);
+        TeleportEnt(ent, &it.pos, &it.ang);
+
+        if (it.invisible)
+        {
+            ApplyRenderAlpha(ent, 0);
+            SetNoDraw(ent, true);
+        }
+
+        if (it.itemR != 255 || it.itemG != 255 || it.itemB != 255)
+        {
+            ApplyRenderColor(ent, it.itemR, it.itemG, it.itemB);
+        }
+
+        LogAt(LVL_DEBUG, LOGC_SPAWN, "SpawnOne: %s '%s' at (%.1f %.1f %.1f) ang(%.1f %.1f %.1f) scale=%.3f invis=%d",
+            cls, it.path.c_str(), it.pos.x, it.pos.y, it.pos.z, it.ang.x, it.ang.y, it.ang.z, safeScale, (int)it.invisible);
+        return ent;
+    }
+    Dbg("SpawnOne: failed model '%s'", it.path.c_str());
+    return nullptr;
+}
+
+// Spawns everything item 'index' needs into 'le'. Returns false when
+// nothing could be created and the entry should not be kept.
+static bool SpawnLiveEntry(int index, LiveEnt& le, const WallGeom* pre = nullptr, int beamDetail = -1)
+{
+    ScopedNet net(index, NS_SPAWN);
+    ScopedOwner owner(index);
+    const BPItem& it = g_Items[index];
+    if (!it.isWall)
+    {
+        BpEnt e = SpawnOne(it);
+        le.ent = BpEnt(e);
+        return e != nullptr;
+    }
+
+    WallGeom local;
+    if (!pre)
+    {
+        BpComputeItemGeom(it, local);
+        pre = &local;
+    }
+    auto wallEnts = SpawnWallCollisions(*pre);
+    for (auto* e : wallEnts)
+    {
+        le.wallColls.push_back(BpEnt(e));
+    }
+    if (!wallEnts.empty())
+    {
+        le.ent = BpEnt(wallEnts[0]);
+    }
+    le.beamDetail = beamDetail >= 0 ? beamDetail : Budget_BeamDetail(*pre);
+    if (!g_bIdle)
+    {
+        le.beams = DrawWireframe(*pre, it.beamR, it.beamG, it.beamB, it.beamRainbow, 1.0f, le.beamDetail);
+        if (it.beamRainbow)
+        {
+            StartRainbowTimer();
+        }
+    }
+    return true;
+}
+
+struct RoundPlan
+{
+    bool ready = false;
+    bool open = false;
+    int revision = -1;
+    int players = 0;
+    int nextThreshold = 0;
+    int layer = 0;
+    std::string map;
+    std::vector<int> spawn;
+    std::vector<WallGeom> geom;
+    std::vector<uint8_t> beams;     // BeamDetail per spawn entry
+    int cost = 0;
+};
+
+static RoundPlan g_RoundPlan;
+static BpWallBatch g_WallBatch;
+
+static void Budget_Allocate(RoundPlan& plan)
+{
+    int budget = EntityBudget();
+    BpBudgetResult res = BpAllocateBudget(g_Items, plan.spawn, plan.geom, plan.beams, budget);
+    plan.cost = res.cost;
+    if (res.cut)
+    {
+        LogAt(LVL_WARN, LOGC_ROUND, "Entity budget %d exceeded on %s: %d walls with reduced outline, %d props skipped",
+            budget, g_CurrentMap.c_str(), res.degraded, res.skipped);
+    }
+}
+
+static void BuildRoundPlan()
+{
+    g_RoundPlan.spawn.clear();
+    g_RoundPlan.geom.clear();
+    g_RoundPlan.players = HumansOnline();
+    g_RoundPlan.map = g_CurrentMap;
+    g_RoundPlan.revision = g_ItemsRevision;
+
+    RebuildThresholdOrder();
+    size_t first = FirstAboveThreshold(g_RoundPlan.players);
+    g_RoundPlan.spawn.reserve(g_ThresholdOrder.size() - first);
+    size_t walls = 0;
+    for (size_t k = first; k < g_ThresholdOrder.size(); ++k)
+    {
+        int i = g_ThresholdOrder[k];
+        const BPItem& it = g_Items[i];
+        if (!ItemInProfile(it))
+        {
+            continue;
+        }
+        walls += it.isWall && it.points.empty();
+        g_RoundPlan.spawn.push_back(i);
+    }
+
+    // Box wall geometry for the whole plan in one batch; polylines are
+    // compiled one by one.
+    g_RoundPlan.geom.resize(g_RoundPlan.spawn.size());
+    g_WallBatch.Resize(walls);
+    for (size_t k = 0, w = 0; k < g_RoundPlan.spawn.size(); ++k)
+    {
+        const BPItem& it = g_Items[g_RoundPlan.spawn[k]];
+        if (it.isWall && it.points.empty())
+        {
+            g_WallBatch.Set(w++, it.pos, it.pos2, it.wallYaw);
+        }
+        else if (it.isWall)
+        {
+            BpComputeItemGeom(it, g_RoundPlan.geom[k]);
+        }
+    }
+    g_WallBatch.Compute();
+    for (size_t k = 0, w = 0; k < g_RoundPlan.spawn.size(); ++k)
+    {
+        const BPItem& it = g_Items[g_RoundPlan.spawn[k]];
+        if (it.isWall && it.points.empty())
+        {
+            g_WallBatch.Get(w++, g_RoundPlan.geom[k]);
+        }
+    }
+    Budget_Allocate(g_RoundPlan);
+    g_RoundPlan.open = g_RoundPlan.spawn.empty();
+    g_RoundPlan.nextThreshold = g_RoundPlan.open ? 0 : ItemThreshold(g_Items[g_RoundPlan.spawn[0]]);
+    g_RoundPlan.layer = g_ActiveLayer;
+    g_RoundPlan.ready = true;
+    Dbg("BuildRoundPlan: map=%s players=%d spawn=%d next=%d", g_RoundPlan.map.c_str(), g_RoundPlan.players,
+        (int)g_RoundPlan.spawn.size(), g_RoundPlan.nextThreshold);
+}
+
+// The plan is built at round_end, so players may join or leave before the
+// round restarts. It stays valid while the live count falls in the same
+// threshold tier; the count itself is refreshed for UpdatePlayerTier.
+static bool RoundPlanValid()
+{
+    if (!g_RoundPlan.ready || g_RoundPlan.map != g_CurrentMap || g_RoundPlan.revision != g_ItemsRevision ||
+        g_RoundPlan.layer != g_ActiveLayer)
+    {
+        return false;
+    }
+    int now = HumansOnline();
+    if (now != g_RoundPlan.players)
+    {
+        RebuildThresholdOrder();
+        if (FirstAboveThreshold(now) != FirstAboveThreshold(g_RoundPlan.players))
+        {
+            return false;
+        }
+        g_RoundPlan.players = now;
+    }
+    return true;
+}
+
+static void ApplyRoundPlan()
+{
+    ScopedPhase sp(PH_APPLY_PLAN);
+    for (size_t k = 0; k < g_RoundPlan.spawn.size(); ++k)
+    {
+        int i = g_RoundPlan.spawn[k];
+        if (i < 0 || i >= (int)g_Items.size())
+        {
+            continue;
+        }
+        LiveEnt le;
+        le.index = i;
+        if (SpawnLiveEntry(i, le, &g_RoundPlan.geom[k], g_RoundPlan.beams[k]))
+        {
+            Live_Push(std::move(le));
+        }
+        else
+        {
+            Dbg("ApplyRoundPlan: spawn failed for %d", i);
+        }
+    }
+    g_RoundPlan.ready = false;
+    g_LivePlayerCount = g_RoundPlan.players;
+
+    g_bMeasureSolid = true;
+    if (g_nPendingSolid == 0)
+    {
+        NoteBlockerSolid();
+    }
+}
+
+void SaveData()
+{
+    ScopedPhase sp(PH_SAVE_DATA);
+    const char* path = "addons/data/bp_data.ini";
+
+    // Other maps' layouts are merged from the file; one that is there but
+    // oversized, unreadable or does not parse is left untouched rather than
+    // overwritten with only what could be read of it.
+    BpKv root("BPData");
+    if (!KvLoadFile(&root, path) && g_Backend->FileSize(path) > 0)
+    {
+        ConPrint(CON_ERROR, "[BlockerPasses] %s not rewritten; the changes to %s are not saved\n", path,
+            g_CurrentMap.c_str());
+        return;
+    }
+
+    if (BpKv* old = root.FindKey(g_CurrentMap.c_str(), false))
+    {
+        root.RemoveSubKey(old);
+    }
+
+    BpKv* mapKV = root.FindKey(g_CurrentMap.c_str(), true);
+    if (g_MapBudget >= 0)
+    {
+        mapKV->SetInt("budget", g_MapBudget);
+    }
+    if (g_LayerNames.size() > 1)
+    {
+        BpKv* layersKV = mapKV->FindKey("layers", true);
+        for (int i = 0; i < (int)g_LayerNames.size(); ++i)
+        {
+            char key[16];
+            snprintf(key, sizeof(key), "%d", i);
+            layersKV->SetString(key, g_LayerNames[i].c_str());
+        }
+    }
+    std::vector<const BPItem*> list;
+    BpCollapsePrefabs(g_Items, g_Instances, g_Prefabs, list);
+    for (const BPItem* it : list)
+    {
+        BpKv* k = mapKV->CreateNewKey();
+        k->SetName("item");
+        BpWriteItem(k, *it);
+    }
+    KvSaveFile(&root, path);
+    ++g_ItemsRevision;
+    Dbg("Saved %d items for map %s", (int)g_Items.size(), g_CurrentMap.c_str());
+}
+
+static void SelectProfileLayer()
+{
+    int layer = FindLayer(g_ProfileSetting.c_str());
+    if (layer < 0)
+    {
+        Dbg("Profile '%s' not defined for map %s, using '%s'", g_ProfileSetting.c_str(), g_CurrentMap.c_str(), g_LayerNames[0].c_str());
+        layer = 0;
+    }
+    g_ActiveLayer = layer;
+}
+
+// One item as read from the data file or a built-in layout: instances are
+// expanded through their prefab, unusable items dropped.
+static void AddLoadedItem(BPItem& it, int& unknown)
+{
+    if (BpInstanceUsable(it))
+    {
+        int group = (int)g_Instances.size();
+        if (const Prefab* pf = BpFindPrefab(g_Prefabs, it.prefab))
+        {
+            BpExpandPrefab(*pf, it, group, g_Items);
+        }
+        else
+        {
+            ++unknown;
+        }
+        g_Instances.push_back(std::move(it));
+    }
+    else if (BpItemUsable(it))
+    {
+        g_Items.push_back(std::move(it));
+    }
+}
+
+static void WarnUnknownPrefabs(int unknown)
+{
+    if (unknown)
+    {
+        LogAt(LVL_WARN, LOGC_MAP, "%d prefab instances on %s name prefabs settings.ini does not define; they are kept but not spawned",
+            unknown, g_CurrentMap.c_str());
+    }
+}
+
+// The layout compiled in for the current map (Builtin.h), used when the data
+// file has nothing for it. False if there is none.
+static bool LoadBuiltinLayout()
+{
+    const BpBuiltinMap* bm = BpFindBuiltin(g_CurrentMap.c_str());
+    if (!bm)
+    {
+        return false;
+    }
+    g_MapBudget = bm->budget;
+    if (bm->numLayers > 0)
+    {
+        g_LayerNames.clear();
+        for (int i = 0; i < bm->numLayers && i < BP_MAX_LAYERS; ++i)
+        {
+            g_LayerNames.push_back(bm->layers[i]);
+        }
+    }
+    SelectProfileLayer();
+
+    int unknown = 0;
+    for (int i = 0; i < bm->numItems; ++i)
+    {
+        BPItem it;
+        BpBuiltinItemTo(*bm, bm->items[i], it);
+        AddLoadedItem(it, unknown);
+    }
+    WarnUnknownPrefabs(unknown);
+    Dbg("Using built-in layout for %s (%d items, %d prefab instances)", g_CurrentMap.c_str(), (int)g_Items.size(), (int)g_Instances.size());
+    return true;
+}
+
+static void LoadDataForMap(const char* map)
+{
+    ScopedPhase sp(PH_LOAD_DATA);
+    if (map && *map)
+    {
+        g_CurrentMap = BpNormalizeMapName(map);
+    }
+
+    g_Items.clear();
+    g_Instances.clear();
+    ClearLive(true);
+    g_Net.byItem.clear();
+    ++g_ItemsRevision;
+    g_LayerNames.assign(1, "default");
+    g_ActiveLayer = 0;
+    g_MapBudget = -1;
+
+    BpKv root("BPData");
+    if (!KvLoadFile(&root, "addons/data/bp_data.ini"))
+    {
+        if (!LoadBuiltinLayout())
+        {
+            Dbg("No data file yet for map %s", g_CurrentMap.c_str());
+            SelectProfileLayer();
+        }
+        return;
+    }
+    BpKv* mapKV = root.FindKey(g_CurrentMap.c_str(), false);
+    if (!mapKV)
+    {
+        if (!LoadBuiltinLayout())
+        {
+            Dbg("No section for map %s", g_CurrentMap.c_str());
+            SelectProfileLayer();
+        }
+        return;
+    }
+
+    g_MapBudget = mapKV->GetInt("budget", -1);
+    if (BpKv* layersKV = mapKV->FindKey("layers", false))
+    {
+        g_LayerNames.clear();
+        for (BpKv* l = layersKV->GetFirstValue(); l && (int)g_LayerNames.size() < BP_MAX_LAYERS; l = l->GetNextValue())
+        {
+            g_LayerNames.push_back(l->GetString());
+        }
+        if (g_LayerNames.empty())
+        {
+            g_LayerNames.push_back("default");
+        }
+    }
+    SelectProfileLayer();
+
+    int unknown = 0;
+    for (BpKv* k = mapKV->GetFirstTrueSubKey(); k; k = k->GetNextTrueSubKey())
+    {
+        if (!BpStricmp(k->GetName(), "layers"))
+        {
+            continue;
+        }
+        BPItem it;
+        BpReadItem(k, it);
+        AddLoadedItem(it, unknown);
+    }
+    WarnUnknownPrefabs(unknown);
+    Dbg("Loaded %d items (%d prefab instances) for map %s", (int)g_Items.size(), (int)g_Instances.size(), g_CurrentMap.c_str());
+}
+
+// Patterns from the "signatures" section of settings.ini, by signature
+// name; the resolver tries them before the built-in ones.
+std::map<std::string, std::vector<std::string>> g_SigExtra;
+
+static void Sig_ReadSettings(const BpKv* kv)
+{
+    g_SigExtra.clear();
+    BpKv* sigs = kv ? const_cast<BpKv*>(kv)->FindKey("signatures", false) : nullptr;
+    if (!sigs)
+    {
+        return;
+    }
+    for (BpKv* list = sigs->GetFirstTrueSubKey(); list; list = list->GetNextTrueSubKey())
+    {
+        for (BpKv* v = list->GetFirstValue(); v; v = v->GetNextValue())
+        {
+            const char* pat = v->GetString();
+            if (pat && *pat)
+            {
+                g_SigExtra[list->GetName()].push_back(pat);
+            }
+        }
+    }
+}
+
+// Re-reads only the "signatures" section for mm_bp_sig rescan; the rest of
+// settings.ini, the revision and the logger are left alone.
+void Sig_ReloadPatterns()
+{
+    BpKv kv("BlockerPasses");
+    bool ok = KvLoadFile(&kv, "addons/configs/BlockerPasses/settings.ini");
+    Sig_ReadSettings(ok ? &kv : nullptr);
+}
+
+void LoadSettings()
+{
+    BpKv kv("BlockerPasses");
+    if (!KvLoadFile(&kv, "addons/configs/BlockerPasses/settings.ini"))
+    {
+        g_MinPlayersToOpen = 10;
+        g_AccessPermission = "@admin/bp";
+        g_AccessFlag = "";
+        g_DebugLog = true;
+        g_LogLevel = LVL_DEBUG;
+        g_LogCatMask = 0xFFFFFFFFu;
+        g_bIgnoreSpectators = true;
+        g_bIdleMode = true;
+        g_bStatsDump = false;
+        g_bReloadHandoff = false;
+        g_EntityBudget = 0;
+        g_ChatCommand = "!bp";
+        g_ConCmdBp = "mm_bp";
+        g_ConCmdAccess = "mm_bp_access";
+        g_ConCmdProfile = "mm_bp_profile";
+        if (!g_bProfileForced)
+        {
+            g_ProfileSetting = "default";
+        }
+
+        g_ModelDefs.clear();
+        g_ModelDefs.push_back({"Желзеные двери", "models/props/de_dust/hr_dust/dust_windows/dust_rollupdoor_96x128_surface_lod.vmdl"});
+        g_ModelDefs.push_back({"Желзеный забор", "models/props/de_nuke/hr_nuke/chainlink_fence_001/chainlink_fence_001_256_capped.vmdl"});
+        g_Prefabs.clear();
+        Dbg("Settings not found, using defaults");
+        return;
+    }
+
+    g_MinPlayersToOpen = kv.GetInt("min_players_to_open", 10);
+    ++g_ItemsRevision;
+    g_AccessPermission = kv.GetString("access_permission", "@admin/bp");
+    g_AccessFlag = kv.GetString("access_flag", "");
+    g_DebugLog = kv.GetInt("debug_log", 1) != 0;
+    g_LogLevel = g_DebugLog ? LVL_DEBUG : LVL_INFO;
+    Log_ParseLevel(kv.GetString("log_level", ""), g_LogLevel);
+    g_LogCatMask = Log_ParseCategories(kv.GetString("log_categories", "all"));
+    bool toFile = !BpStricmp(kv.GetString("log_target", "console"), "file");
+    if (toFile != g_bLogToFile)
+    {
+        g_bLogToFile = toFile;
+        Log_Start();
+    }
+    g_bIgnoreSpectators = kv.GetInt("ignore_spectators", 1) != 0;
+    g_bIdleMode = kv.GetInt("idle_mode", 1) != 0;
+    g_bStatsDump = kv.GetInt("stats_dump", 0) != 0;
+    g_bReloadHandoff = kv.GetInt("reload_handoff", 0) != 0;
+    g_EntityBudget = kv.GetInt("entity_budget", 0);
+    g_ChatCommand = kv.GetString("chat_command", "!bp");
+    g_ConCmdBp = kv.GetString("console_cmd_bp", "mm_bp");
+    g_ConCmdAccess = kv.GetString("console_cmd_access", "mm_bp_access");
+    g_ConCmdProfile = kv.GetString("console_cmd_profile", "mm_bp_profile");
+    if (!g_bProfileForced)
+    {
+        g_ProfileSetting = kv.GetString("profile", "default");
+    }
+
+    Sig_ReadSettings(&kv);
+
+    g_ModelDefs.clear();
+    if (BpKv* models = kv.FindKey("models", false))
+    {
+        for (BpKv* m = models->GetFirstTrueSubKey(); m; m = m->GetNextTrueSubKey())
+        {
+            const char* label = m->GetString("label", "");
+            const char* path = m->GetString("path", "");
+            if (path && *path)
+            {
+                ModelDef md;
+                md.path = path;
+                md.label = (label && *label) ? label : path;
+                g_ModelDefs.push_back(std::move(md));
+            }
+        }
+    }
+
+    if (g_ModelDefs.empty())
+    {
+        Dbg("No models in settings.ini -> nothing to place");
+    }
+
+    BpReadPrefabs<BpKv>(&kv, g_Prefabs);
+
+    Dbg("Settings: min_players_to_open=%d, debug=%d, perm='%s', flag='%s', chat='%s', concmd='%s', concmd_access='%s', models=%d, prefabs=%d",
+        g_MinPlayersToOpen, (int)g_DebugLog, g_AccessPermission.c_str(), g_AccessFlag.c_str(),
+        g_ChatCommand.c_str(), g_ConCmdBp.c_str(), g_ConCmdAccess.c_str(), (int)g_ModelDefs.size(), (int)g_Prefabs.size());
+}
+
+static void OpenModelMenu(int slot);
+static void OpenPrefabMenu(int slot);
+static void OpenMainMenu(int slot);
+static void OpenEditListMenu(int slot, bool all = false);
+void OpenItemMenu(int slot, int index);
+static void OpenMoveMenu(int slot, int index);
+static void OpenRotateSubMenu(int slot, int index);
+static void OpenScaleMenu(int slot, int index);
+static void OpenBeamColorMenu(int slot, int index);
+static void OpenWallRotateMenu(int slot, int index);
+static void OpenWallMoveMenu(int slot, int index);
+static void OpenWallScaleMenu(int slot, int index);
+static void OpenItemColorMenu(int slot, int index);
+static void OpenThresholdMenu(int slot, int index);
+static void OpenLayersMenu(int slot, int index);
+static void OpenPolyWallMenu(int slot);
+
+static const float PICK_PAST_HIT = 16.0f;      // trace ends on a surface; boxes just behind it still count
+static const float EDIT_LIST_RADIUS = 1500.0f;
+
+// Live item whose box the eye ray enters first, up to just past the trace
+// hit; failing that the live item nearest the hit within 'maxDist'.
+static int FindItemByCrosshair(int slot, float maxDist = 128.0f)
+{
+    BpVec eye, hit;
+    if (!g_Backend->RayTrace(slot, eye, hit))
+    {
+        return -1;
+    }
+    g_PickIndex.Sync(g_Items, g_ItemsRevision);
+    auto isLive = [](int i) { return LiveSlot(i) >= 0; };
+
+    BpVec dir = hit - eye;
+    float len = sqrtf(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+    if (len > 1.0f)
+    {
+        dir = BpVec(dir.x / len, dir.y / len, dir.z / len);
+        int idx = g_PickIndex.Pick(eye, dir, len + PICK_PAST_HIT, isLive);
+        if (idx >= 0)
+        {
+            return idx;
+        }
+    }
+    std::vector<std::pair<float, int>> nearby;
+    g_PickIndex.Within(hit, maxDist, isLive, nearby);
+    return nearby.empty() ? -1 : nearby[0].second;
+}
+
+static void EnsureCorrectMapLoaded_Internal()
+{
+    const char* raw = g_Backend->MapName();
+    if (!raw || !*raw || !IsValidMapName(raw))
+    {
+        Dbg("EnsureCorrectMapLoaded: invalid/corrupted map name, keeping '%s'", g_CurrentMap.c_str());
+        return;
+    }
+    std::string realMap = BpNormalizeMapName(raw);
+    if (realMap.empty())
+    {
+        return;
+    }
+    if (g_CurrentMap != realMap)
+    {
+        Dbg("EnsureCorrectMapLoaded: Map changed: '%s' -> '%s'", g_CurrentMap.c_str(), realMap.c_str());
+        g_TempAccessSteamIDs.clear();
+        LoadSettings();
+        LoadPhrases();
+        LoadDataForMap(realMap.c_str());
+    }
+    else
+    {
+        Dbg("EnsureCorrectMapLoaded: map='%s' (no change)", g_CurrentMap.c_str());
+    }
+}
+
+static void EnsureCorrectMapLoaded(int retries = 3);
+
+static void EnsureCorrectMapLoaded(int retries)
+{
+    const char* raw = g_Backend->MapName();
+
+    if (raw && *raw && IsValidMapName(raw))
+    {
+        EnsureCorrectMapLoaded_Internal();
+        return;
+    }
+
+    if (retries > 0)
+    {
+        int left = retries - 1;
+        Dbg("EnsureCorrectMapLoaded: corrupted map name, retrying (%d left)...", left);
+        Sched_Add("map_check_retry", 0.25f, SCOPE_MAP, [left]() -> float {
+            EnsureCorrectMapLoaded(left);
+            return -1.0f;
+        });
+    }
+    else
+    {
+        Dbg("EnsureCorrectMapLoaded: retries exhausted, keeping current map '%s'", g_CurrentMap.c_str());
+    }
+}
+
+static bool HasBpAccess(int slot)
+{
+    if (slot >= 0 && slot < 64 && g_Backend->IsInGame(slot))
+    {
+        uint64_t sid = g_Backend->SteamID(slot);
+        if (sid && g_TempAccessSteamIDs.count(sid))
+        {
+            return true;
+        }
+    }
+    if (!g_AccessPermission.empty())
+    {
+        return g_Backend->HasPermission(slot, g_AccessPermission.c_str());
+    }
+    if (!g_AccessFlag.empty())
+    {
+        return g_Backend->HasFlag(slot, g_AccessFlag.c_str());
+    }
+    return false;
+}
+
+bool OnBpCmd(int slot, const char* args)
+{
+    RecEntry rec(REC_COMMAND, slot, args && *args ? args : g_ConCmdBp.c_str());
+    if (!HasBpAccess(slot))
+    {
+        PrintChatKey(slot, "Chat_NoAccess", "{RED}Нет доступа к {DEFAULT}!bp{RED}.");
+        return true;
+    }
+
+    OpenMainMenu(slot);
+    return true;
+}
+
+static void OnMapStart_Retry(int retries);
+
+void OnMapStart(const char* map)
+{
+    RecEntry rec(REC_MAP_START, -1, map);
+    Sched_CancelScope(SCOPE_MAP);
+    Sched_ResetDriver();
+    g_TempAccessSteamIDs.clear();
+    LoadSettings();
+    LoadPhrases();
+    if (!g_Backend->HasCollisionBounds())
+    {
+        ConPrint(CON_ERROR, "[BlockerPasses] SetCollisionBounds is unresolved, walls won't block. Add a pattern to settings.ini \"signatures\" and run mm_bp_sig rescan\n");
+    }
+
+    const char* realMap = g_Backend->MapName();
+    if (!realMap || !*realMap || !IsValidMapName(realMap))
+    {
+        realMap = map;
+    }
+    if (!realMap || !*realMap || !IsValidMapName(realMap))
+    {
+        Dbg("OnMapStart: no valid map name from either source, scheduling retry...");
+        OnMapStart_Retry(5);
+        return;
+    }
+    Dbg("OnMapStart: raw='%s' globals='%s'", map ? map : "(null)", realMap ? realMap : "(null)");
+    LoadDataForMap(realMap);
+}
+
+static void OnMapStart_Retry(int retries)
+{
+    if (retries <= 0)
+    {
+        Dbg("OnMapStart_Retry: retries exhausted, keeping current map '%s'", g_CurrentMap.c_str());
+        return;
+    }
+    Sched_Add("map_start_retry", 0.3f, SCOPE_MAP, [retries]() -> float {
+        const char* raw = g_Backend->MapName();
+        if (raw && *raw && IsValidMapName(raw))
+        {
+            std::string realMap = BpNormalizeMapName(raw);
+            Dbg("OnMapStart_Retry: got valid map '%s'", realMap.c_str());
+            LoadDataForMap(realMap.c_str());
+        }
+        else
+        {
+            Dbg("OnMapStart_Retry: still invalid, %d retries left", retries - 1);
+            OnMapStart_Retry(retries - 1);
+        }
+        return -1.0f;
+    });
+}
+
+void OnMapEnd()
+{
+    RecEntry rec(REC_MAP_END);
+    if (g_bStatsDump)
+    {
+        Stats_DumpPrometheus(g_CurrentMap.c_str());
+    }
+    Sched_CancelScope(SCOPE_MAP);
+    Sched_ResetDriver();
+    ClearLive(true);
+    g_RoundPlan.ready = false;
+    g_nPendingSolid = 0;
+    g_bMeasureSolid = false;
+    // Spans captured so far are written now; tracing resumes on the next
+    // map's round_start while rounds remain.
+    Trace_Flush();
+}
+
+static inline void TeleportLive(int index);
+static void RespawnWallLive(int index);
+
+// Moves wall 'index' by 'offset', polyline points included.
+static void ShiftWall(int index, const BpVec& offset)
+{
+    BPItem& it = g_Items[index];
+    it.pos += offset;
+    it.pos2 += offset;
+    for (BpVec& p : it.points)
+    {
+        p += offset;
+    }
+}
+
+static void AddNewWall(int slot, const BPItem& it)
+{
+    int newIndex = (int)g_Items.size();
+    g_Items.push_back(it);
+    SaveData();
+
+    LiveEnt le;
+    le.index = newIndex;
+    SpawnLiveEntry(newIndex, le);
+    Live_Push(std::move(le));
+
+    PrintChatKey(slot, "Chat_WallCreated", "Стена создана!");
+    OpenItemMenu(slot, newIndex);
+}
+
+// player_ping: 'iSlot' is the event's userid.
+void OnPlayerPing(int iSlot, const BpVec& pingPos)
+{
+    if (iSlot < 0 || iSlot >= 64)
+    {
+        return;
+    }
+    RecEntry rec(REC_PLAYER_PING, iSlot, nullptr, nullptr, 0, &pingPos);
+    if (g_ePingMode[iSlot] == PING_NONE)
+    {
+        return;
+    }
+
+    if (g_ePingMode[iSlot] == PING_TELEPORT)
+    {
+        int iIndex = g_iPingTargetIndex[iSlot];
+        if (iIndex < 0 || iIndex >= (int)g_Items.size())
+        {
+            g_ePingMode[iSlot] = PING_NONE;
+            return;
+        }
+
+        if (g_Items[iIndex].isWall)
+        {
+            BpVec center = (g_Items[iIndex].pos + g_Items[iIndex].pos2) * 0.5f;
+            ShiftWall(iIndex, pingPos - center);
+            RespawnWallLive(iIndex);
+        }
+        else
+        {
+            g_Items[iIndex].pos = pingPos;
+            TeleportLive(iIndex);
+            MakeLiveIfMissing(iIndex);
+        }
+        SaveData();
+        g_ePingMode[iSlot] = PING_NONE;
+        OpenItemMenu(iSlot, iIndex);
+        return;
+    }
+
+    if (g_ePingMode[iSlot] == PING_WALL_POS1)
+    {
+        g_vWallTempPos[iSlot] = pingPos;
+        g_ePingMode[iSlot] = PING_WALL_POS2;
+        PrintChatKey(iSlot, "Chat_WallPos2", "Теперь поставьте вторую точку пингом (колёсико мышки)");
+        return;
+    }
+
+    if (g_ePingMode[iSlot] == PING_WALL_POS2)
+    {
+        g_ePingMode[iSlot] = PING_NONE;
+
+        BPItem it;
+        it.label = "Стена";
+        it.path = "";
+        it.isWall = true;
+        it.pos = g_vWallTempPos[iSlot];
+        it.pos2 = pingPos;
+        it.scale = 1.0f;
+        it.invisible = false;
+        AddNewWall(iSlot, it);
+        return;
+    }
+
+    if (g_ePingMode[iSlot] == PING_POLY)
+    {
+        std::vector<BpVec>& pts = g_PolyPoints[iSlot];
+        if ((int)pts.size() >= BP_POLY_MAX_POINTS)
+        {
+            PrintChatKey(iSlot, "Chat_PolyFull", "Не больше %d точек", BP_POLY_MAX_POINTS);
+        }
+        else
+        {
+            pts.push_back(pingPos);
+            PrintChatKey(iSlot, "Chat_PolyPoint", "Точка %d поставлена", (int)pts.size());
+        }
+        OpenPolyWallMenu(iSlot);
+        return;
+    }
+}
+
+// Runs on round_end; 'szName' is the event name.
+void OnRoundPrepare(const char* szName)
+{
+    RecEntry rec(REC_ROUND_PREPARE);
+    EnsureCorrectMapLoaded();
+    BuildRoundPlan();
+    Dbg("%s: next round plan ready", szName);
+}
+
+void OnRoundStart()
+{
+    RecEntry rec(REC_ROUND_START);
+    Trace_OnRoundStart();
+    Net_OnRoundStart();
+    ScopedPhase sp(PH_ROUND_START);
+    g_flRoundStartTime = g_Backend->Time();
+    Sched_CancelScope(SCOPE_ROUND);
+    g_nPendingSolid = 0;
+    ClearLive(true);
+    for (int i = 0; i < 64; ++i)
+    {
+        g_ePingMode[i] = PING_NONE;
+        g_iPingTargetIndex[i] = -1;
+        g_PolyPoints[i].clear();
+    }
+    if (!RoundPlanValid())
+    {
+        EnsureCorrectMapLoaded();
+        BuildRoundPlan();
+    }
+    g_bIdle = g_bIdleMode && HumansConnected() == 0;
+    bool open = g_RoundPlan.open;
+    int nextThreshold = g_RoundPlan.nextThreshold;
+    ApplyRoundPlan();
+    if (!open)
+    {
+        PrintChatAllKey("Chat_ClosedMsg", "{RED}[BP]{DEFAULT} Проход закрыт. Откроется при {RED}%d{DEFAULT} игроках.", nextThreshold);
+    }
+}
+
+static void UpdatePlayerTier()
+{
+    int now = HumansOnline();
+    int old = g_LivePlayerCount;
+    if (now <= old)
+    {
+        return;
+    }
+    g_LivePlayerCount = now;
+
+    RebuildThresholdOrder();
+    size_t first = FirstAboveThreshold(old);
+    size_t last = FirstAboveThreshold(now);
+    if (first == last)
+    {
+        return;
+    }
+
+    // Only the items whose threshold lies in (old, now] open.
+    int opened = Live_Destroy(&g_ThresholdOrder[first], last - first);
+    Dbg("UpdatePlayerTier: players %d -> %d, opened %d items", old, now, opened);
+}
+
+static TaskToken g_RestoreTask = 0;
+static const int IDLE_RESTORE_BUDGET = 4;
+
+static void EnterIdle()
+{
+    g_bIdle = true;
+    Sched_Cancel(g_RestoreTask);
+    Sched_Cancel(g_RainbowTask);
+    g_bRainbowTimerActive = false;
+    int removed = 0;
+    for (auto& le : g_Live)
+    {
+        removed += (int)le.beams.size();
+        RemoveLiveBeams(le);
+    }
+    Dbg("Idle: no humans connected, removed %d beams", removed);
+}
+
+static void LeaveIdle()
+{
+    g_bIdle = false;
+    Sched_Cancel(g_RestoreTask);
+    size_t cursor = 0;
+    g_RestoreTask = Sched_Add("idle_restore", 0.0f, SCOPE_ROUND, [cursor]() mutable -> float {
+        int budget = IDLE_RESTORE_BUDGET;
+        for (; cursor < g_Live.size() && budget > 0; ++cursor)
+        {
+            LiveEnt& le = g_Live[cursor];
+            if (le.index < 0 || le.index >= (int)g_Items.size() || !g_Items[le.index].isWall || !le.beams.empty())
+            {
+                continue;
+            }
+            const BPItem& it = g_Items[le.index];
+            WallGeom geom;
+            BpComputeItemGeom(it, geom);
+            ScopedOwner owner(le.index);
+            le.beams = DrawWireframe(geom, it.beamR, it.beamG, it.beamB, it.beamRainbow, 1.0f, le.beamDetail);
+            Registry_Own(le);
+            if (it.beamRainbow)
+            {
+                StartRainbowTimer();
+            }
+            --budget;
+        }
+        if (cursor < g_Live.size())
+        {
+            return 0.0f;
+        }
+        g_RestoreTask = 0;
+        Dbg("Idle: visuals restored");
+        return -1.0f;
+    });
+}
+
+static void UpdateIdleState()
+{
+    bool empty = g_bIdleMode && HumansConnected() == 0;
+    if (empty && !g_bIdle)
+    {
+        EnterIdle();
+    }
+    else if (!empty && g_bIdle)
+    {
+        LeaveIdle();
+    }
+}
+
+// The work runs a frame later, once the team change has landed; that is the
+// entry point recorded for replay.
+// The player counts settle after the event: a joining player's team, a
+// leaving one's slot. 'kind' is RPE_TEAM or RPE_CONNECT_FULL (or
+// RPE_DISCONNECT for PlayerCountChanged).
+void PlayerCountChanged(int slot, int kind)
+{
+    RecEntry rec(REC_PLAYER_EVENT, slot, nullptr, nullptr, kind);
+    UpdateIdleState();
+    if (kind != RPE_DISCONNECT)
+    {
+        UpdatePlayerTier();
+    }
+}
+
+void OnPlayerCount(int slot, int kind)
+{
+    Sched_Add("player_tier", 0.0f, SCOPE_MAP, [slot, kind]() -> float {
+        PlayerCountChanged(slot, kind);
+        return -1.0f;
+    });
+}
+
+void OnPlayerDisconnect(int slot)
+{
+    Sched_Add("idle_check", 1.0f, SCOPE_MAP, [slot]() -> float {
+        PlayerCountChanged(slot, RPE_DISCONNECT);
+        return -1.0f;
+    });
+}
+
+static void SwitchProfile(int layer)
+{
+    if (layer < 0 || layer >= (int)g_LayerNames.size() || layer == g_ActiveLayer)
+    {
+        return;
+    }
+    RebuildLayerDiffs();
+    const LayerDiff& d = g_LayerDiffs[g_ActiveLayer * (int)g_LayerNames.size() + layer];
+    g_ActiveLayer = layer;
+
+    Live_Destroy(d.remove.data(), d.remove.size());
+    for (int i : d.spawn)
+    {
+        MakeLiveIfMissing(i);
+    }
+    Dbg("SwitchProfile: '%s' (+%d -%d)", g_LayerNames[layer].c_str(), (int)d.spawn.size(), (int)d.remove.size());
+}
+
+bool OnProfileCmd(int slot, const char* args)
+{
+    RecEntry rec(REC_COMMAND, slot, args && *args ? args : g_ConCmdProfile.c_str());
+    if (slot >= 0 && !HasBpAccess(slot))
+    {
+        PrintChatKey(slot, "Chat_NoAccess", "{RED}Нет доступа к {DEFAULT}!bp{RED}.");
+        return true;
+    }
+
+    char buf[128];
+    BpStrncpy(buf, args ? args : "", sizeof(buf));
+    char* tok = strtok(buf, " ");
+    if (tok)
+    {
+        tok = strtok(nullptr, " ");
+    }
+    if (!tok || !*tok)
+    {
+        std::string list;
+        for (int i = 0; i < (int)g_LayerNames.size(); ++i)
+        {
+            if (i)
+            {
+                list += ", ";
+            }
+            list += g_LayerNames[i];
+        }
+        if (slot >= 0)
+        {
+            PrintChat(slot, "Profile: {GREEN}%s{DEFAULT} (%s)", g_LayerNames[g_ActiveLayer].c_str(), list.c_str());
+        }
+        else
+        {
+            ConPrint(CON_USAGE, "[BlockerPasses] Profile: %s (%s). Usage: %s <name>\n",
+                g_LayerNames[g_ActiveLayer].c_str(), list.c_str(), g_ConCmdProfile.c_str());
+        }
+        return true;
+    }
+
+    g_ProfileSetting = tok;
+    g_bProfileForced = true;
+
+    int layer = FindLayer(tok);
+    if (layer < 0)
+    {
+        // A " could not be saved: bp_data.ini strings have no escapes.
+        if (g_CurrentMap.empty() || (int)g_LayerNames.size() >= BP_MAX_LAYERS || strchr(tok, '"'))
+        {
+            ConPrint(CON_ERROR, "[BlockerPasses] Cannot create profile '%s'\n", tok);
+            return true;
+        }
+        g_LayerNames.push_back(tok);
+        layer = (int)g_LayerNames.size() - 1;
+        SaveData();
+    }
+    SwitchProfile(layer);
+
+    if (slot >= 0)
+    {
+        PrintChat(slot, "Profile: {GREEN}%s", g_LayerNames[g_ActiveLayer].c_str());
+    }
+    else
+    {
+        ConPrint(CON_OK, "[BlockerPasses] Profile: %s\n", g_LayerNames[g_ActiveLayer].c_str());
+    }
+    return true;
+}
+
+static const char* HANDOFF_PATH = "addons/data/bp_handoff.ini";
+static const int HANDOFF_MAX_AGE = 120;
+
+void Handoff_Save()
+{
+    BpKv root("BPHandoff");
+    root.SetInt("time", (int)time(nullptr));
+    root.SetString("map", g_CurrentMap.c_str());
+    root.SetString("layer", g_LayerNames[g_ActiveLayer].c_str());
+    root.SetInt("players", g_LivePlayerCount);
+    root.SetFloat("hue", g_flRainbowHue);
+    BpKv* access = root.FindKey("access", true);
+    int n = 0;
+    for (uint64_t sid : g_TempAccessSteamIDs)
+    {
+        access->SetString(std::to_string(n++).c_str(), std::to_string((unsigned long long)sid).c_str());
+    }
+    KvSaveFile(&root, HANDOFF_PATH);
+}
+
+// Restores what the previous instance knew about the running round. The
+// file is single-use and ignored when stale or written on another map.
+static bool Handoff_Load()
+{
+    BpKv root("BPHandoff");
+    if (!KvLoadFile(&root, HANDOFF_PATH))
+    {
+        return false;
+    }
+    g_Backend->RemoveFile(HANDOFF_PATH);
+    if ((int)time(nullptr) - root.GetInt("time", 0) > HANDOFF_MAX_AGE || g_CurrentMap != root.GetString("map", ""))
+    {
+        Dbg("Handoff: stale or from another map, ignored");
+        return false;
+    }
+    int layer = FindLayer(root.GetString("layer", ""));
+    if (layer >= 0)
+    {
+        g_ActiveLayer = layer;
+    }
+    g_LivePlayerCount = root.GetInt("players", g_LivePlayerCount);
+    g_flRainbowHue = root.GetFloat("hue", 0.0f);
+    if (BpKv* access = root.FindKey("access", false))
+    {
+        for (BpKv* v = access->GetFirstValue(); v; v = v->GetNextValue())
+        {
+            uint64_t sid = strtoull(v->GetString(), nullptr, 10);
+            if (sid)
+            {
+                g_TempAccessSteamIDs.insert(sid);
+            }
+        }
+    }
+    return true;
+}
+
+static bool HandlesValid(const std::vector<BpEnt>& hs)
+{
+    for (const auto& h : hs)
+    {
+        if (!EntAlive(h))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// One pass over the entity system: entities named by a previous instance
+// are taken over when their item still exists unchanged and should be
+// closed; everything else carrying our prefix is removed.
+static int AdoptEntities()
+{
+    std::vector<uint32_t> hashes(g_Items.size());
+    for (size_t i = 0; i < g_Items.size(); ++i)
+    {
+        hashes[i] = ItemHash(g_Items[i]);
+    }
+
+    std::map<int, LiveEnt> found;
+    int orphans = 0;
+    // Gathered first: removing orphans while the backend walks its entities
+    // would pull them out from under the walk.
+    std::vector<std::pair<BpEnt, std::string>> named;
+    g_Backend->FindByName("bp:", [&named](BpEnt ent, const char* name) {
+        named.emplace_back(ent, name);
+    });
+    for (const auto& en : named)
+    {
+        int item, n;
+        uint32_t hash;
+        char role;
+        if (!ParseEntName(en.second.c_str(), item, hash, role, n))
+        {
+            continue;
+        }
+        BpEnt ent = en.first;
+        bool keep = item >= 0 && item < (int)g_Items.size() && hashes[item] == hash && !ItemShouldBeOpen(item)
+            && !(role == 'b' && g_bIdle) && n >= 0 && n < 256;
+        if (!keep)
+        {
+            if (role == 'c')
+            {
+                KillWallCollision(ent);
+            }
+            else
+            {
+                RemoveEnt(ent);
+            }
+            ++orphans;
+            continue;
+        }
+        Registry_Add(ent, role == 'p' ? ROLE_PROP : (role == 'c' ? ROLE_COLLISION : ROLE_BEAM), item);
+        LiveEnt& le = found[item];
+        le.index = item;
+        if (role == 'p')
+        {
+            le.ent = BpEnt(ent);
+        }
+        else
+        {
+            auto& list = (role == 'c') ? le.wallColls : le.beams;
+            if ((int)list.size() <= n)
+            {
+                list.resize(n + 1);
+            }
+            list[n] = BpEnt(ent);
+        }
+    }
+
+    int adopted = 0;
+    for (int i = 0; i < (int)g_Items.size(); ++i)
+    {
+        if (ItemShouldBeOpen(i))
+        {
+            continue;
+        }
+        auto f = found.find(i);
+        if (f != found.end())
+        {
+            LiveEnt& le = f->second;
+            WallGeom geom;
+            if (g_Items[i].isWall)
+            {
+                BpComputeItemGeom(g_Items[i], geom);
+            }
+            bool complete = g_Items[i].isWall
+                ? (int)le.wallColls.size() == BpWallBoxes(geom) && HandlesValid(le.wallColls) && HandlesValid(le.beams)
+                : EntAlive(le.ent);
+            if (complete)
+            {
+                if (g_Items[i].isWall)
+                {
+                    le.ent = le.wallColls[0];
+                    // An outline trimmed by the entity budget is adopted as is.
+                    int n = (int)le.beams.size();
+                    le.beamDetail = g_bIdle ? Budget_BeamDetail(geom)
+                        : (n >= BpWallBeams(geom, BEAMS_FULL) ? BEAMS_FULL : (n >= BpWallBeams(geom, BEAMS_EDGES) ? BEAMS_EDGES : BEAMS_NONE));
+                    if (g_Items[i].beamRainbow && !g_bIdle)
+                    {
+                        StartRainbowTimer();
+                    }
+                }
+                Live_Push(std::move(le));
+                ++adopted;
+                continue;
+            }
+            DestroyLiveEntry(le);
+        }
+        LiveEnt le;
+        le.index = i;
+        if (SpawnLiveEntry(i, le))
+        {
+            Live_Push(std::move(le));
+        }
+    }
+    Dbg("AdoptEntities: adopted=%d orphans_removed=%d live=%d", adopted, orphans, (int)g_Live.size());
+    return adopted;
+}
+
+void LateLoad()
+{
+    double t0 = BpClock();
+    const char* raw = g_Backend->MapName();
+    if (!raw || !*raw || !IsValidMapName(raw))
+    {
+        Dbg("LateLoad: no map yet, waiting for OnMapStart");
+        return;
+    }
+    LoadDataForMap(raw);
+    g_LivePlayerCount = HumansOnline();
+    bool handoff = Handoff_Load();
+    g_bIdle = g_bIdleMode && HumansConnected() == 0;
+    int adopted = AdoptEntities();
+    ConPrint(CON_OK, "[BlockerPasses] Late load on %s: adopted %d, live %d%s (%.2f ms)\n",
+        g_CurrentMap.c_str(), adopted, (int)g_Live.size(), handoff ? ", state handed over" : "", (BpClock() - t0) * 1000.0);
+}
+
+static inline void TeleportLive(int index)
+{
+    if (g_Items[index].isWall)
+    {
+        return;
+    }
+    for (auto& le : g_Live)
+    {
+        if (le.index == index && EntAlive(le.ent))
+        {
+            TeleportEnt(le.ent, &g_Items[index].pos, &g_Items[index].ang);
+            return;
+        }
+    }
+}
+
+static void RespawnWallLive(int index);
+
+void MakeLiveIfMissing(int index)
+{
+    if (LiveSlot(index) >= 0)
+    {
+        return;
+    }
+    if (!ItemShouldBeOpen(index))
+    {
+        LiveEnt le;
+        le.index = index;
+        if (SpawnLiveEntry(index, le))
+        {
+            Live_Push(std::move(le));
+        }
+        else
+        {
+            Dbg("MakeLiveIfMissing: spawn failed for %d", index);
+        }
+    }
+}
+
+void RespawnLive(int index)
+{
+    Live_Destroy(&index, 1);
+
+    if (!ItemShouldBeOpen(index))
+    {
+        LiveEnt le;
+        le.index = index;
+        if (SpawnLiveEntry(index, le))
+        {
+            Live_Push(std::move(le));
+        }
+        else
+        {
+            Dbg("RespawnLive: spawn failed for %d", index);
+        }
+    }
+}
+
+static void RespawnWallLive(int index)
+{
+    RespawnLive(index);
+}
+
+// Walls spawned while SetCollisionBounds was unresolved got only their
+// outline; once it resolves they are respawned with collision boxes.
+int RespawnSolidlessWalls()
+{
+    if (!g_Backend->HasCollisionBounds())
+    {
+        return 0;
+    }
+    std::vector<int> walls;
+    for (const LiveEnt& le : g_Live)
+    {
+        if (le.index >= 0 && le.index < (int)g_Items.size() && g_Items[le.index].isWall && le.wallColls.empty())
+        {
+            walls.push_back(le.index);
+        }
+    }
+    for (int i : walls)
+    {
+        RespawnWallLive(i);
+    }
+    return (int)walls.size();
+}
+
+static inline void ApplyVisualScaleToLive(int index)
+{
+    ScopedNet net(index, NS_RESIZE);
+    for (auto& le : g_Live)
+    {
+        if (le.index != index || !EntAlive(le.ent))
+        {
+            continue;
+        }
+
+        float s = ClampScale(g_Items[index].scale);
+
+        if (g_Backend->SetField(le.ent, NF_BODY_COMPONENT, s))
+        {
+            MarkDirty(le.ent, NF_BODY_COMPONENT);
+            Dbg("ApplyVisualScaleToLive: idx=%d sceneNode scale=%.3f", index, s);
+            return;
+        }
+
+        RespawnLive(index);
+        return;
+    }
+}
+
+static inline void ApplyInvisibilityToLive(int index)
+{
+    ScopedNet net(index, NS_EDIT);
+    for (auto& le : g_Live)
+    {
+        if (le.index != index || !EntAlive(le.ent))
+        {
+            continue;
+        }
+        bool inv = g_Items[index].invisible;
+        ApplyRenderAlpha(le.ent, inv ? 0 : 255);
+        SetNoDraw(le.ent, inv);
+        if (!inv)
+        {
+            ApplyRenderColor(le.ent, g_Items[index].itemR, g_Items[index].itemG, g_Items[index].itemB);
+        }
+        Dbg("ApplyInvisibilityToLive: idx=%d invisible=%d", index, (int)inv);
+        return;
+    }
+}
+
+// Menu callbacks are entry points too; 'menu' names the menu in the trace.
+static void SetMenuCallback(BpMenu& m, const char* menu, BpMenuCallback fn)
+{
+    m.name = menu;
+    m.callback = [menu, fn](const char* back, const char* front, int item, int iSlot) {
+        RecEntry rec(REC_MENU, iSlot, menu, back, item);
+        fn(back, front, item, iSlot);
+    };
+}
+
+static void OpenMainMenu(int slot)
+{
+    BpMenu m;
+    m.title = Phrase("Menu_Title", "BlockerPasses");
+    m.Add("place", Phrase("Menu_Place", "Поставить предмет"));
+    m.Add("prefab", Phrase("Menu_Prefab", "Поставить префаб"));
+    m.Add("wall", Phrase("Menu_Wall", "Создать стену (beam)"));
+    m.Add("polywall", Phrase("Menu_PolyWall", "Создать ломаную стену"));
+    m.Add("edit", Phrase("Menu_Edit", "Редактировать предметы"));
+    char usage[128];
+    if (EntityBudget() > 0)
+    {
+        snprintf(usage, sizeof(usage), "%s: %d / %d", Phrase("Menu_Budget", "Сущности"), EntitiesInUse(), EntityBudget());
+    }
+    else
+    {
+        snprintf(usage, sizeof(usage), "%s: %d", Phrase("Menu_Budget", "Сущности"), EntitiesInUse());
+    }
+    m.Add("budget", usage, false);
+    m.exit = true;
+    SetMenuCallback(m, "main", [](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "place"))
+        {
+            OpenModelMenu(iSlot);
+        }
+        else if (!strcmp(back, "prefab"))
+        {
+            OpenPrefabMenu(iSlot);
+        }
+        else if (!strcmp(back, "wall"))
+        {
+            g_ePingMode[iSlot] = PING_WALL_POS1;
+            PrintChatKey(iSlot, "Chat_WallPos1", "Поставьте первую точку пингом (колёсико мышки)");
+            g_Backend->CloseMenu(iSlot);
+        }
+        else if (!strcmp(back, "polywall"))
+        {
+            g_ePingMode[iSlot] = PING_POLY;
+            g_PolyPoints[iSlot].clear();
+            PrintChatKey(iSlot, "Chat_PolyStart", "Ставьте точки пути пингом (колёсико мышки), затем выберите «Готово»");
+            OpenPolyWallMenu(iSlot);
+        }
+        else if (!strcmp(back, "edit"))
+        {
+            int idx = FindItemByCrosshair(iSlot, 128.0f);
+            if (idx >= 0)
+            {
+                MakeLiveIfMissing(idx);
+                OpenItemMenu(iSlot, idx);
+            }
+            else
+            {
+                OpenEditListMenu(iSlot);
+            }
+        }
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+// Points pinged so far for a polyline wall; each ping reopens this.
+static void OpenPolyWallMenu(int slot)
+{
+    BpMenu m;
+    size_t n = g_PolyPoints[slot].size();
+    char title[128];
+    snprintf(title, sizeof(title), "%s {%zu}", Phrase("Menu_PolyTitle", "Ломаная стена"), n);
+    m.title = title;
+    m.Add("done", Phrase("Menu_PolyDone", "Готово"), n >= 2);
+    m.Add("undo", Phrase("Menu_PolyUndo", "Убрать последнюю точку"), n);
+    m.Add("cancel", Phrase("Menu_PolyCancel", "Отмена"));
+    m.exit = true;
+    SetMenuCallback(m, "poly_wall", [](const char* back, const char*, int, int iSlot) {
+        if (g_ePingMode[iSlot] != PING_POLY)
+        {
+            return;
+        }
+        std::vector<BpVec>& pts = g_PolyPoints[iSlot];
+        if (!strcmp(back, "done") && pts.size() >= 2)
+        {
+            g_ePingMode[iSlot] = PING_NONE;
+            BPItem it;
+            it.label = "Стена";
+            it.isWall = true;
+            it.points.swap(pts);
+            BpPolyRefit(it);
+            AddNewWall(iSlot, it);
+        }
+        else if (!strcmp(back, "undo") && !pts.empty())
+        {
+            pts.pop_back();
+            OpenPolyWallMenu(iSlot);
+        }
+        else if (!strcmp(back, "cancel"))
+        {
+            g_ePingMode[iSlot] = PING_NONE;
+            pts.clear();
+            g_Backend->CloseMenu(iSlot);
+        }
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+static void OpenModelMenu(int slot)
+{
+    BpMenu m;
+    m.title = Phrase("Menu_ModelTitle", "Выбор модели");
+    if (g_ModelDefs.empty())
+    {
+        m.Add("none", Phrase("Menu_NoModels", "Нет моделей"), false);
+    }
+    else
+    {
+        for (size_t i = 0; i < g_ModelDefs.size(); ++i)
+        {
+            char key[64];
+            snprintf(key, sizeof(key), "m:%zu", i);
+            m.Add(key, g_ModelDefs[i].label.c_str());
+        }
+    }
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "model", [](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenMainMenu(iSlot);
+            return;
+        }
+
+        if (strncmp(back, "m:", 2))
+        {
+            return;
+        }
+        int idx = atoi(back + 2);
+        if (idx < 0 || idx >= (int)g_ModelDefs.size())
+        {
+            return;
+        }
+
+        BpVec pos = CrosshairPos(iSlot);
+        BpVec ang = {0.f, 0.f, 0.f};
+
+        BPItem it;
+        it.label = g_ModelDefs[idx].label;
+        it.path = g_ModelDefs[idx].path;
+        it.pos = pos;
+        it.ang = ang;
+        it.scale = 1.0f;
+        it.invisible = false;
+
+        int newIndex = (int)g_Items.size();
+        g_Items.push_back(it);
+        SaveData();
+
+        MakeLiveIfMissing(newIndex);
+        OpenItemMenu(iSlot, newIndex);
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+static const float PREFAB_YAW_STEP = 15.0f;
+
+// Places the chosen prefab where the player looks, turned to face along
+// the view (in PREFAB_YAW_STEP steps), as one instance.
+static void OpenPrefabMenu(int slot)
+{
+    BpMenu m;
+    m.title = Phrase("Menu_PrefabTitle", "Выбор префаба");
+    if (g_Prefabs.empty())
+    {
+        m.Add("none", Phrase("Menu_NoPrefabs", "Нет префабов"), false);
+    }
+    else
+    {
+        for (size_t i = 0; i < g_Prefabs.size(); ++i)
+        {
+            char key[64];
+            snprintf(key, sizeof(key), "p:%zu", i);
+            m.Add(key, g_Prefabs[i].label.c_str());
+        }
+    }
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "prefab", [](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenMainMenu(iSlot);
+            return;
+        }
+
+        if (strncmp(back, "p:", 2))
+        {
+            return;
+        }
+        int idx = atoi(back + 2);
+        if (idx < 0 || idx >= (int)g_Prefabs.size())
+        {
+            return;
+        }
+
+        BpVec eye, hit;
+        g_Backend->RayTrace(iSlot, eye, hit);
+        float yaw = atan2f(hit.y - eye.y, hit.x - eye.x) * 180.0f / BP_PI;
+        yaw = roundf(yaw / PREFAB_YAW_STEP) * PREFAB_YAW_STEP + 0.0f;
+
+        BPItem inst;
+        inst.prefab = g_Prefabs[idx].name;
+        inst.pos = hit;
+        inst.ang = {0.f, yaw, 0.f};
+        if (!BpInstanceUsable(inst))
+        {
+            return;
+        }
+
+        int first = (int)g_Items.size();
+        BpExpandPrefab(g_Prefabs[idx], inst, (int)g_Instances.size(), g_Items);
+        g_Instances.push_back(std::move(inst));
+        SaveData();
+
+        for (int i = first; i < (int)g_Items.size(); ++i)
+        {
+            MakeLiveIfMissing(i);
+        }
+        PrintChatKey(iSlot, "Chat_PrefabPlaced", "Префаб «%s» поставлен (%d предметов)", g_Prefabs[idx].label.c_str(),
+            (int)g_Items.size() - first);
+        OpenPrefabMenu(iSlot);
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+// Items within EDIT_LIST_RADIUS of the player, nearest first, with an entry
+// for the full list; 'all' (or nothing nearby) lists every item in order.
+static void OpenEditListMenu(int slot, bool all)
+{
+    std::vector<std::pair<float, int>> nearby;
+    BpVec eye, hit;
+    if (!all && g_Backend->RayTrace(slot, eye, hit))
+    {
+        g_PickIndex.Sync(g_Items, g_ItemsRevision);
+        g_PickIndex.Within(eye, EDIT_LIST_RADIUS, [](int) { return true; }, nearby);
+    }
+    if (nearby.empty())
+    {
+        all = true;
+        for (int i = 0; i < (int)g_Items.size(); ++i)
+        {
+            nearby.emplace_back(-1.0f, i);
+        }
+    }
+
+    BpMenu m;
+    m.title = Phrase("Menu_EditPick", "Выбери предмет");
+    if (g_Items.empty())
+    {
+        m.Add("none", Phrase("Menu_NoItems", "Нет предметов"), false);
+    }
+    else
+    {
+        for (const auto& e : nearby)
+        {
+            int i = e.second;
+            char key[64];
+            snprintf(key, sizeof(key), "e:%d", i);
+            std::string title = g_Items[i].label.empty() ? g_Items[i].path : g_Items[i].label;
+            if (g_Items[i].isWall)
+            {
+                title += " [wall]";
+            }
+            if (e.first >= 0.0f)
+            {
+                char dist[32];
+                snprintf(dist, sizeof(dist), " (%.0f)", e.first);
+                title += dist;
+            }
+            m.Add(key, title.c_str());
+        }
+        if (!all && nearby.size() < g_Items.size())
+        {
+            m.Add("all", Phrase("Menu_EditAll", "Все предметы"));
+        }
+    }
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "edit_list", [](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenMainMenu(iSlot);
+            return;
+        }
+        if (!strcmp(back, "all"))
+        {
+            OpenEditListMenu(iSlot, true);
+            return;
+        }
+        if (strncmp(back, "e:", 2))
+        {
+            return;
+        }
+        int idx = atoi(back + 2);
+        if (idx < 0 || idx >= (int)g_Items.size())
+        {
+            return;
+        }
+        MakeLiveIfMissing(idx);
+        OpenItemMenu(iSlot, idx);
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+static void OpenWallMoveMenu(int slot, int index)
+{
+    if (index < 0 || index >= (int)g_Items.size())
+    {
+        return;
+    }
+    BpMenu m;
+    m.title = Phrase("Menu_MoveTitle", "Движение");
+    m.Add("x;10", "По оси X +10");
+    m.Add("x;-10", "По оси X -10");
+    m.Add("y;10", "По оси Y +10");
+    m.Add("y;-10", "По оси Y -10");
+    m.Add("z;10", "По оси Z +10");
+    m.Add("z;-10", "По оси Z -10");
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "wall_move", [index](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+        if (index < 0 || index >= (int)g_Items.size())
+        {
+            return;
+        }
+        float dx = 0, dy = 0, dz = 0;
+        if (!strcmp(back, "x;10")) dx = 10;
+        else if (!strcmp(back, "x;-10")) dx = -10;
+        else if (!strcmp(back, "y;10")) dy = 10;
+        else if (!strcmp(back, "y;-10")) dy = -10;
+        else if (!strcmp(back, "z;10")) dz = 10;
+        else if (!strcmp(back, "z;-10")) dz = -10;
+        else return;
+
+        ShiftWall(index, BpVec(dx, dy, dz));
+
+        RespawnWallLive(index);
+        SaveData();
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+static void OpenWallScaleMenu(int slot, int index)
+{
+    if (index < 0 || index >= (int)g_Items.size())
+    {
+        return;
+    }
+    BpMenu m;
+
+    // A polyline's size is its thickness and height; the path stays.
+    const BPItem& it = g_Items[index];
+    bool poly = !it.points.empty();
+    BpVec diff = it.pos2 - it.pos;
+    char title[128];
+    if (poly)
+    {
+        snprintf(title, sizeof(title), "%s {%.0fx%.0f}", Phrase("Menu_WallScaleTitle", "Размер стены"), it.polyThick, it.polyHeight);
+    }
+    else
+    {
+        snprintf(title, sizeof(title), "%s {%.0fx%.0fx%.0f}", Phrase("Menu_WallScaleTitle", "Размер стены"), fabsf(diff.x),
+            fabsf(diff.y), fabsf(diff.z));
+    }
+    m.title = title;
+
+    m.Add("s;10", "Увеличить +10");
+    m.Add("s;-10", "Уменьшить -10");
+    m.Add("s;50", "Увеличить +50");
+    m.Add("s;-50", "Уменьшить -50");
+    m.Add("s;100", "Увеличить +100");
+    m.Add("s;-100", "Уменьшить -100");
+    if (poly)
+    {
+        m.Add("t;4", "Толщина +4");
+        m.Add("t;-4", "Толщина -4");
+    }
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "wall_scale", [index](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+        if (index < 0 || index >= (int)g_Items.size())
+        {
+            return;
+        }
+        float delta = 0.0f;
+        BPItem& it = g_Items[index];
+        if (!it.points.empty())
+        {
+            if (sscanf(back, "t;%f", &delta) == 1)
+            {
+                it.polyThick = fmaxf(it.polyThick + delta, 2.0f);
+            }
+            else if (sscanf(back, "s;%f", &delta) == 1)
+            {
+                it.polyHeight = fmaxf(it.polyHeight + delta, 2.0f);
+            }
+            else
+            {
+                return;
+            }
+            BpPolyRefit(it);
+            RespawnWallLive(index);
+            SaveData();
+            OpenWallScaleMenu(iSlot, index);
+            return;
+        }
+        if (sscanf(back, "s;%f", &delta) != 1)
+        {
+            return;
+        }
+
+        BpVec center = (g_Items[index].pos + g_Items[index].pos2) * 0.5f;
+        BpVec half = (g_Items[index].pos2 - g_Items[index].pos) * 0.5f;
+
+        for (int a = 0; a < 3; ++a)
+        {
+            if (half[a] > 0)
+            {
+                half[a] = fmaxf(half[a] + delta * 0.5f, 1.0f);
+            }
+            else if (half[a] < 0)
+            {
+                half[a] = fminf(half[a] - delta * 0.5f, -1.0f);
+            }
+            else
+            {
+                half[a] = delta * 0.5f;
+            }
+        }
+
+        g_Items[index].pos = center - half;
+        g_Items[index].pos2 = center + half;
+
+        RespawnWallLive(index);
+        SaveData();
+        OpenWallScaleMenu(iSlot, index);
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+static void OpenWallRotateMenu(int slot, int index)
+{
+    if (index < 0 || index >= (int)g_Items.size())
+    {
+        return;
+    }
+    BpMenu m;
+
+    char title[128];
+    snprintf(title, sizeof(title), "%s {%.0f°}", Phrase("Menu_WallRotateTitle", "Поворот стены"), g_Items[index].wallYaw);
+    m.title = title;
+
+    m.Add("r;45", "+45°");
+    m.Add("r;-45", "-45°");
+    m.Add("r;15", "+15°");
+    m.Add("r;-15", "-15°");
+    m.Add("r;5", "+5°");
+    m.Add("r;-5", "-5°");
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "wall_rotate", [index](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+        if (index < 0 || index >= (int)g_Items.size())
+        {
+            return;
+        }
+        float delta = 0.0f;
+        if (sscanf(back, "r;%f", &delta) == 1)
+        {
+            g_Items[index].wallYaw += delta;
+            if (g_Items[index].wallYaw >= 360.0f)
+            {
+                g_Items[index].wallYaw -= 360.0f;
+            }
+            if (g_Items[index].wallYaw < 0.0f)
+            {
+                g_Items[index].wallYaw += 360.0f;
+            }
+            RespawnWallLive(index);
+            SaveData();
+            OpenWallRotateMenu(iSlot, index);
+        }
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+void OpenItemMenu(int slot, int index)
+{
+    if (index < 0 || index >= (int)g_Items.size())
+    {
+        return;
+    }
+    BpMenu m;
+
+    bool isWall = g_Items[index].isWall;
+
+    char title[256];
+    snprintf(title, sizeof(title), "%s%s", g_Items[index].label.c_str(), isWall ? " [wall]" : "");
+    m.title = title;
+
+    if (isWall)
+    {
+        m.Add("wallmove", Phrase("Menu_Move", "Двигать"));
+        m.Add("wallscale", Phrase("Menu_WallScale", "Размер стены"));
+        if (g_Items[index].points.empty())
+        {
+            m.Add("wallrotate", Phrase("Menu_WallRotate", "Поворот стены"));
+        }
+        m.Add("beamcolor", Phrase("Menu_BeamColor", "Цвет лазера"));
+        m.Add("wall:trace", Phrase("Menu_MoveTrace", "Перенести в точку прицела"));
+        m.Add("wallping", Phrase("Menu_PingMove", "Телепортировать пингом"));
+    }
+
+    if (!isWall)
+    {
+        m.Add("move", Phrase("Menu_Move", "Двигать"));
+        m.Add("rotate", Phrase("Menu_Rotate", "Поворачивать"));
+        m.Add("scale", Phrase("Menu_Scale", "Масштаб"));
+    }
+
+    m.Add("teleport", Phrase("Menu_Teleport", "Телепортироваться"));
+
+    if (!isWall)
+    {
+        m.Add("itemcolor", Phrase("Menu_ItemColor", "Цвет предмета"));
+        m.Add("ping", Phrase("Menu_PingMove", "Телепортировать пингом"));
+        m.Add("move:trace", Phrase("Menu_MoveTrace", "Перенести в точку прицела"));
+
+        if (g_Items[index].invisible)
+        {
+            m.Add("invis:off", Phrase("Menu_InvisOff", "Показать"));
+        }
+        else
+        {
+            m.Add("invis:on", Phrase("Menu_InvisOn", "Скрыть"));
+        }
+    }
+
+    m.Add("threshold", Phrase("Menu_Threshold", "Порог игроков"));
+    m.Add("layers", Phrase("Menu_Layers", "Профили"));
+    m.Add("delete", Phrase("Menu_Delete", "Удалить"));
+
+    m.back = true;
+    m.exit = true;
+
+    SetMenuCallback(m, "item", [index](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenEditListMenu(iSlot);
+            return;
+        }
+
+        if (!strcmp(back, "move"))
+        {
+            OpenMoveMenu(iSlot, index);
+            return;
+        }
+        if (!strcmp(back, "rotate"))
+        {
+            OpenRotateSubMenu(iSlot, index);
+            return;
+        }
+        if (!strcmp(back, "scale"))
+        {
+            OpenScaleMenu(iSlot, index);
+            return;
+        }
+        if (!strcmp(back, "wallmove"))
+        {
+            OpenWallMoveMenu(iSlot, index);
+            return;
+        }
+        if (!strcmp(back, "wallscale"))
+        {
+            OpenWallScaleMenu(iSlot, index);
+            return;
+        }
+        if (!strcmp(back, "beamcolor"))
+        {
+            OpenBeamColorMenu(iSlot, index);
+            return;
+        }
+        if (!strcmp(back, "wallrotate"))
+        {
+            OpenWallRotateMenu(iSlot, index);
+            return;
+        }
+        if (!strcmp(back, "wall:trace"))
+        {
+            BpVec center = (g_Items[index].pos + g_Items[index].pos2) * 0.5f;
+            ShiftWall(index, CrosshairPos(iSlot) - center);
+            RespawnWallLive(index);
+            SaveData();
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+        if (!strcmp(back, "wallping"))
+        {
+            g_ePingMode[iSlot] = PING_TELEPORT;
+            g_iPingTargetIndex[iSlot] = index;
+            PrintChatKey(iSlot, "Chat_UsePing", "Выберите место с помощью пинга (колёсико мышки)");
+            g_Backend->CloseMenu(iSlot);
+            return;
+        }
+        if (!strcmp(back, "itemcolor"))
+        {
+            OpenItemColorMenu(iSlot, index);
+            return;
+        }
+        if (!strcmp(back, "threshold"))
+        {
+            OpenThresholdMenu(iSlot, index);
+            return;
+        }
+        if (!strcmp(back, "layers"))
+        {
+            OpenLayersMenu(iSlot, index);
+            return;
+        }
+
+        if (!strcmp(back, "teleport"))
+        {
+            if (!g_Backend->TeleportPlayer(iSlot, g_Items[index].pos, g_Items[index].ang))
+            {
+                PrintChatKey(iSlot, "Chat_MustBeAlive", "Для этого вы должны быть живы");
+                return;
+            }
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+
+        if (!strcmp(back, "ping"))
+        {
+            g_ePingMode[iSlot] = PING_TELEPORT;
+            g_iPingTargetIndex[iSlot] = index;
+            PrintChatKey(iSlot, "Chat_UsePing", "Выберите место с помощью пинга (колёсико мышки)");
+            g_Backend->CloseMenu(iSlot);
+            return;
+        }
+
+        if (!strcmp(back, "move:trace"))
+        {
+            g_Items[index].pos = CrosshairPos(iSlot);
+            TeleportLive(index);
+            MakeLiveIfMissing(index);
+            SaveData();
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+
+        if (!strcmp(back, "invis:on"))
+        {
+            g_Items[index].invisible = true;
+            ApplyInvisibilityToLive(index);
+            SaveData();
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+        if (!strcmp(back, "invis:off"))
+        {
+            g_Items[index].invisible = false;
+            ApplyInvisibilityToLive(index);
+            SaveData();
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+
+        if (!strcmp(back, "delete"))
+        {
+            if (index < 0 || index >= (int)g_Items.size())
+            {
+                return;
+            }
+            Live_Destroy(&index, 1);
+            g_Items.erase(g_Items.begin() + index);
+            for (auto& le : g_Live)
+            {
+                if (le.index > index)
+                {
+                    le.index--;
+                }
+            }
+            Live_Reindex();
+            SaveData();
+            OpenEditListMenu(iSlot);
+            return;
+        }
+    });
+
+    g_Backend->ShowMenu(slot, m);
+}
+
+static void OpenMoveMenu(int slot, int index)
+{
+    if (index < 0 || index >= (int)g_Items.size())
+    {
+        return;
+    }
+    BpMenu m;
+    m.title = Phrase("Menu_MoveTitle", "Движение");
+    m.Add("x;10", "По оси X +10");
+    m.Add("x;-10", "По оси X -10");
+    m.Add("y;10", "По оси Y +10");
+    m.Add("y;-10", "По оси Y -10");
+    m.Add("z;10", "По оси Z +10");
+    m.Add("z;-10", "По оси Z -10");
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "move", [index](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+
+        if (index < 0 || index >= (int)g_Items.size())
+        {
+            return;
+        }
+        BpVec& pos = g_Items[index].pos;
+        if (!strcmp(back, "x;10"))
+        {
+            pos.x += 10;
+        }
+        else if (!strcmp(back, "x;-10"))
+        {
+            pos.x -= 10;
+        }
+        else if (!strcmp(back, "y;10"))
+        {
+            pos.y += 10;
+        }
+        else if (!strcmp(back, "y;-10"))
+        {
+            pos.y -= 10;
+        }
+        else if (!strcmp(back, "z;10"))
+        {
+            pos.z += 10;
+        }
+        else if (!strcmp(back, "z;-10"))
+        {
+            pos.z -= 10;
+        }
+        else
+        {
+            return;
+        }
+
+        TeleportLive(index);
+        MakeLiveIfMissing(index);
+        SaveData();
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+static void OpenRotateSubMenu(int slot, int index)
+{
+    if (index < 0 || index >= (int)g_Items.size())
+    {
+        return;
+    }
+    BpMenu m;
+    m.title = Phrase("Menu_RotateTitle", "Поворот");
+    m.Add("x;10", "По оси X +10");
+    m.Add("x;-10", "По оси X -10");
+    m.Add("y;10", "По оси Y +10");
+    m.Add("y;-10", "По оси Y -10");
+    m.Add("z;10", "По оси Z +10");
+    m.Add("z;-10", "По оси Z -10");
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "rotate", [index](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+
+        if (index < 0 || index >= (int)g_Items.size())
+        {
+            return;
+        }
+        BpVec& ang = g_Items[index].ang;
+        if (!strcmp(back, "x;10"))
+        {
+            ang.x += 10;
+        }
+        else if (!strcmp(back, "x;-10"))
+        {
+            ang.x -= 10;
+        }
+        else if (!strcmp(back, "y;10"))
+        {
+            ang.y += 10;
+        }
+        else if (!strcmp(back, "y;-10"))
+        {
+            ang.y -= 10;
+        }
+        else if (!strcmp(back, "z;10"))
+        {
+            ang.z += 10;
+        }
+        else if (!strcmp(back, "z;-10"))
+        {
+            ang.z -= 10;
+        }
+        else
+        {
+            return;
+        }
+
+        TeleportLive(index);
+        MakeLiveIfMissing(index);
+        SaveData();
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+static void OpenScaleMenu(int slot, int index)
+{
+    if (index < 0 || index >= (int)g_Items.size())
+    {
+        return;
+    }
+    BpMenu m;
+
+    char title[128];
+    snprintf(title, sizeof(title), "%s {%.2fx}", Phrase("Menu_ScaleTitle", "Масштаб"), g_Items[index].scale);
+    m.title = title;
+
+    m.Add("0.1", "Увеличить +0.1");
+    m.Add("-0.1", "Уменьшить -0.1");
+    m.Add("0.5", "Увеличить +0.5");
+    m.Add("-0.5", "Уменьшить -0.5");
+    m.Add("1.0", "Увеличить +1.0");
+    m.Add("-1.0", "Уменьшить -1.0");
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "scale", [index](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+
+        if (index < 0 || index >= (int)g_Items.size())
+        {
+            return;
+        }
+        float fDelta = (float)atof(back);
+        g_Items[index].scale = ClampScale(g_Items[index].scale + fDelta);
+        ApplyVisualScaleToLive(index);
+        SaveData();
+        OpenScaleMenu(iSlot, index);
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+static void RespawnWallBeams(int index)
+{
+    ScopedNet net(index, NS_EDIT);
+    for (auto& le : g_Live)
+    {
+        if (le.index != index)
+        {
+            continue;
+        }
+        RemoveLiveBeams(le);
+        const BPItem& it = g_Items[index];
+        WallGeom geom;
+        BpComputeItemGeom(it, geom);
+        ScopedOwner owner(index);
+        le.beams = DrawWireframe(geom, it.beamR, it.beamG, it.beamB, it.beamRainbow, 1.0f, le.beamDetail);
+        Registry_Own(le);
+        if (it.beamRainbow)
+        {
+            StartRainbowTimer();
+        }
+        return;
+    }
+}
+
+static inline void ApplyItemColorToLive(int index)
+{
+    ScopedNet net(index, NS_EDIT);
+    for (auto& le : g_Live)
+    {
+        if (le.index != index || !EntAlive(le.ent))
+        {
+            continue;
+        }
+        ApplyRenderColor(le.ent, g_Items[index].itemR, g_Items[index].itemG, g_Items[index].itemB);
+        return;
+    }
+}
+
+static void OpenItemColorMenu(int slot, int index)
+{
+    if (index < 0 || index >= (int)g_Items.size())
+    {
+        return;
+    }
+    BpMenu m;
+    m.title = Phrase("Menu_ItemColorTitle", "Цвет предмета");
+    m.Add("c:255:255:255", "Белый (по умолчанию)");
+    m.Add("c:255:0:0", "Красный");
+    m.Add("c:0:255:0", "Зелёный");
+    m.Add("c:0:128:255", "Голубой");
+    m.Add("c:255:255:0", "Жёлтый");
+    m.Add("c:255:0:255", "Розовый");
+    m.Add("c:0:0:0", "Чёрный");
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "item_color", [index](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+        if (index < 0 || index >= (int)g_Items.size())
+        {
+            return;
+        }
+        if (!strncmp(back, "c:", 2))
+        {
+            int r = 255, g = 255, b = 255;
+            sscanf(back, "c:%d:%d:%d", &r, &g, &b);
+            g_Items[index].itemR = r;
+            g_Items[index].itemG = g;
+            g_Items[index].itemB = b;
+            ApplyItemColorToLive(index);
+            SaveData();
+        }
+        OpenItemMenu(iSlot, index);
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+static void ApplyTierToItem(int index)
+{
+    if (!ItemShouldBeOpen(index))
+    {
+        MakeLiveIfMissing(index);
+        return;
+    }
+    Live_Destroy(&index, 1);
+}
+
+static void OpenThresholdMenu(int slot, int index)
+{
+    if (index < 0 || index >= (int)g_Items.size())
+    {
+        return;
+    }
+    BpMenu m;
+
+    char title[128];
+    if (g_Items[index].minPlayers >= 0)
+    {
+        snprintf(title, sizeof(title), "%s {%d}", Phrase("Menu_ThresholdTitle", "Порог игроков"), g_Items[index].minPlayers);
+    }
+    else
+    {
+        snprintf(title, sizeof(title), "%s {%d*}", Phrase("Menu_ThresholdTitle", "Порог игроков"), g_MinPlayersToOpen);
+    }
+    m.title = title;
+
+    m.Add("t;1", "+1");
+    m.Add("t;-1", "-1");
+    m.Add("t;5", "+5");
+    m.Add("t;-5", "-5");
+    m.Add("t;default", Phrase("Menu_ThresholdDefault", "Как в настройках"), g_Items[index].minPlayers >= 0);
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "threshold", [index](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+        if (index < 0 || index >= (int)g_Items.size())
+        {
+            return;
+        }
+        int delta = 0;
+        if (!strcmp(back, "t;default"))
+        {
+            g_Items[index].minPlayers = -1;
+        }
+        else if (sscanf(back, "t;%d", &delta) == 1)
+        {
+            int v = ItemThreshold(g_Items[index]) + delta;
+            if (v < 0)
+            {
+                v = 0;
+            }
+            if (v > 64)
+            {
+                v = 64;
+            }
+            g_Items[index].minPlayers = v;
+        }
+        else
+        {
+            return;
+        }
+        SaveData();
+        ApplyTierToItem(index);
+        OpenThresholdMenu(iSlot, index);
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+static void OpenLayersMenu(int slot, int index)
+{
+    if (index < 0 || index >= (int)g_Items.size())
+    {
+        return;
+    }
+    BpMenu m;
+    m.title = Phrase("Menu_LayersTitle", "Профили предмета");
+    for (int i = 0; i < (int)g_LayerNames.size(); ++i)
+    {
+        char key[32];
+        snprintf(key, sizeof(key), "l:%d", i);
+        char text[128];
+        bool on = (g_Items[index].layers & (1u << i)) != 0;
+        snprintf(text, sizeof(text), "[%s] %s%s", on ? "+" : "-", g_LayerNames[i].c_str(), i == g_ActiveLayer ? " *" : "");
+        m.Add(key, text);
+    }
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "layers", [index](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+        if (index < 0 || index >= (int)g_Items.size() || strncmp(back, "l:", 2))
+        {
+            return;
+        }
+        int layer = atoi(back + 2);
+        if (layer < 0 || layer >= (int)g_LayerNames.size())
+        {
+            return;
+        }
+        g_Items[index].layers ^= (1u << layer);
+        SaveData();
+        ApplyTierToItem(index);
+        OpenLayersMenu(iSlot, index);
+    });
+    g_Backend->ShowMenu(slot, m);
+}
+
+static void OpenBeamColorMenu(int slot, int index)
+{
+    if (index < 0 || index >= (int)g_Items.size())
+    {
+        return;
+    }
+    BpMenu m;
+    m.title = Phrase("Menu_BeamColorTitle", "Цвет лазера");
+    m.Add("c:255:0:0", "Красный");
+    m.Add("c:0:255:0", "Зелёный");
+    m.Add("c:0:128:255", "Голубой");
+    m.Add("c:255:255:0", "Жёлтый");
+    m.Add("c:255:0:255", "Розовый");
+    m.Add("c:255:255:255", "Белый");
+    m.Add("rainbow", "Разноцветный");
+    m.back = true;
+    m.exit = true;
+    SetMenuCallback(m, "beam_color", [index](const char* back, const char*, int, int iSlot) {
+        if (!strcmp(back, "back"))
+        {
+            OpenItemMenu(iSlot, index);
+            return;
+        }
+        if (index < 0 || index >= (int)g_Items.size())
+        {
+            return;
+        }
+
+        if (!strcmp(back, "rainbow"))
+        {
+            g_Items[index].beamRainbow = true;
+        }
+        else if (!strncmp(back, "c:", 2))
+        {
+            int r = 0, g = 128, b = 255;
+            sscanf(back, "c:%d:%d:%d", &r, &g, &b);
+            g_Items[index].beamR = r;
+            g_Items[index].beamG = g;
+            g_Items[index].beamB = b;
+            g_Items[index].beamRainbow = false;
+        }
+        else
+        {
+            return;
+        }
+
+        RespawnWallBeams(index);
+        SaveData();
+        OpenItemMenu(iSlot, index);
+    });
+    g_Backend->ShowMenu(slot, m);
+}
@@ -0,0 +1,370 @@
+#ifndef _INCLUDE_BLOCKERPASSES_CORE_H_
+#define _INCLUDE_BLOCKERPASSES_CORE_H_
+
+// The plugin logic: layout, live entities, rounds, player tiers, profiles,
+// menus, pings and commands, and the diagnostics around them, written
+// against IBpBackend alone. It is defined in Core.cpp, which the plugin and
+// the offline tools (tools/bp_sim.cpp, tools/bp_replay.cpp) both compile, so
+// what the tools measure is this code and not a copy of it.
+//
+// This header declares what the programs drive it through: the event and
+// command handlers, the settings and state they read or set, and the
+// logger, whose LogAt is inline so a call site costs only the ring push.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <cstring>
+#include <cctype>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <type_traits>
+#include "Layout.h"
+#include "Backend.h"
+#include "Record.h"
+#include "KvText.h"
+
+struct BpColor
+{
+    uint8_t r, g, b;
+};
+
+static const BpColor CON_OK = { 0, 255, 0 };
+static const BpColor CON_INFO = { 150, 200, 255 };
+static const BpColor CON_WARN = { 255, 120, 80 };
+static const BpColor CON_ERROR = { 255, 0, 0 };
+static const BpColor CON_USAGE = { 255, 255, 0 };
+
+// Console output, set by the program before anything runs: ConColorMsg on a
+// server, stdout or nothing in the tools. The logger thread calls it too.
+typedef void (*BpConsoleFn)(BpColor color, const char* text);
+extern BpConsoleFn g_ConsoleOut;
+
+// Directory the log, traces and recordings are written under; the game
+// directory on a server.
+extern std::string g_BaseDir;
+
+void ConPrint(BpColor color, const char* fmt, ...);
+
+static inline int BpStricmp(const char* a, const char* b)
+{
+    for (; *a && tolower((unsigned char)*a) == tolower((unsigned char)*b); ++a, ++b)
+    {
+    }
+    return tolower((unsigned char)*a) - tolower((unsigned char)*b);
+}
+
+static inline void BpStrncpy(char* dst, const char* src, size_t size)
+{
+    snprintf(dst, size, "%s", src);
+}
+
+// Monotonic seconds for measurements: phases, task runs, trace spans and
+// log stamps. Game time, timers and recordings use g_Backend->Time().
+static inline double BpClock()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Null until the program installs its backend (AllPluginsLoaded on a
+// server); mm_bp_record swaps in the recording backend in front of it.
+extern IBpBackend* g_Backend;
+
+// A BpEnt held across frames may name an entity the map has removed since.
+static inline bool EntAlive(BpEnt ent)
+{
+    return ent && g_Backend->Alive(ent);
+}
+
+struct ModelDef
+{
+    std::string label;
+    std::string path;
+};
+
+typedef BpItem BPItem;
+
+struct LiveEnt
+{
+    int index;
+    BpEnt ent = nullptr;
+    std::vector<BpEnt> beams;
+    std::vector<BpEnt> wallColls;
+    int beamDetail = BEAMS_FULL;
+};
+
+extern std::vector<ModelDef> g_ModelDefs;
+extern std::vector<BPItem>   g_Items;
+extern std::vector<LiveEnt>  g_Live;
+extern std::string g_CurrentMap;
+
+extern int  g_MinPlayersToOpen;
+extern bool g_bIgnoreSpectators;
+extern std::string g_ChatCommand;
+extern std::string g_ConCmdBp;
+extern std::string g_ConCmdAccess;
+extern std::string g_ConCmdProfile;
+extern int  g_ItemsRevision;
+extern std::vector<std::string> g_LayerNames;
+extern int  g_ActiveLayer;
+extern int  g_nPendingSolid;
+extern std::set<uint64_t> g_TempAccessSteamIDs;
+
+bool KvLoadFile(BpKv* kv, const char* path);
+void KvSaveFile(const BpKv* kv, const char* path);
+void LoadPhrases();
+
+enum LogLevel
+{
+    LVL_ERROR = 0,
+    LVL_WARN,
+    LVL_INFO,
+    LVL_DEBUG,
+    LVL_TRACE
+};
+
+enum LogCategory
+{
+    LOGC_GENERAL = 0,
+    LOGC_MAP,
+    LOGC_ROUND,
+    LOGC_SPAWN,
+    LOGC_BEAM,
+    LOGC_COUNT
+};
+
+static const char* const g_LogLevelNames[] = { "error", "warn", "info", "debug", "trace" };
+static const char* const g_LogCategoryNames[LOGC_COUNT] = { "general", "map", "round", "spawn", "beam" };
+
+enum LogArgKind : uint8_t
+{
+    LARG_INT = 0,
+    LARG_UINT,
+    LARG_DBL,
+    LARG_STR,
+    LARG_PTR
+};
+
+static const int LOG_MAX_ARGS = 12;
+static const int LOG_STR_BYTES = 160;
+static const uint32_t LOG_RING_SIZE = 4096;
+
+struct LogRecord
+{
+    const char* fmt;
+    double time;
+    uint8_t level;
+    uint8_t cat;
+    uint8_t nargs;
+    uint8_t strUsed;
+    uint8_t kinds[LOG_MAX_ARGS];
+    union
+    {
+        long long i;
+        unsigned long long u;
+        double d;
+        const void* p;
+        uint32_t str;
+    } vals[LOG_MAX_ARGS];
+    char strbuf[LOG_STR_BYTES];
+};
+extern LogRecord             g_LogRing[LOG_RING_SIZE];
+extern std::atomic<uint32_t> g_LogHead;
+extern std::atomic<uint32_t> g_LogTail;
+extern std::atomic<uint64_t> g_LogDropped;
+extern int      g_LogLevel;
+extern uint32_t g_LogCatMask;
+extern bool     g_bLogToFile;
+
+template<typename T>
+static inline void LogPack(LogRecord& r, T v)
+{
+    if (r.nargs >= LOG_MAX_ARGS)
+    {
+        return;
+    }
+    int n = r.nargs++;
+    if constexpr (std::is_same<T, const char*>::value || std::is_same<T, char*>::value)
+    {
+        const char* src = v ? v : "(null)";
+        size_t room = LOG_STR_BYTES - r.strUsed;
+        size_t len = room ? strnlen(src, room - 1) : 0;
+        r.kinds[n] = LARG_STR;
+        r.vals[n].str = r.strUsed;
+        if (room)
+        {
+            memcpy(r.strbuf + r.strUsed, src, len);
+            r.strbuf[r.strUsed + len] = 0;
+            r.strUsed = (uint8_t)(r.strUsed + len + 1);
+        }
+    }
+    else if constexpr (std::is_floating_point<T>::value)
+    {
+        r.kinds[n] = LARG_DBL;
+        r.vals[n].d = (double)v;
+    }
+    else if constexpr (std::is_pointer<T>::value)
+    {
+        r.kinds[n] = LARG_PTR;
+        r.vals[n].p = (const void*)v;
+    }
+    else if constexpr (std::is_unsigned<T>::value)
+    {
+        r.kinds[n] = LARG_UINT;
+        r.vals[n].u = (unsigned long long)v;
+    }
+    else
+    {
+        r.kinds[n] = LARG_INT;
+        r.vals[n].i = (long long)v;
+    }
+}
+
+template<typename... Args>
+static void LogAt(LogLevel level, LogCategory cat, const char* fmt, Args... args)
+{
+    if ((int)level > g_LogLevel || !(g_LogCatMask & (1u << cat)))
+    {
+        return;
+    }
+    uint32_t head = g_LogHead.load(std::memory_order_relaxed);
+    if (head - g_LogTail.load(std::memory_order_acquire) >= LOG_RING_SIZE)
+    {
+        g_LogDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    LogRecord& r = g_LogRing[head & (LOG_RING_SIZE - 1)];
+    r.fmt = fmt;
+    r.time = BpClock();
+    r.level = (uint8_t)level;
+    r.cat = (uint8_t)cat;
+    r.nargs = 0;
+    r.strUsed = 0;
+    (LogPack(r, args), ...);
+    g_LogHead.store(head + 1, std::memory_order_release);
+}
+
+template<typename... Args>
+static inline void Dbg(const char* fmt, Args... args)
+{
+    LogAt(LVL_DEBUG, LOGC_GENERAL, fmt, args...);
+}
+
+void Log_Stop();
+void Log_Start();
+bool Log_ParseLevel(const char* s, int& out);
+uint32_t Log_ParseCategories(const char* s);
+
+enum Phase
+{
+    PH_ROUND_START = 0,
+    PH_CLEAR_LIVE,
+    PH_APPLY_PLAN,
+    PH_SPAWN_ONE,
+    PH_SPAWN_WALL_COLL,
+    PH_DRAW_WIREFRAME,
+    PH_SAVE_DATA,
+    PH_LOAD_DATA,
+    PH_RAINBOW_TICK,
+    PH_COUNT
+};
+
+enum Counter
+{
+    CNT_ENT_CREATED = 0,
+    CNT_ENT_DESTROYED,
+    CNT_STATE_CHANGED,
+    CNT_TASKS_SCHEDULED,
+    CNT_STATE_COALESCED,
+    CNT_COUNT
+};
+
+extern uint64_t g_Counters[CNT_COUNT];
+extern bool     g_bReloadHandoff;
+extern int      g_MapBudget;        // bp_data.ini per-map override, -1 = use settings
+extern bool     g_bLateLoad;
+
+void Stats_Print();
+void Stats_Reset();
+
+extern std::thread g_TraceWriter;
+extern int         g_TraceRoundsLeft;
+
+void Trace_Flush();
+
+extern BpRecWriter g_Rec;
+
+static inline bool Rec_On()
+{
+    return g_Rec.IsOpen();
+}
+
+void Rec_Start();
+void Rec_Stop();
+
+struct NetField
+{
+    const char* cls;
+    const char* field;
+    int bytes;
+    uint64_t total;
+    uint64_t round;
+};
+
+extern NetField g_NetFields[NF_COUNT];
+
+void Net_Reset();
+void Net_Print();
+
+extern bool g_bDirtyFlush;
+
+void FlushDirty();
+
+enum TaskScope
+{
+    SCOPE_ROUND = 0,
+    SCOPE_MAP = 1,
+    SCOPE_PLUGIN = 2
+};
+
+extern int g_SchedDriverGen;
+
+void Sched_CancelScope(TaskScope upTo);
+void Sched_PrintStats();
+
+void ClearLive(bool removeEntities);
+void Live_Reindex();
+int Live_Destroy(const int* items, size_t n);
+void MakeLiveIfMissing(int index);
+void RespawnLive(int index);
+int RespawnSolidlessWalls();
+void Registry_Print();
+int EntityBudget();
+int EntitiesInUse();
+
+extern std::map<std::string, std::vector<std::string>> g_SigExtra;
+
+void SaveData();
+void Sig_ReloadPatterns();
+void LoadSettings();
+
+void OpenItemMenu(int slot, int index);
+bool OnBpCmd(int slot, const char* args);
+bool OnProfileCmd(int slot, const char* args);
+void OnMapStart(const char* map);
+void OnMapEnd();
+void OnPlayerPing(int iSlot, const BpVec& pingPos);
+void OnRoundPrepare(const char* szName);
+void OnRoundStart();
+void PlayerCountChanged(int slot, int kind);
+void OnPlayerCount(int slot, int kind);
+void OnPlayerDisconnect(int slot);
+void Handoff_Save();
+void LateLoad();
+
+#endif //_INCLUDE_BLOCKERPASSES_CORE_H_
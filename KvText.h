@@ -0,0 +1,572 @@
+#ifndef _INCLUDE_BLOCKERPASSES_KVTEXT_H_
+#define _INCLUDE_BLOCKERPASSES_KVTEXT_H_
+
+// Standalone reader/writer for the KeyValues text format used by bp_data.ini,
+// settings.ini and the phrases file. The plugin reads and writes all of them
+// through BpKv, the file bytes coming from IBpBackend, so the offline tools
+// parse exactly what the server does. BpKv keeps the shape of the KeyValues
+// API the code was first written against.
+//
+// Grammar: a file is a sequence of  key value  or  key { ... }  pairs; keys
+// and values are "quoted" or bare tokens; // starts a comment; a trailing
+// [$CONDITION] after a pair is skipped; a bare #include or #base pair at the
+// top level is ignored. As in KeyValues without escape sequences, a
+// backslash is an ordinary character and a quoted token ends at the next ".
+//
+// Parsing is iterative and bounded by BpKvLimits (input size, nesting depth,
+// node count, token length), so a hand-edited or corrupted file fails with
+// an error instead of exhausting memory.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <float.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+struct BpKvLimits
+{
+    size_t maxBytes = 64u << 20;
+    int maxDepth = 64;
+    size_t maxNodes = 1u << 20;
+    size_t maxToken = 64u << 10;
+};
+
+class BpKv
+{
+public:
+    explicit BpKv(const char* name = "") : m_Name(name ? name : "") {}
+    ~BpKv()
+    {
+        for (BpKv* c : m_Children)
+        {
+            delete c;
+        }
+    }
+    BpKv(const BpKv&) = delete;
+    BpKv& operator=(const BpKv&) = delete;
+
+    const char* GetName() const { return m_Name.c_str(); }
+    void SetName(const char* name) { m_Name = name ? name : ""; }
+    bool IsSection() const { return m_bSection; }
+    void SetLimits(const BpKvLimits& limits) { m_Limits = limits; }
+
+    BpKv* FindKey(const char* name, bool create = false)
+    {
+        for (BpKv* c : m_Children)
+        {
+            if (NameEq(c->m_Name.c_str(), name))
+            {
+                return c;
+            }
+        }
+        if (!create)
+        {
+            return nullptr;
+        }
+        BpKv* c = CreateNewKey();
+        c->m_Name = name;
+        return c;
+    }
+
+    BpKv* CreateNewKey()
+    {
+        BpKv* c = new BpKv();
+        c->m_pParent = this;
+        c->m_Index = m_Children.size();
+        c->m_bSection = true;
+        m_bSection = true;
+        m_Children.push_back(c);
+        return c;
+    }
+
+    void RemoveSubKey(BpKv* sub)
+    {
+        for (size_t i = 0; i < m_Children.size(); ++i)
+        {
+            if (m_Children[i] == sub)
+            {
+                m_Children.erase(m_Children.begin() + i);
+                for (size_t j = i; j < m_Children.size(); ++j)
+                {
+                    m_Children[j]->m_Index = j;
+                }
+                delete sub;
+                return;
+            }
+        }
+    }
+
+    BpKv* GetFirstSubKey() const { return m_Children.empty() ? nullptr : m_Children[0]; }
+    BpKv* GetNextKey() const { return Sibling(false, false); }
+    BpKv* GetFirstTrueSubKey() const { return FirstChild(true); }
+    BpKv* GetNextTrueSubKey() const { return Sibling(true, true); }
+    BpKv* GetFirstValue() const { return FirstChild(false); }
+    BpKv* GetNextValue() const { return Sibling(true, false); }
+
+    const char* GetString() const { return m_Value.c_str(); }
+
+    const char* GetString(const char* key, const char* def = "") const
+    {
+        const BpKv* c = Leaf(key);
+        return c ? c->m_Value.c_str() : def;
+    }
+    int GetInt(const char* key, int def = 0) const
+    {
+        const BpKv* c = Leaf(key);
+        return c ? (int)strtol(c->m_Value.c_str(), nullptr, 10) : def;
+    }
+    float GetFloat(const char* key, float def = 0.0f) const
+    {
+        const BpKv* c = Leaf(key);
+        if (!c)
+        {
+            return def;
+        }
+        // Out-of-range doubles saturate instead of hitting an undefined cast.
+        double d = strtod(c->m_Value.c_str(), nullptr);
+        return d > FLT_MAX ? HUGE_VALF : (d < -FLT_MAX ? -HUGE_VALF : (float)d);
+    }
+
+    void SetString(const char* key, const char* value)
+    {
+        BpKv* c = FindKey(key, true);
+        c->m_bSection = false;
+        c->m_Value = value ? value : "";
+    }
+    void SetInt(const char* key, int value)
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%d", value);
+        SetString(key, buf);
+    }
+    void SetFloat(const char* key, float value)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%f", value);
+        SetString(key, buf);
+    }
+
+    // Like KeyValues, the buffer's first top-level section becomes this node
+    // (name and children). On failure the node keeps whatever parsed before
+    // the error and 'error' says where.
+    bool LoadFromBuffer(const char* data, size_t len, std::string* error = nullptr)
+    {
+        Clear();
+        bool ok = Parse(data, len, error);
+        std::vector<BpKv*> top;
+        top.swap(m_Children);
+        bool adopted = false;
+        for (BpKv* c : top)
+        {
+            if (!adopted && c->m_bSection)
+            {
+                m_Name = c->m_Name;
+                m_Children.swap(c->m_Children);
+                for (BpKv* gc : m_Children)
+                {
+                    gc->m_pParent = this;
+                }
+                adopted = true;
+            }
+            delete c;
+        }
+        return ok;
+    }
+
+    bool LoadFromFile(const char* path, std::string* error = nullptr)
+    {
+        FILE* f = fopen(path, "rb");
+        if (!f)
+        {
+            if (error)
+            {
+                *error = std::string(path) + ": cannot open";
+            }
+            return false;
+        }
+        std::string data;
+        char buf[65536];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        {
+            data.append(buf, n);
+        }
+        fclose(f);
+        // The plugin's configs are saved with a UTF-8 BOM by some editors.
+        size_t skip = (data.size() >= 3 && !memcmp(data.data(), "\xEF\xBB\xBF", 3)) ? 3 : 0;
+        return LoadFromBuffer(data.data() + skip, data.size() - skip, error);
+    }
+
+    // Serialises this node (name and children) in the layout KeyValues writes.
+    void SaveToString(std::string& out, int depth = 0) const
+    {
+        Indent(out, depth);
+        Quote(out, m_Name);
+        out += "\n";
+        Indent(out, depth);
+        out += "{\n";
+        for (const BpKv* c : m_Children)
+        {
+            if (c->m_bSection)
+            {
+                c->SaveToString(out, depth + 1);
+            }
+            else
+            {
+                Indent(out, depth + 1);
+                Quote(out, c->m_Name);
+                out += "\t\t";
+                Quote(out, c->m_Value);
+                out += "\n";
+            }
+        }
+        Indent(out, depth);
+        out += "}\n";
+    }
+
+    bool SaveToFile(const char* path) const
+    {
+        std::string out;
+        SaveToString(out);
+        FILE* f = fopen(path, "wb");
+        if (!f)
+        {
+            return false;
+        }
+        bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+        return fclose(f) == 0 && ok;
+    }
+
+    void Clear()
+    {
+        for (BpKv* c : m_Children)
+        {
+            delete c;
+        }
+        m_Children.clear();
+    }
+
+private:
+    enum Token
+    {
+        TOK_END,
+        TOK_STRING,
+        TOK_OPEN,
+        TOK_CLOSE,
+        TOK_COND,
+        TOK_ERROR
+    };
+
+    struct Lexer
+    {
+        const char* p;
+        const char* end;
+        const char* begin;
+
+        size_t maxToken;
+        const char* error = nullptr;
+        bool quoted = false;    // the last TOK_STRING was "quoted"
+
+        Lexer(const char* data, size_t len, size_t tokenLimit) : p(data), end(data + len), begin(data), maxToken(tokenLimit) {}
+
+        int Line() const
+        {
+            int line = 1;
+            for (const char* q = begin; q < p; ++q)
+            {
+                line += *q == '\n';
+            }
+            return line;
+        }
+
+        void SkipSpace()
+        {
+            while (p < end)
+            {
+                if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+                {
+                    ++p;
+                }
+                else if (*p == '/' && p + 1 < end && p[1] == '/')
+                {
+                    while (p < end && *p != '\n')
+                    {
+                        ++p;
+                    }
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+
+        bool PeekCond()
+        {
+            const char* q = p;
+            while (q < end && (*q == ' ' || *q == '\t'))
+            {
+                ++q;
+            }
+            return q < end && *q == '[';
+        }
+
+        Token Next(std::string& out)
+        {
+            out.clear();
+            quoted = false;
+            SkipSpace();
+            if (p >= end)
+            {
+                return TOK_END;
+            }
+            char c = *p;
+            if (c == '{')
+            {
+                ++p;
+                return TOK_OPEN;
+            }
+            if (c == '}')
+            {
+                ++p;
+                return TOK_CLOSE;
+            }
+            if (c == '[')
+            {
+                while (p < end && *p != ']' && *p != '\n')
+                {
+                    ++p;
+                }
+                if (p < end && *p == ']')
+                {
+                    ++p;
+                }
+                return TOK_COND;
+            }
+            if (c == '"')
+            {
+                ++p;
+                while (p < end && *p != '"')
+                {
+                    if (out.size() >= maxToken)
+                    {
+                        error = "token too long";
+                        return TOK_ERROR;
+                    }
+                    out += *p++;
+                }
+                if (p >= end)
+                {
+                    error = "unterminated string";
+                    return TOK_ERROR;
+                }
+                ++p;
+                quoted = true;
+                return TOK_STRING;
+            }
+            while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' && *p != '"' && *p != '{' && *p != '}')
+            {
+                if (out.size() >= maxToken)
+                {
+                    error = "token too long";
+                    return TOK_ERROR;
+                }
+                out += *p++;
+            }
+            return TOK_STRING;
+        }
+    };
+
+    static bool NameEq(const char* a, const char* b)
+    {
+        for (; *a && *b; ++a, ++b)
+        {
+            unsigned char ca = (unsigned char)*a;
+            unsigned char cb = (unsigned char)*b;
+            if (ca != cb && tolower(ca) != tolower(cb))
+            {
+                return false;
+            }
+        }
+        return *a == *b;
+    }
+
+    static bool Fail(std::string* error, const Lexer& lx, const char* what)
+    {
+        if (error)
+        {
+            *error = "line " + std::to_string(lx.Line()) + ": " + what;
+        }
+        return false;
+    }
+
+    static void Indent(std::string& out, int depth)
+    {
+        out.append((size_t)depth, '\t');
+    }
+
+    // Written as read: there is no escape, so a " (which would end the
+    // token) is saved as ' instead.
+    static void Quote(std::string& out, const std::string& s)
+    {
+        out += '"';
+        for (char c : s)
+        {
+            out += c == '"' ? '\'' : c;
+        }
+        out += '"';
+    }
+
+    static bool IsDirective(const Lexer& lx, const std::string& key)
+    {
+        return !lx.quoted && (NameEq(key.c_str(), "#include") || NameEq(key.c_str(), "#base"));
+    }
+
+    bool Parse(const char* data, size_t len, std::string* error)
+    {
+        Lexer lx(data, len, m_Limits.maxToken);
+        if (len > m_Limits.maxBytes)
+        {
+            return Fail(error, lx, "file too large");
+        }
+        std::vector<BpKv*> stack(1, this);
+        std::string key, value;
+        size_t nodes = 0;
+        for (;;)
+        {
+            Token t = lx.Next(key);
+            if (t == TOK_END)
+            {
+                break;
+            }
+            if (t == TOK_ERROR)
+            {
+                return Fail(error, lx, lx.error);
+            }
+            if (t == TOK_COND)
+            {
+                continue;
+            }
+            if (t == TOK_CLOSE)
+            {
+                if (stack.size() == 1)
+                {
+                    return Fail(error, lx, "unbalanced '}'");
+                }
+                stack.pop_back();
+                continue;
+            }
+            if (t == TOK_OPEN)
+            {
+                return Fail(error, lx, "'{' without a key");
+            }
+            // #include / #base "file": not used by the plugin's files.
+            if (stack.size() == 1 && IsDirective(lx, key))
+            {
+                if (lx.Next(value) != TOK_STRING)
+                {
+                    return Fail(error, lx, lx.error ? lx.error : "directive without a file");
+                }
+                continue;
+            }
+
+            Token v = lx.Next(value);
+            if (v == TOK_COND)
+            {
+                v = lx.Next(value);
+            }
+            if (v == TOK_ERROR)
+            {
+                return Fail(error, lx, lx.error);
+            }
+            if (++nodes > m_Limits.maxNodes)
+            {
+                return Fail(error, lx, "too many keys");
+            }
+            if (v == TOK_OPEN)
+            {
+                if ((int)stack.size() > m_Limits.maxDepth)
+                {
+                    return Fail(error, lx, "nested too deeply");
+                }
+                BpKv* c = stack.back()->CreateNewKey();
+                c->m_Name = key;
+                stack.push_back(c);
+            }
+            else if (v == TOK_STRING)
+            {
+                BpKv* c = stack.back()->CreateNewKey();
+                c->m_Name = key;
+                c->m_Value = value;
+                c->m_bSection = false;
+            }
+            else
+            {
+                return Fail(error, lx, "key without a value");
+            }
+            if (lx.PeekCond())
+            {
+                lx.Next(value);
+            }
+        }
+        if (stack.size() != 1)
+        {
+            return Fail(error, lx, "missing '}'");
+        }
+        return true;
+    }
+
+    const BpKv* Leaf(const char* key) const
+    {
+        for (const BpKv* c : m_Children)
+        {
+            if (!c->m_bSection && NameEq(c->m_Name.c_str(), key))
+            {
+                return c;
+            }
+        }
+        return nullptr;
+    }
+
+    BpKv* FirstChild(bool section) const
+    {
+        for (BpKv* c : m_Children)
+        {
+            if (c->m_bSection == section)
+            {
+                return c;
+            }
+        }
+        return nullptr;
+    }
+
+    BpKv* Sibling(bool filter, bool section) const
+    {
+        if (!m_pParent)
+        {
+            return nullptr;
+        }
+        const std::vector<BpKv*>& peers = m_pParent->m_Children;
+        for (size_t i = m_Index + 1; i < peers.size(); ++i)
+        {
+            if (!filter || peers[i]->m_bSection == section)
+            {
+                return peers[i];
+            }
+        }
+        return nullptr;
+    }
+
+    std::string m_Name;
+    std::string m_Value;
+    bool m_bSection = true;
+    BpKv* m_pParent = nullptr;
+    size_t m_Index = 0;     // position in the parent's children
+    BpKvLimits m_Limits;
+    std::vector<BpKv*> m_Children;
+};
+
+#endif //_INCLUDE_BLOCKERPASSES_KVTEXT_H_
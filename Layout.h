@@ -0,0 +1,886 @@
+#ifndef _INCLUDE_BLOCKERPASSES_LAYOUT_H_
+#define _INCLUDE_BLOCKERPASSES_LAYOUT_H_
+
+// Layout model and the pure logic around it, shared by the plugin and the
+// offline tools (tools/, bench/). No SDK headers: vector and key-value types
+// are template parameters, instantiated with BpVec and BpKv (KvText.h) by
+// the plugin and the tools alike.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cctype>
+
+static const float BP_PI = 3.14159265358979323846f;
+
+// Polyline walls: at most this many path points per item, and the height
+// and thickness a new one gets.
+static const int BP_POLY_MAX_POINTS = 32;
+static const float BP_POLY_HEIGHT = 256.0f;
+static const float BP_POLY_THICK = 16.0f;
+static const float BP_POLY_TOL = 1.0f;     // units; a point this close to a straight run adds nothing
+
+// Named layers (profiles) per map; an item's 'layers' is a bitmask over them.
+static const int BP_MAX_LAYERS = 32;
+
+struct BpVec
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+
+    BpVec() {}
+    BpVec(float vx, float vy, float vz) : x(vx), y(vy), z(vz) {}
+
+    float& operator[](int i) { return (&x)[i]; }
+    float operator[](int i) const { return (&x)[i]; }
+    BpVec operator+(const BpVec& o) const { return BpVec(x + o.x, y + o.y, z + o.z); }
+    BpVec operator-(const BpVec& o) const { return BpVec(x - o.x, y - o.y, z - o.z); }
+    BpVec operator*(float s) const { return BpVec(x * s, y * s, z * s); }
+    BpVec& operator+=(const BpVec& o) { x += o.x; y += o.y; z += o.z; return *this; }
+};
+
+template <class V, class A>
+struct BpItemT
+{
+    std::string label;
+    std::string path;
+    V pos;
+    A ang;
+    float scale = 1.0f;
+    bool invisible = false;
+    bool isWall = false;
+    V pos2;
+    int beamR = 0;
+    int beamG = 128;
+    int beamB = 255;
+    bool beamRainbow = false;
+    float wallYaw = 0.0f;
+    int itemR = 255;
+    int itemG = 255;
+    int itemB = 255;
+    int minPlayers = -1;
+    uint32_t layers = 0xFFFFFFFFu;
+    // Polyline walls: the path along the floor. pos/pos2 then hold the
+    // bounding box of the compiled wall (BpPolyRefit) and wallYaw is 0.
+    std::vector<V> points;
+    float polyHeight = BP_POLY_HEIGHT;
+    float polyThick = BP_POLY_THICK;
+    // Prefab instances (Prefab.h): the prefab's name, with pos the origin
+    // and ang.y the yaw. Parts expanded from one carry its index in
+    // 'group', which is never stored.
+    std::string prefab;
+    int group = -1;
+};
+
+typedef BpItemT<BpVec, BpVec> BpItem;
+
+template <class V, class A>
+inline void BpPolyRefit(BpItemT<V, A>& it);
+
+// "pts" is "x y z x y z ...", one decimal; a trailing partial point and
+// anything past BP_POLY_MAX_POINTS are ignored.
+template <class V>
+inline void BpParsePoints(const char* s, std::vector<V>& out)
+{
+    out.clear();
+    while ((int)out.size() < BP_POLY_MAX_POINTS)
+    {
+        float v[3];
+        int n = 0;
+        for (; n < 3; ++n)
+        {
+            char* end;
+            v[n] = strtof(s, &end);
+            if (end == s)
+            {
+                break;
+            }
+            s = end;
+        }
+        if (n < 3)
+        {
+            break;
+        }
+        out.push_back(V(v[0], v[1], v[2]));
+    }
+}
+
+template <class V>
+inline std::string BpFormatPoints(const std::vector<V>& points)
+{
+    std::string s;
+    for (const V& p : points)
+    {
+        char buf[160];
+        snprintf(buf, sizeof(buf), "%s%.1f %.1f %.1f", s.empty() ? "" : " ", p.x, p.y, p.z);
+        s += buf;
+    }
+    return s;
+}
+
+// bp_data.ini item keys. KV is anything with the KeyValues getters
+// (GetString/GetInt/GetFloat with defaults).
+template <class KV, class Item>
+inline void BpReadItem(KV* k, Item& it)
+{
+    it.label = k->GetString("label", "");
+    it.path = k->GetString("path", "");
+    it.pos.x = k->GetFloat("px", 0.f);
+    it.pos.y = k->GetFloat("py", 0.f);
+    it.pos.z = k->GetFloat("pz", 0.f);
+    it.ang.x = k->GetFloat("ax", 0.f);
+    it.ang.y = k->GetFloat("ay", 0.f);
+    it.ang.z = k->GetFloat("az", 0.f);
+    it.scale = k->GetFloat("sc", 1.0f);
+    it.invisible = k->GetInt("iv", 0) != 0;
+    it.prefab = k->GetString("prefab", "");
+    it.isWall = it.prefab.empty() && k->GetInt("wall", 0) != 0;     // an instance is never a wall
+    it.minPlayers = k->GetInt("mp", -1);
+    it.layers = (uint32_t)k->GetInt("ly", -1);
+    if (it.isWall)
+    {
+        it.pos2.x = k->GetFloat("p2x", 0.f);
+        it.pos2.y = k->GetFloat("p2y", 0.f);
+        it.pos2.z = k->GetFloat("p2z", 0.f);
+        it.beamR = k->GetInt("br", 0);
+        it.beamG = k->GetInt("bg", 128);
+        it.beamB = k->GetInt("bb", 255);
+        it.beamRainbow = k->GetInt("brb", 0) != 0;
+        it.wallYaw = k->GetFloat("wy", 0.0f);
+        BpParsePoints(k->GetString("pts", ""), it.points);
+        if (!it.points.empty())
+        {
+            it.polyHeight = k->GetFloat("ph", BP_POLY_HEIGHT);
+            it.polyThick = k->GetFloat("pw", BP_POLY_THICK);
+            BpPolyRefit(it);
+        }
+    }
+    else
+    {
+        it.itemR = k->GetInt("ir", 255);
+        it.itemG = k->GetInt("ig", 255);
+        it.itemB = k->GetInt("ib", 255);
+    }
+}
+
+template <class KV, class Item>
+inline void BpWriteItem(KV* k, const Item& it)
+{
+    if (!it.prefab.empty())
+    {
+        k->SetString("prefab", it.prefab.c_str());
+        if (!it.label.empty())
+        {
+            k->SetString("label", it.label.c_str());
+        }
+        k->SetFloat("px", it.pos.x);
+        k->SetFloat("py", it.pos.y);
+        k->SetFloat("pz", it.pos.z);
+        k->SetFloat("ay", it.ang.y);
+        if (it.minPlayers >= 0)
+        {
+            k->SetInt("mp", it.minPlayers);
+        }
+        if (it.layers != 0xFFFFFFFFu)
+        {
+            k->SetInt("ly", (int)it.layers);
+        }
+        return;
+    }
+    // A polyline's corners are its first point twice. BpReadItem rebuilds
+    // the real bounding box from "pts"; a build without polylines sees a
+    // wall with no area there rather than one solid box over the whole path.
+    bool poly = it.isWall && !it.points.empty();
+    const auto& p1 = poly ? it.points[0] : it.pos;
+    const auto& p2 = poly ? it.points[0] : it.pos2;
+    k->SetString("label", it.label.c_str());
+    k->SetString("path", it.path.c_str());
+    k->SetFloat("px", p1.x);
+    k->SetFloat("py", p1.y);
+    k->SetFloat("pz", p1.z);
+    k->SetFloat("ax", it.ang.x);
+    k->SetFloat("ay", it.ang.y);
+    k->SetFloat("az", it.ang.z);
+    k->SetFloat("sc", it.scale);
+    k->SetInt("iv", it.invisible ? 1 : 0);
+    k->SetInt("wall", it.isWall ? 1 : 0);
+    if (it.minPlayers >= 0)
+    {
+        k->SetInt("mp", it.minPlayers);
+    }
+    if (it.layers != 0xFFFFFFFFu)
+    {
+        k->SetInt("ly", (int)it.layers);
+    }
+    if (it.isWall)
+    {
+        k->SetFloat("p2x", p2.x);
+        k->SetFloat("p2y", p2.y);
+        k->SetFloat("p2z", p2.z);
+        k->SetInt("br", it.beamR);
+        k->SetInt("bg", it.beamG);
+        k->SetInt("bb", it.beamB);
+        k->SetInt("brb", it.beamRainbow ? 1 : 0);
+        if (it.wallYaw != 0.0f)
+        {
+            k->SetFloat("wy", it.wallYaw);
+        }
+        if (!it.points.empty())
+        {
+            k->SetString("pts", BpFormatPoints(it.points).c_str());
+            k->SetFloat("ph", it.polyHeight);
+            k->SetFloat("pw", it.polyThick);
+        }
+    }
+    else
+    {
+        k->SetInt("ir", it.itemR);
+        k->SetInt("ig", it.itemG);
+        k->SetInt("ib", it.itemB);
+    }
+}
+
+template <class V>
+inline bool BpVecFinite(const V& v)
+{
+    return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+}
+
+// Items worth keeping after a read: props need a model, walls need nothing,
+// and nothing may carry a NaN or infinity into the engine ("nan" and "inf"
+// parse as floats). Prefab instances are not items themselves; readers that
+// know prefabs expand them (Prefab.h), the rest skip them.
+template <class Item>
+inline bool BpItemUsable(const Item& it)
+{
+    if (!it.prefab.empty() || (it.path.empty() && !it.isWall))
+    {
+        return false;
+    }
+    for (const auto& p : it.points)
+    {
+        if (!BpVecFinite(p))
+        {
+            return false;
+        }
+    }
+    return BpVecFinite(it.pos) && BpVecFinite(it.ang) && std::isfinite(it.scale) &&
+        (!it.isWall || (BpVecFinite(it.pos2) && std::isfinite(it.wallYaw) && std::isfinite(it.polyHeight) &&
+        std::isfinite(it.polyThick)));
+}
+
+// Field-for-field equality, every key bp_data.ini stores.
+template <class Item>
+inline bool BpItemSame(const Item& a, const Item& b)
+{
+    return a.label == b.label && a.path == b.path &&
+        a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.pos.z == b.pos.z &&
+        a.ang.x == b.ang.x && a.ang.y == b.ang.y && a.ang.z == b.ang.z &&
+        a.pos2.x == b.pos2.x && a.pos2.y == b.pos2.y && a.pos2.z == b.pos2.z &&
+        a.scale == b.scale && a.invisible == b.invisible && a.isWall == b.isWall &&
+        a.beamR == b.beamR && a.beamG == b.beamG && a.beamB == b.beamB && a.beamRainbow == b.beamRainbow &&
+        a.wallYaw == b.wallYaw && a.itemR == b.itemR && a.itemG == b.itemG && a.itemB == b.itemB &&
+        a.minPlayers == b.minPlayers && a.layers == b.layers && a.prefab == b.prefab && a.points.size() == b.points.size() &&
+        std::equal(a.points.begin(), a.points.end(), b.points.begin(), [](const decltype(a.pos)& p, const decltype(a.pos)& q) {
+            return p.x == q.x && p.y == q.y && p.z == q.z;
+        }) &&
+        (a.points.empty() || (a.polyHeight == b.polyHeight && a.polyThick == b.polyThick));
+}
+
+inline std::string BpNormalizeMapName(const char* in)
+{
+    if (!in || !*in)
+    {
+        return "";
+    }
+    std::string s(in);
+
+    size_t pipePos = s.find(" | ");
+    if (pipePos != std::string::npos)
+    {
+        s = s.substr(0, pipePos);
+    }
+
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    size_t pos = s.find_last_of('/');
+    if (pos != std::string::npos)
+    {
+        s = s.substr(pos + 1);
+    }
+    pos = s.find_last_of('.');
+    if (pos != std::string::npos)
+    {
+        s = s.substr(0, pos);
+    }
+    return s;
+}
+
+inline void BpHueToRGB(float hue, int& r, int& g, int& b)
+{
+    float h = fmodf(hue, 360.0f) / 60.0f;
+    int i = (int)h;
+    float f = h - i;
+    int v = 255;
+    int q = (int)(255 * (1.0f - f));
+    int t = (int)(255 * f);
+    switch (i % 6)
+    {
+        case 0: r = v; g = t; b = 0; break;
+        case 1: r = q; g = v; b = 0; break;
+        case 2: r = 0; g = v; b = t; break;
+        case 3: r = 0; g = q; b = v; break;
+        case 4: r = t; g = 0; b = v; break;
+        default: r = v; g = 0; b = q; break;
+    }
+}
+
+template <class V>
+struct BpWallGeomT
+{
+    V corners[8];
+    V center;
+    V mins;
+    V maxs;
+    V surround;     // half-extents of the world box around the collision box
+    float yaw = 0.0f;
+    // Polyline walls: one collision box per straight run, and the outline
+    // as beam endpoint pairs, the first 'outlineEdges' of them drawn at
+    // BEAMS_EDGES. Both empty for a box wall; for a polyline the fields
+    // above are its bounding box.
+    std::vector<BpWallGeomT> boxes;
+    std::vector<V> outline;
+    int outlineEdges = 0;
+};
+
+typedef BpWallGeomT<BpVec> BpWallGeom;
+
+// Box corner pairs drawn as beams: the 12 edges, then the 12 face diagonals.
+static const int BP_WALL_EDGES[12][2] = {
+    {0, 1}, {1, 2}, {2, 3}, {3, 0},
+    {4, 5}, {5, 6}, {6, 7}, {7, 4},
+    {0, 4}, {1, 5}, {2, 6}, {3, 7}
+};
+static const int BP_WALL_DIAGONALS[12][2] = {
+    {0, 2}, {1, 3},
+    {4, 6}, {5, 7},
+    {0, 5}, {1, 4},
+    {3, 6}, {2, 7},
+    {0, 7}, {3, 4},
+    {1, 6}, {2, 5}
+};
+
+// Half-extents of the world-space box around an OBB with half-extents
+// (hx, hy) turned by 'yaw' degrees.
+inline void BpSurroundHalf(float hx, float hy, float yaw, float& outX, float& outY)
+{
+    float cosAbs = fabsf(cosf(yaw * BP_PI / 180.0f));
+    float sinAbs = fabsf(sinf(yaw * BP_PI / 180.0f));
+    outX = fabsf(hx) * cosAbs + fabsf(hy) * sinAbs;
+    outY = fabsf(hx) * sinAbs + fabsf(hy) * cosAbs;
+}
+
+// Corners (rotated about the vertical axis through the box centre), the
+// collision centre and half-extents, and the yaw the collision box needs --
+// zero when the rotation is a multiple of 90 degrees and can be folded into
+// the extents.
+template <class V>
+inline void BpComputeWallGeom(const V& p1, const V& p2, float yaw, BpWallGeomT<V>& g)
+{
+    float minX = fminf(p1.x, p2.x), maxX = fmaxf(p1.x, p2.x);
+    float minY = fminf(p1.y, p2.y), maxY = fmaxf(p1.y, p2.y);
+    float minZ = fminf(p1.z, p2.z), maxZ = fmaxf(p1.z, p2.z);
+
+    V c[8] = {
+        V(minX, minY, minZ), V(maxX, minY, minZ), V(maxX, maxY, minZ), V(minX, maxY, minZ),
+        V(minX, minY, maxZ), V(maxX, minY, maxZ), V(maxX, maxY, maxZ), V(minX, maxY, maxZ)
+    };
+
+    if (yaw != 0.0f)
+    {
+        float cx = (minX + maxX) * 0.5f;
+        float cy = (minY + maxY) * 0.5f;
+        float rad = yaw * BP_PI / 180.0f;
+        float cosA = cosf(rad);
+        float sinA = sinf(rad);
+        for (int i = 0; i < 8; ++i)
+        {
+            float dx = c[i].x - cx;
+            float dy = c[i].y - cy;
+            c[i].x = cx + dx * cosA - dy * sinA;
+            c[i].y = cy + dx * sinA + dy * cosA;
+        }
+    }
+    for (int i = 0; i < 8; ++i)
+    {
+        g.corners[i] = c[i];
+    }
+
+    float halfExt[3];
+    for (int a = 0; a < 3; ++a)
+    {
+        float lo = fminf(p1[a], p2[a]);
+        float hi = fmaxf(p1[a], p2[a]);
+        g.center[a] = (lo + hi) * 0.5f;
+        halfExt[a] = fmaxf((hi - lo) * 0.5f, 1.0f);
+    }
+
+    float normalYaw = fmodf(yaw, 360.0f);
+    if (normalYaw < 0.0f)
+    {
+        normalYaw += 360.0f;
+    }
+
+    bool isAxisAligned = (normalYaw < 1.0f || fabsf(normalYaw - 90.0f) < 1.0f ||
+                          fabsf(normalYaw - 180.0f) < 1.0f || fabsf(normalYaw - 270.0f) < 1.0f ||
+                          normalYaw > 359.0f);
+
+    float hx = halfExt[0], hy = halfExt[1];
+    if (isAxisAligned)
+    {
+        if (fabsf(normalYaw - 90.0f) < 1.0f || fabsf(normalYaw - 270.0f) < 1.0f)
+        {
+            float tmp = hx;
+            hx = hy;
+            hy = tmp;
+        }
+        g.yaw = 0.0f;
+    }
+    else
+    {
+        g.yaw = yaw;
+    }
+    g.mins = V(-hx, -hy, -halfExt[2]);
+    g.maxs = V(hx, hy, halfExt[2]);
+    float sx, sy;
+    BpSurroundHalf(hx, hy, g.yaw, sx, sy);
+    g.surround = V(sx, sy, halfExt[2]);
+    g.boxes.clear();
+    g.outline.clear();
+    g.outlineEdges = 0;
+}
+
+// True when every point strictly between path[a] and path[c] lies within
+// BP_POLY_TOL of the straight line between them (and between them along it).
+template <class V>
+inline bool BpPolyStraight(const std::vector<V>& path, size_t a, size_t c)
+{
+    float ex = path[c].x - path[a].x, ey = path[c].y - path[a].y, ez = path[c].z - path[a].z;
+    float len = sqrtf(ex * ex + ey * ey);
+    if (len < BP_POLY_TOL)
+    {
+        return false;
+    }
+    for (size_t k = a + 1; k < c; ++k)
+    {
+        float px = path[k].x - path[a].x, py = path[k].y - path[a].y;
+        float along = (px * ex + py * ey) / len;
+        if (along < 0.0f || along > len || fabsf(px * ey - py * ex) / len > BP_POLY_TOL ||
+            fabsf(path[k].z - (path[a].z + ez * along / len)) > BP_POLY_TOL)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The path a polyline wall is compiled from: points closer than
+// BP_POLY_TOL on the floor to the previous one are dropped, then each run
+// of points that is straight within BP_POLY_TOL becomes one segment.
+template <class V>
+inline void BpPolySimplify(const std::vector<V>& points, std::vector<V>& out)
+{
+    std::vector<V> path;
+    for (const V& p : points)
+    {
+        if (path.empty() || fabsf(p.x - path.back().x) >= BP_POLY_TOL || fabsf(p.y - path.back().y) >= BP_POLY_TOL)
+        {
+            path.push_back(p);
+        }
+    }
+    out.clear();
+    if (path.empty())
+    {
+        return;
+    }
+    out.push_back(path[0]);
+    for (size_t a = 0; a + 1 < path.size();)
+    {
+        size_t c = a + 1;
+        while (c + 1 < path.size() && BpPolyStraight(path, a, c + 1))
+        {
+            ++c;
+        }
+        out.push_back(path[c]);
+        a = c;
+    }
+}
+
+// Compiles a polyline wall: 'thick' wide, standing 'height' on each point.
+// Every segment of the simplified path is one turned box; at a joint both
+// boxes run on to the outer mitre point (at most thick/2, past that the
+// square ends already close the gap), so the joint is solid without a
+// box of its own. The outline runs along both sides at the floor and the
+// top with a cap at each end -- 4 beams per segment plus 8 -- and BEAMS_FULL
+// adds the two uprights at every joint. A path that collapses to one point
+// is a post, like a box wall with no area.
+template <class V>
+inline void BpCompilePolyline(const std::vector<V>& points, float height, float thick, BpWallGeomT<V>& g)
+{
+    std::vector<V> path;
+    BpPolySimplify(points, path);
+    float h = fmaxf(height, 2.0f);
+    float r = fmaxf(thick, 2.0f) * 0.5f;
+    if (path.size() < 2)
+    {
+        V p = path.empty() ? V(0.0f, 0.0f, 0.0f) : path[0];
+        BpComputeWallGeom(V(p.x - r, p.y - r, p.z), V(p.x + r, p.y + r, p.z + h), 0.0f, g);
+        return;
+    }
+
+    size_t n = path.size() - 1;
+    std::vector<float> dx(n), dy(n), ext(n + 1, 0.0f);
+    for (size_t s = 0; s < n; ++s)
+    {
+        float ex = path[s + 1].x - path[s].x, ey = path[s + 1].y - path[s].y;
+        float len = sqrtf(ex * ex + ey * ey);
+        dx[s] = ex / len;
+        dy[s] = ey / len;
+    }
+    for (size_t i = 1; i < n; ++i)
+    {
+        float c = dx[i - 1] * dx[i] + dy[i - 1] * dy[i];   // cosine of the turn
+        ext[i] = c <= 0.0f ? r : r * sqrtf((1.0f - c) / (1.0f + c));
+    }
+
+    std::vector<BpWallGeomT<V>> boxes(n);
+    V lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (size_t s = 0; s < n; ++s)
+    {
+        const V& a = path[s];
+        const V& b = path[s + 1];
+        float ex = b.x - a.x, ey = b.y - a.y;
+        float half = sqrtf(ex * ex + ey * ey) * 0.5f + (ext[s] + ext[s + 1]) * 0.5f;
+        float shift = (ext[s + 1] - ext[s]) * 0.5f;
+        float cx = (a.x + b.x) * 0.5f + dx[s] * shift;
+        float cy = (a.y + b.y) * 0.5f + dy[s] * shift;
+        float zlo = fminf(a.z, b.z), zhi = fmaxf(a.z, b.z) + h;
+        float yaw = atan2f(dy[s], dx[s]) * 180.0f / BP_PI;
+        BpComputeWallGeom(V(cx - half, cy - r, zlo), V(cx + half, cy + r, zhi), yaw, boxes[s]);
+        for (const V& c : boxes[s].corners)
+        {
+            lo = V(fminf(lo.x, c.x), fminf(lo.y, c.y), fminf(lo.z, c.z));
+            hi = V(fmaxf(hi.x, c.x), fmaxf(hi.y, c.y), fmaxf(hi.z, c.z));
+        }
+    }
+
+    // Side points at each vertex, mitred at the joints (the mitre capped at
+    // a right angle's, like the boxes).
+    std::vector<V> side[2][2];  // [left, right][floor, top]
+    for (size_t i = 0; i <= n; ++i)
+    {
+        size_t s0 = i > 0 ? i - 1 : 0, s1 = i < n ? i : n - 1;
+        float mx = -dy[s0] - dy[s1], my = dx[s0] + dx[s1];
+        float ml = sqrtf(mx * mx + my * my);
+        float k = r;
+        if (ml < 1e-3f)
+        {
+            mx = -dy[s1];   // the path doubles back
+            my = dx[s1];
+        }
+        else
+        {
+            float cosHalf = (mx * -dy[s1] + my * dx[s1]) / ml;
+            k = r / (ml * fmaxf(cosHalf, 0.7071f));
+        }
+        const V& p = path[i];
+        side[0][0].push_back(V(p.x + mx * k, p.y + my * k, p.z));
+        side[0][1].push_back(V(p.x + mx * k, p.y + my * k, p.z + h));
+        side[1][0].push_back(V(p.x - mx * k, p.y - my * k, p.z));
+        side[1][1].push_back(V(p.x - mx * k, p.y - my * k, p.z + h));
+    }
+
+    BpComputeWallGeom(lo, hi, 0.0f, g);
+    auto beam = [&g](const V& a, const V& b) {
+        g.outline.push_back(a);
+        g.outline.push_back(b);
+    };
+    for (size_t s = 0; s < n; ++s)
+    {
+        for (int l = 0; l < 2; ++l)
+        {
+            for (int f = 0; f < 2; ++f)
+            {
+                beam(side[l][f][s], side[l][f][s + 1]);
+            }
+        }
+    }
+    for (size_t i : { (size_t)0, n })
+    {
+        beam(side[0][0][i], side[1][0][i]);
+        beam(side[0][1][i], side[1][1][i]);
+        beam(side[0][0][i], side[0][1][i]);
+        beam(side[1][0][i], side[1][1][i]);
+    }
+    g.outlineEdges = (int)g.outline.size() / 2;
+    for (size_t i = 1; i < n; ++i)
+    {
+        beam(side[0][0][i], side[0][1][i]);
+        beam(side[1][0][i], side[1][1][i]);
+    }
+    g.boxes.swap(boxes);
+}
+
+// Geometry of wall item 'it', box or polyline.
+template <class Item, class V>
+inline void BpComputeItemGeom(const Item& it, BpWallGeomT<V>& g)
+{
+    if (it.points.empty())
+    {
+        BpComputeWallGeom(it.pos, it.pos2, it.wallYaw, g);
+    }
+    else
+    {
+        BpCompilePolyline(it.points, it.polyHeight, it.polyThick, g);
+    }
+}
+
+// Polyline walls keep pos/pos2 as the bounding box of the compiled wall, so
+// whatever only knows box walls (the menus' "move to", the edit list) still
+// finds a box in the right place. BpWriteItem does not store it.
+template <class V, class A>
+inline void BpPolyRefit(BpItemT<V, A>& it)
+{
+    if (it.points.empty())
+    {
+        return;
+    }
+    BpWallGeomT<V> g;
+    BpCompilePolyline(it.points, it.polyHeight, it.polyThick, g);
+    it.pos = V(g.center.x - g.maxs.x, g.center.y - g.maxs.y, g.center.z - g.maxs.z);
+    it.pos2 = V(g.center.x + g.maxs.x, g.center.y + g.maxs.y, g.center.z + g.maxs.z);
+    it.wallYaw = 0.0f;
+}
+
+template <class Item>
+inline int BpThreshold(const Item& it, int defaultThreshold)
+{
+    return it.minPlayers >= 0 ? it.minPlayers : defaultThreshold;
+}
+
+// Item indices ordered by opening threshold; stable, so equal thresholds
+// keep file order.
+template <class Item>
+inline void BpSortByThreshold(const std::vector<Item>& items, int defaultThreshold, std::vector<int>& order)
+{
+    order.resize(items.size());
+    for (int i = 0; i < (int)items.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&items, defaultThreshold](int a, int b) {
+        return BpThreshold(items[a], defaultThreshold) < BpThreshold(items[b], defaultThreshold);
+    });
+}
+
+// First position in 'order' whose item is still closed with 'players' online.
+template <class Item>
+inline size_t BpFirstAbove(const std::vector<int>& order, const std::vector<Item>& items, int defaultThreshold, int players)
+{
+    auto it = std::upper_bound(order.begin(), order.end(), players, [&items, defaultThreshold](int p, int idx) {
+        return p < BpThreshold(items[idx], defaultThreshold);
+    });
+    return (size_t)(it - order.begin());
+}
+
+// Item closest to 'hit' within 'maxDist' of its anchor point, over the
+// entries in [first, last) (index of each given by 'indexOf'); -1 if none.
+template <class Item, class V, class It, class IndexOf>
+inline int BpNearestItem(const std::vector<Item>& items, It first, It last, IndexOf indexOf, const V& hit, float maxDist)
+{
+    int best = -1;
+    float bestSq = maxDist * maxDist;
+    for (; first != last; ++first)
+    {
+        int idx = indexOf(*first);
+        if (idx < 0 || idx >= (int)items.size())
+        {
+            continue;
+        }
+        float dx = items[idx].pos.x - hit.x;
+        float dy = items[idx].pos.y - hit.y;
+        float dz = items[idx].pos.z - hit.z;
+        float dsq = dx * dx + dy * dy + dz * dz;
+        if (dsq <= bestSq)
+        {
+            bestSq = dsq;
+            best = idx;
+        }
+    }
+    return best;
+}
+
+enum BeamDetail
+{
+    BEAMS_NONE = 0,     // no outline
+    BEAMS_EDGES = 1,    // 12 box edges
+    BEAMS_FULL = 2      // edges plus 12 face diagonals
+};
+
+inline int BpBeamsFor(int detail)
+{
+    return detail == BEAMS_FULL ? 24 : (detail == BEAMS_EDGES ? 12 : 0);
+}
+
+// Collision boxes and outline beams of a wall, box or polyline.
+template <class V>
+inline int BpWallBoxes(const BpWallGeomT<V>& g)
+{
+    return g.boxes.empty() ? 1 : (int)g.boxes.size();
+}
+
+template <class V>
+inline const BpWallGeomT<V>& BpWallBox(const BpWallGeomT<V>& g, int k)
+{
+    return g.boxes.empty() ? g : g.boxes[k];
+}
+
+template <class V>
+inline int BpWallBeams(const BpWallGeomT<V>& g, int detail)
+{
+    if (g.outline.empty())
+    {
+        return BpBeamsFor(detail);
+    }
+    return detail == BEAMS_FULL ? (int)g.outline.size() / 2 : (detail == BEAMS_EDGES ? g.outlineEdges : 0);
+}
+
+// Endpoints of beam 'k' (below BpWallBeams(g, BEAMS_FULL)).
+template <class V>
+inline void BpWallBeam(const BpWallGeomT<V>& g, int k, V& a, V& b)
+{
+    if (g.outline.empty())
+    {
+        const int* e = k < 12 ? BP_WALL_EDGES[k] : BP_WALL_DIAGONALS[k - 12];
+        a = g.corners[e[0]];
+        b = g.corners[e[1]];
+        return;
+    }
+    a = g.outline[2 * k];
+    b = g.outline[2 * k + 1];
+}
+
+struct BpBudgetResult
+{
+    int cost = 0;       // entities the plan will create
+    int degraded = 0;   // walls below full outline
+    int skipped = 0;    // props dropped from the plan
+    bool cut = false;
+};
+
+// Fits a round plan into the entity budget: collision boxes are never cut,
+// props come next in plan order, and wall outlines get whatever is left --
+// edges first, then diagonals (joint uprights on a polyline). 'geom' runs
+// parallel to 'spawn', holds every wall's geometry and is compacted with it.
+template <class Item, class Geom>
+inline BpBudgetResult BpAllocateBudget(const std::vector<Item>& items, std::vector<int>& spawn, std::vector<Geom>& geom,
+    std::vector<uint8_t>& beams, int budget)
+{
+    BpBudgetResult res;
+    size_t n = spawn.size();
+    beams.assign(n, BEAMS_FULL);
+    int boxes = 0;
+    int props = 0;
+    int edges = 0;
+    int full = 0;
+    for (size_t k = 0; k < n; ++k)
+    {
+        if (items[spawn[k]].isWall)
+        {
+            boxes += BpWallBoxes(geom[k]);
+            edges += BpWallBeams(geom[k], BEAMS_EDGES);
+            full += BpWallBeams(geom[k], BEAMS_FULL);
+        }
+        else
+        {
+            ++props;
+        }
+    }
+    res.cost = boxes + props + full;
+    if (budget <= 0 || res.cost <= budget)
+    {
+        return res;
+    }
+    res.cut = true;
+
+    int used = boxes;
+    size_t out = 0;
+    for (size_t k = 0; k < n; ++k)
+    {
+        int i = spawn[k];
+        if (!items[i].isWall)
+        {
+            if (used >= budget)
+            {
+                ++res.skipped;
+                continue;
+            }
+            ++used;
+        }
+        spawn[out] = i;
+        if (out != k)
+        {
+            geom[out] = std::move(geom[k]);
+        }
+        ++out;
+    }
+    spawn.resize(out);
+    geom.resize(out);
+    beams.assign(out, BEAMS_NONE);
+
+    int left = budget - used;
+    bool allEdges = left >= edges;
+    if (allEdges)
+    {
+        left -= edges;
+    }
+    for (size_t k = 0; k < out; ++k)
+    {
+        if (!items[spawn[k]].isWall)
+        {
+            continue;
+        }
+        int e = BpWallBeams(geom[k], BEAMS_EDGES);
+        int more = BpWallBeams(geom[k], BEAMS_FULL) - e;
+        if (allEdges)
+        {
+            beams[k] = BEAMS_EDGES;
+            if (left >= more)
+            {
+                beams[k] = BEAMS_FULL;
+                left -= more;
+            }
+        }
+        else if (left >= e)
+        {
+            beams[k] = BEAMS_EDGES;
+            left -= e;
+        }
+        if (beams[k] != BEAMS_FULL)
+        {
+            ++res.degraded;
+        }
+    }
+    res.cost = budget - (left > 0 ? left : 0);
+    return res;
+}
+
+#endif //_INCLUDE_BLOCKERPASSES_LAYOUT_H_
@@ -0,0 +1,103 @@
+#ifndef _INCLUDE_BLOCKERPASSES_PHRASES_H_
+#define _INCLUDE_BLOCKERPASSES_PHRASES_H_
+
+// Chat phrases from blockerpasses.phrases.txt are printf formats filled with
+// the arguments of the built-in fallback. A translation is only safe to use
+// if it consumes the same arguments in the same order: "%s" where the
+// fallback has "%d" reads an int as a pointer.
+
+#include <string>
+
+// Appends one letter per consumed argument to 'out' ('i' int, 'l' long,
+// 'L' long long, 'z' size_t, 'f' double, 's' string, 'p' pointer; '*' width
+// and precision count as 'i'). False for %n, wide %lc/%ls, long double and
+// anything unrecognised.
+inline bool BpFormatArgs(const char* fmt, std::string& out)
+{
+    out.clear();
+    for (const char* p = fmt; *p; ++p)
+    {
+        if (*p != '%')
+        {
+            continue;
+        }
+        ++p;
+        if (*p == '%')
+        {
+            continue;
+        }
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+        {
+            ++p;
+        }
+        for (int part = 0; part < 2; ++part)
+        {
+            if (*p == '*')
+            {
+                out += 'i';
+                ++p;
+            }
+            else
+            {
+                while (*p >= '0' && *p <= '9')
+                {
+                    ++p;
+                }
+            }
+            if (part == 0 && *p == '.')
+            {
+                ++p;
+                continue;
+            }
+            break;
+        }
+        char len = 0;
+        if (*p == 'h')
+        {
+            len = 'h';
+            p += p[1] == 'h' ? 2 : 1;
+        }
+        else if (*p == 'l')
+        {
+            len = p[1] == 'l' ? 'L' : 'l';
+            p += p[1] == 'l' ? 2 : 1;
+        }
+        else if (*p == 'z' || *p == 'j' || *p == 't')
+        {
+            len = 'z';
+            ++p;
+        }
+        switch (*p)
+        {
+            case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+                out += (len && len != 'h') ? len : 'i';
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                if (len && len != 'l')
+                {
+                    return false;
+                }
+                out += 'f';
+                break;
+            case 'c': case 's': case 'p':
+                // %lc / %ls take wide characters.
+                if (len)
+                {
+                    return false;
+                }
+                out += *p == 'c' ? 'i' : *p;
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+inline bool BpFormatCompatible(const char* fmt, const char* reference)
+{
+    std::string a, b;
+    return BpFormatArgs(fmt, a) && BpFormatArgs(reference, b) && a == b;
+}
+
+#endif //_INCLUDE_BLOCKERPASSES_PHRASES_H_
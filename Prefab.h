@@ -0,0 +1,274 @@
+#ifndef _INCLUDE_BLOCKERPASSES_PREFAB_H_
+#define _INCLUDE_BLOCKERPASSES_PREFAB_H_
+
+// Prefabs: a group of items (say a roll-up door, the fence next to it and
+// an invisible wall behind both) defined once in settings.ini and placed
+// in a layout as a single instance item: "prefab" (the name), px/py/pz
+// (the origin) and ay (the yaw), plus the usual label, mp and ly.
+//
+// BpReadPrefabs caches every prefab as a spawn description: each part is a
+// finished item (model path resolved, colours and flags filled in) with its
+// anchor in prefab space, a prop's origin or a box wall's centre and
+// half-extents, so expanding an instance is one turn about z and one
+// translation per part. Quarter turns use exact sines, so a prefab placed
+// at 90 degrees lands on the same grid as one placed at 0.
+//
+// LoadDataForMap expands instances into ordinary items tagged with the
+// instance's index (BpItem::group); SaveData folds them back with
+// BpCollapsePrefabs for as long as they still match a fresh expansion, and
+// writes the parts as plain items once one was edited or deleted. No SDK
+// types: V and A are read through .x/.y/.z like the rest of Layout.h.
+
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "Layout.h"
+
+static const int BP_PREFAB_MAX_PARTS = 64;
+static const float BP_PREFAB_MAX_EXTENT = 65536.0f;    // origins and part offsets; keeps every sum finite
+
+template <class V, class A>
+struct BpPrefabPartT
+{
+    BpItemT<V, A> item;
+    V anchor = V(0.0f, 0.0f, 0.0f);     // prop origin or box wall centre, prefab space
+    V half = V(0.0f, 0.0f, 0.0f);       // box wall half-extents
+};
+
+template <class V, class A>
+struct BpPrefabT
+{
+    std::string name;
+    std::string label;
+    std::vector<BpPrefabPartT<V, A>> parts;
+};
+
+typedef BpPrefabT<BpVec, BpVec> BpPrefab;
+
+template <class V>
+inline bool BpPrefabInRange(const V& v)
+{
+    return fabsf(v.x) <= BP_PREFAB_MAX_EXTENT && fabsf(v.y) <= BP_PREFAB_MAX_EXTENT && fabsf(v.z) <= BP_PREFAB_MAX_EXTENT;
+}
+
+// Instance items worth keeping: a name, and an origin and yaw that expand
+// to finite parts.
+template <class Item>
+inline bool BpInstanceUsable(const Item& it)
+{
+    return !it.prefab.empty() && BpVecFinite(it.pos) && BpPrefabInRange(it.pos) && std::isfinite(it.ang.y);
+}
+
+template <class V, class A>
+inline const BpPrefabT<V, A>* BpFindPrefab(const std::vector<BpPrefabT<V, A>>& prefabs, const std::string& name)
+{
+    for (const BpPrefabT<V, A>& pf : prefabs)
+    {
+        if (pf.name == name)
+        {
+            return &pf;
+        }
+    }
+    return nullptr;
+}
+
+inline void BpYawSinCos(float yaw, float& s, float& c)
+{
+    float q = yaw / 90.0f;
+    if (std::isfinite(q) && q == floorf(q))
+    {
+        static const float QUARTER[5] = { 0.0f, 1.0f, 0.0f, -1.0f, 0.0f };
+        int k = ((int)fmodf(q, 4.0f) + 4) % 4;
+        s = QUARTER[k];
+        c = QUARTER[k + 1];
+        return;
+    }
+    float rad = yaw * BP_PI / 180.0f;
+    s = sinf(rad);
+    c = cosf(rad);
+}
+
+template <class V>
+inline V BpPrefabPlace(const V& p, float s, float c, const V& origin)
+{
+    return V(origin.x + p.x * c - p.y * s, origin.y + p.x * s + p.y * c, origin.z + p.z);
+}
+
+// settings.ini "prefabs": one subkey per prefab, named as instances refer
+// to it, with an optional "label" and its parts as subkeys in bp_data.ini
+// item keys, positions relative to the prefab origin. A part's "model" may
+// name a "models" entry (key or label) instead of giving the "path". Parts
+// that are unusable, out of range or name an unknown model are skipped, and
+// so is a prefab left with no parts or whose name is taken. KV is BpKv or
+// KeyValues.
+template <class KV, class V, class A>
+inline void BpReadPrefabs(KV* settings, std::vector<BpPrefabT<V, A>>& out)
+{
+    out.clear();
+    KV* list = settings->FindKey("prefabs", false);
+    KV* models = settings->FindKey("models", false);
+    for (KV* p = list ? list->GetFirstTrueSubKey() : nullptr; p; p = p->GetNextTrueSubKey())
+    {
+        BpPrefabT<V, A> pf;
+        pf.name = p->GetName();
+        const char* label = p->GetString("label", "");
+        pf.label = (label && *label) ? label : pf.name;
+        for (KV* k = p->GetFirstTrueSubKey(); k && (int)pf.parts.size() < BP_PREFAB_MAX_PARTS; k = k->GetNextTrueSubKey())
+        {
+            BpPrefabPartT<V, A> part;
+            BpItemT<V, A>& it = part.item;
+            BpReadItem(k, it);
+            const char* model = k->GetString("model", "");
+            if (!it.isWall && it.path.empty() && model && *model)
+            {
+                for (KV* m = models ? models->GetFirstTrueSubKey() : nullptr; m; m = m->GetNextTrueSubKey())
+                {
+                    const char* ml = m->GetString("label", "");
+                    if (!strcmp(m->GetName(), model) || (ml && !strcmp(ml, model)))
+                    {
+                        const char* path = m->GetString("path", "");
+                        it.path = path ? path : "";
+                        break;
+                    }
+                }
+            }
+            bool inRange = BpPrefabInRange(it.pos) && (!it.isWall || BpPrefabInRange(it.pos2));
+            for (const V& q : it.points)
+            {
+                inRange &= BpPrefabInRange(q);
+            }
+            if (!BpItemUsable(it) || !inRange)
+            {
+                continue;
+            }
+            if (it.isWall && it.points.empty())
+            {
+                for (int a = 0; a < 3; ++a)
+                {
+                    float lo = fminf(it.pos[a], it.pos2[a]);
+                    float hi = fmaxf(it.pos[a], it.pos2[a]);
+                    part.anchor[a] = (lo + hi) * 0.5f;
+                    part.half[a] = (hi - lo) * 0.5f;
+                }
+            }
+            else
+            {
+                part.anchor = it.pos;
+            }
+            pf.parts.push_back(std::move(part));
+        }
+        if (!pf.parts.empty() && !BpFindPrefab(out, pf.name))
+        {
+            out.push_back(std::move(pf));
+        }
+    }
+}
+
+// Appends the parts of 'pf' placed for instance 'inst', tagged 'group'.
+// The instance's threshold and layers, when set, replace the parts'; parts
+// without a label take the instance's, or the prefab's.
+template <class V, class A>
+inline void BpExpandPrefab(const BpPrefabT<V, A>& pf, const BpItemT<V, A>& inst, int group, std::vector<BpItemT<V, A>>& out)
+{
+    float s, c;
+    BpYawSinCos(inst.ang.y, s, c);
+    for (const BpPrefabPartT<V, A>& part : pf.parts)
+    {
+        out.push_back(part.item);
+        BpItemT<V, A>& it = out.back();
+        it.group = group;
+        if (it.label.empty())
+        {
+            it.label = inst.label.empty() ? pf.label : inst.label;
+        }
+        if (inst.minPlayers >= 0)
+        {
+            it.minPlayers = inst.minPlayers;
+        }
+        if (inst.layers != 0xFFFFFFFFu)
+        {
+            it.layers = inst.layers;
+        }
+        if (!it.points.empty())
+        {
+            for (V& p : it.points)
+            {
+                p = BpPrefabPlace(p, s, c, inst.pos);
+            }
+            BpPolyRefit(it);
+        }
+        else if (it.isWall)
+        {
+            V o = BpPrefabPlace(part.anchor, s, c, inst.pos);
+            it.pos = V(o.x - part.half.x, o.y - part.half.y, o.z - part.half.z);
+            it.pos2 = V(o.x + part.half.x, o.y + part.half.y, o.z + part.half.z);
+            it.wallYaw += inst.ang.y;
+        }
+        else
+        {
+            it.pos = BpPrefabPlace(part.anchor, s, c, inst.pos);
+            it.ang.y += inst.ang.y;
+        }
+    }
+}
+
+// What SaveData writes, in order: the parts of an instance that still
+// match its expansion fold back into the instance at its first part's
+// place, the parts of an edited one are written as they are, and an
+// instance whose prefab is unknown (so it has no parts) is kept as read,
+// after everything else. An instance whose parts were all deleted is gone.
+template <class V, class A>
+inline void BpCollapsePrefabs(const std::vector<BpItemT<V, A>>& items, const std::vector<BpItemT<V, A>>& instances,
+    const std::vector<BpPrefabT<V, A>>& prefabs, std::vector<const BpItemT<V, A>*>& out)
+{
+    out.clear();
+    std::vector<std::vector<int>> parts(instances.size());
+    for (int i = 0; i < (int)items.size(); ++i)
+    {
+        int g = items[i].group;
+        if (g >= 0 && g < (int)instances.size())
+        {
+            parts[g].push_back(i);
+        }
+    }
+    std::vector<uint8_t> intact(instances.size(), 0);
+    std::vector<BpItemT<V, A>> fresh;
+    for (size_t g = 0; g < instances.size(); ++g)
+    {
+        const BpPrefabT<V, A>* pf = BpFindPrefab(prefabs, instances[g].prefab);
+        if (!pf || parts[g].empty())
+        {
+            continue;
+        }
+        fresh.clear();
+        BpExpandPrefab(*pf, instances[g], (int)g, fresh);
+        bool same = fresh.size() == parts[g].size();
+        for (size_t k = 0; k < fresh.size() && same; ++k)
+        {
+            same = BpItemSame(fresh[k], items[parts[g][k]]);
+        }
+        intact[g] = same ? 1 : 0;
+    }
+    for (const BpItemT<V, A>& it : items)
+    {
+        int g = it.group;
+        if (g < 0 || g >= (int)instances.size() || !intact[g])
+        {
+            out.push_back(&it);
+        }
+        else if (&it == &items[parts[g][0]])
+        {
+            out.push_back(&instances[g]);
+        }
+    }
+    for (size_t g = 0; g < instances.size(); ++g)
+    {
+        if (parts[g].empty() && !BpFindPrefab(prefabs, instances[g].prefab))
+        {
+            out.push_back(&instances[g]);
+        }
+    }
+}
+
+#endif //_INCLUDE_BLOCKERPASSES_PREFAB_H_
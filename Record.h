@@ -0,0 +1,808 @@
+#ifndef _INCLUDE_BLOCKERPASSES_RECORD_H_
+#define _INCLUDE_BLOCKERPASSES_RECORD_H_
+
+// Record/replay trace of plugin-engine interactions (mm_bp_record). The
+// plugin writes every entry point it handles, the layout and player state
+// the handlers depend on, and every call it makes through IBpBackend; the
+// replay tool (tools/bp_replay.cpp) feeds the same stream into the plugin's
+// own handlers (Core.h) against MockBackend.
+//
+// File layout: "BPREC" + version byte + start time (double), then records of
+//   u8 type, varint microseconds since the previous record, payload.
+// Integers are LEB128 varints (signed ones zigzagged), floats raw 32-bit
+// little-endian, strings a varint length plus bytes. An hour of editing is
+// typically a few hundred KB.
+//
+// The writer only appends to a memory buffer on the game thread; full
+// chunks are handed to a background thread that owns the file.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include "Layout.h"
+#include "Backend.h"
+
+static const char BP_REC_MAGIC[5] = { 'B', 'P', 'R', 'E', 'C' };
+static const uint8_t BP_REC_VERSION = 2;     // 2: polyline walls; version 1 traces still read
+
+enum BpRecType : uint8_t
+{
+    // Entry points.
+    REC_MAP_START = 1,  // str map
+    REC_MAP_END,
+    REC_ROUND_PREPARE,
+    REC_ROUND_START,
+    REC_PLAYER_PING,    // slot, x, y, z
+    REC_PLAYER_EVENT,   // slot, kind (BpRecPlayerEvent)
+    REC_MENU,           // slot, str menu, str key, item
+    REC_COMMAND,        // slot, str command line
+    REC_DONE,           // time spent in the preceding entry point, us
+
+    // State the handlers read.
+    REC_PLAYER,         // slot, flags (BpRecPlayerFlags), team
+    REC_CONFIG,         // min players, budget, layer, ignore spectators
+    REC_LAYOUT,         // str map, count, items -- replaces the item list
+    REC_ITEM_SET,       // index, item
+    REC_ITEM_ADD,       // item, appended
+    REC_ITEM_DEL,       // index
+
+    // Outbound engine calls.
+    REC_CALL,           // op (BpRecCall), entity id, str detail
+
+    REC_TYPE_COUNT
+};
+
+enum BpRecPlayerEvent
+{
+    RPE_TEAM = 0,
+    RPE_CONNECT_FULL,
+    RPE_DISCONNECT
+};
+
+enum BpRecPlayerFlags
+{
+    RPF_CONNECTED = 1,
+    RPF_IN_GAME = 2,
+    RPF_FAKE = 4
+};
+
+// Same order as MockBackend::Op, so replay counts line up with recorded ones.
+enum BpRecCall
+{
+    RC_CREATE = 0,
+    RC_SPAWN,
+    RC_TELEPORT,
+    RC_SET_MODEL,
+    RC_REMOVE,
+    RC_STATE_CHANGED,
+    RC_NEXT_FRAME,
+    RC_TIMER,
+    RC_RAY_TRACE,
+    RC_PLAYER_QUERY,
+    RC_SET_FIELD,       // detail: the NetToken
+    RC_SET_BOUNDS,
+    RC_MENU,            // detail: the menu's name
+    RC_CHAT,
+    RC_COUNT
+};
+
+static const char* const BP_REC_TYPE_NAMES[REC_TYPE_COUNT] = {
+    "?", "map_start", "map_end", "round_prepare", "round_start", "player_ping", "player_event",
+    "menu", "command", "done", "player", "config", "layout", "item_set", "item_add", "item_del", "call"
+};
+
+class BpRecWriter
+{
+public:
+    ~BpRecWriter()
+    {
+        Close();
+    }
+
+    // 'maxBytes' caps the file; records past it are counted, not written.
+    bool Open(const char* path, double now, uint64_t maxBytes)
+    {
+        Close();
+        m_File = fopen(path, "wb");
+        if (!m_File)
+        {
+            return false;
+        }
+        m_MaxBytes = maxBytes;
+        m_Bytes = 0;
+        m_Records = 0;
+        m_Dropped = 0;
+        m_Last = now;
+        m_Buf.clear();
+        m_Buf.append(BP_REC_MAGIC, sizeof(BP_REC_MAGIC));
+        m_Buf.push_back((char)BP_REC_VERSION);
+        m_Buf.append((const char*)&now, sizeof(now));
+        m_bStop = false;
+        m_Thread = std::thread(&BpRecWriter::Worker, this);
+        return true;
+    }
+
+    void Close()
+    {
+        if (!m_File)
+        {
+            return;
+        }
+        Handoff();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_bStop = true;
+        }
+        m_Cv.notify_one();
+        m_Thread.join();
+        fclose(m_File);
+        m_File = nullptr;
+    }
+
+    bool IsOpen() const { return m_File != nullptr; }
+    uint64_t Bytes() const { return m_Bytes + m_Buf.size(); }
+    uint64_t Records() const { return m_Records; }
+    uint64_t Dropped() const { return m_Dropped; }
+
+    // A record is Begin(), any number of Put*(), End().
+    void Begin(uint8_t type, double now)
+    {
+        m_Rec.clear();
+        m_Rec.push_back((char)type);
+        double dt = now - m_Last;
+        PutU(dt > 0.0 ? (uint64_t)(dt * 1000000.0 + 0.5) : 0);
+        if (dt > 0.0)
+        {
+            m_Last = now;
+        }
+    }
+
+    void End()
+    {
+        if (m_Bytes + m_Buf.size() + m_Rec.size() > m_MaxBytes)
+        {
+            ++m_Dropped;
+            return;
+        }
+        m_Buf += m_Rec;
+        ++m_Records;
+        if (m_Buf.size() >= CHUNK_BYTES)
+        {
+            Handoff();
+        }
+    }
+
+    void PutU(uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            m_Rec.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        m_Rec.push_back((char)v);
+    }
+
+    void PutS(int64_t v)
+    {
+        PutU(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+    }
+
+    void PutF(float v)
+    {
+        m_Rec.append((const char*)&v, sizeof(v));
+    }
+
+    void PutStr(const char* s)
+    {
+        size_t len = s ? strlen(s) : 0;
+        PutU(len);
+        m_Rec.append(s ? s : "", len);
+    }
+
+    template <class V>
+    void PutVec(const V& v)
+    {
+        PutF(v.x);
+        PutF(v.y);
+        PutF(v.z);
+    }
+
+    template <class Item>
+    void PutItem(const Item& it)
+    {
+        PutStr(it.label.c_str());
+        PutStr(it.path.c_str());
+        PutU((it.invisible ? 1 : 0) | (it.isWall ? 2 : 0) | (it.beamRainbow ? 4 : 0) | (it.points.empty() ? 0 : 8));
+        PutVec(it.pos);
+        PutVec(it.ang);
+        PutVec(it.pos2);
+        PutF(it.scale);
+        PutF(it.wallYaw);
+        PutU((uint64_t)(it.beamR & 255) | (uint64_t)(it.beamG & 255) << 8 | (uint64_t)(it.beamB & 255) << 16);
+        PutU((uint64_t)(it.itemR & 255) | (uint64_t)(it.itemG & 255) << 8 | (uint64_t)(it.itemB & 255) << 16);
+        PutS(it.minPlayers);
+        PutU(it.layers);
+        if (!it.points.empty())
+        {
+            PutU(it.points.size());
+            for (const auto& p : it.points)
+            {
+                PutVec(p);
+            }
+            PutF(it.polyHeight);
+            PutF(it.polyThick);
+        }
+    }
+
+    // Brings 'shadow' (the item list as last recorded) up to 'items' with
+    // ITEM_DEL / ITEM_SET / ITEM_ADD records. The plugin edits, appends or
+    // erases one item at a time, which comes out as one record each.
+    template <class Item>
+    void SyncItems(double now, const std::vector<Item>& items, std::vector<Item>& shadow)
+    {
+        while (shadow.size() > items.size())
+        {
+            size_t p = 0;
+            while (p < items.size() && BpItemSame(items[p], shadow[p]))
+            {
+                ++p;
+            }
+            Begin(REC_ITEM_DEL, now);
+            PutU(p);
+            End();
+            shadow.erase(shadow.begin() + p);
+        }
+        for (size_t i = 0; i < shadow.size(); ++i)
+        {
+            if (!BpItemSame(items[i], shadow[i]))
+            {
+                Begin(REC_ITEM_SET, now);
+                PutU(i);
+                PutItem(items[i]);
+                End();
+                shadow[i] = items[i];
+            }
+        }
+        while (shadow.size() < items.size())
+        {
+            Begin(REC_ITEM_ADD, now);
+            PutItem(items[shadow.size()]);
+            End();
+            shadow.push_back(items[shadow.size()]);
+        }
+    }
+
+private:
+    static const size_t CHUNK_BYTES = 64 * 1024;
+
+    void Handoff()
+    {
+        if (m_Buf.empty())
+        {
+            return;
+        }
+        m_Bytes += m_Buf.size();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Queue.push_back(std::move(m_Buf));
+        }
+        m_Buf = std::string();
+        m_Buf.reserve(CHUNK_BYTES + 256);
+        m_Cv.notify_one();
+    }
+
+    void Worker()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        while (true)
+        {
+            m_Cv.wait(lock, [this]() { return m_bStop || !m_Queue.empty(); });
+            while (!m_Queue.empty())
+            {
+                std::string chunk = std::move(m_Queue.front());
+                m_Queue.pop_front();
+                lock.unlock();
+                fwrite(chunk.data(), 1, chunk.size(), m_File);
+                lock.lock();
+            }
+            if (m_bStop)
+            {
+                break;
+            }
+        }
+        fflush(m_File);
+    }
+
+    FILE* m_File = nullptr;
+    std::string m_Buf;
+    std::string m_Rec;
+    double m_Last = 0.0;
+    uint64_t m_MaxBytes = 0;
+    uint64_t m_Bytes = 0;
+    uint64_t m_Records = 0;
+    uint64_t m_Dropped = 0;
+    std::thread m_Thread;
+    std::mutex m_Mutex;
+    std::condition_variable m_Cv;
+    std::deque<std::string> m_Queue;
+    bool m_bStop = false;
+};
+
+struct BpRecEvent
+{
+    uint8_t type = 0;
+    double time = 0.0;          // seconds since the start of the trace
+    int slot = -1;
+    int64_t a = 0;              // kind / op / index / flags / min players / us
+    int64_t b = 0;              // entity id / team / budget / item
+    int64_t c = 0;              // layer
+    int64_t d = 0;              // ignore spectators
+    BpVec v;
+    std::string s1;             // map / menu / command / call detail
+    std::string s2;             // menu key
+    std::vector<BpItem> items;  // LAYOUT, ITEM_SET, ITEM_ADD
+};
+
+class BpRecReader
+{
+public:
+    bool Open(const std::string& data, std::string* error = nullptr)
+    {
+        m_Data = (const uint8_t*)data.data();
+        m_End = m_Data + data.size();
+        m_Pos = m_Data;
+        m_Now = 0.0;
+        m_bBad = false;
+        if (data.size() < sizeof(BP_REC_MAGIC) + 1 + sizeof(double) || memcmp(m_Data, BP_REC_MAGIC, sizeof(BP_REC_MAGIC)))
+        {
+            return Fail(error, "not a BlockerPasses trace");
+        }
+        if (m_Data[sizeof(BP_REC_MAGIC)] < 1 || m_Data[sizeof(BP_REC_MAGIC)] > BP_REC_VERSION)
+        {
+            return Fail(error, "unsupported trace version");
+        }
+        memcpy(&m_Start, m_Data + sizeof(BP_REC_MAGIC) + 1, sizeof(double));
+        m_Pos = m_Data + sizeof(BP_REC_MAGIC) + 1 + sizeof(double);
+        return true;
+    }
+
+    // False at the end of the trace or on a malformed record (Bad()).
+    bool Next(BpRecEvent& ev)
+    {
+        if (m_bBad || m_Pos >= m_End)
+        {
+            return false;
+        }
+        ev.type = *m_Pos++;
+        m_Now += (double)GetU() / 1000000.0;
+        ev.time = m_Now;
+        ev.slot = -1;
+        ev.a = ev.b = ev.c = ev.d = 0;
+        ev.s1.clear();
+        ev.s2.clear();
+        ev.items.clear();
+        switch (ev.type)
+        {
+            case REC_MAP_START:
+                GetStr(ev.s1);
+                break;
+            case REC_MAP_END:
+            case REC_ROUND_PREPARE:
+            case REC_ROUND_START:
+                break;
+            case REC_PLAYER_PING:
+                ev.slot = (int)GetU();
+                GetVec(ev.v);
+                break;
+            case REC_PLAYER_EVENT:
+                ev.slot = (int)GetU();
+                ev.a = (int64_t)GetU();
+                break;
+            case REC_MENU:
+                ev.slot = (int)GetU();
+                GetStr(ev.s1);
+                GetStr(ev.s2);
+                ev.a = GetS();
+                break;
+            case REC_COMMAND:
+                ev.slot = (int)GetS();
+                GetStr(ev.s1);
+                break;
+            case REC_DONE:
+                ev.a = (int64_t)GetU();
+                break;
+            case REC_PLAYER:
+                ev.slot = (int)GetU();
+                ev.a = (int64_t)GetU();
+                ev.b = GetS();
+                break;
+            case REC_CONFIG:
+                ev.a = GetS();
+                ev.b = GetS();
+                ev.c = GetS();
+                ev.d = GetS();
+                break;
+            case REC_LAYOUT:
+            {
+                GetStr(ev.s1);
+                uint64_t n = GetU();
+                if (n > (uint64_t)(m_End - m_Pos))
+                {
+                    m_bBad = true;
+                    break;
+                }
+                ev.items.resize((size_t)n);
+                for (BpItem& it : ev.items)
+                {
+                    GetItem(it);
+                }
+                break;
+            }
+            case REC_ITEM_SET:
+                ev.a = (int64_t)GetU();
+                ev.items.resize(1);
+                GetItem(ev.items[0]);
+                break;
+            case REC_ITEM_ADD:
+                ev.items.resize(1);
+                GetItem(ev.items[0]);
+                break;
+            case REC_ITEM_DEL:
+                ev.a = (int64_t)GetU();
+                break;
+            case REC_CALL:
+                ev.a = (int64_t)GetU();
+                ev.b = (int64_t)GetU();
+                GetStr(ev.s1);
+                break;
+            default:
+                m_bBad = true;
+                break;
+        }
+        return !m_bBad;
+    }
+
+    bool Bad() const { return m_bBad; }
+    double StartTime() const { return m_Start; }
+    size_t Offset() const { return (size_t)(m_Pos - m_Data); }
+
+private:
+    static bool Fail(std::string* error, const char* what)
+    {
+        if (error)
+        {
+            *error = what;
+        }
+        return false;
+    }
+
+    uint64_t GetU()
+    {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (m_Pos >= m_End)
+            {
+                m_bBad = true;
+                return 0;
+            }
+            uint8_t b = *m_Pos++;
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80))
+            {
+                return v;
+            }
+        }
+        m_bBad = true;
+        return 0;
+    }
+
+    int64_t GetS()
+    {
+        uint64_t u = GetU();
+        return (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+    }
+
+    float GetF()
+    {
+        float v = 0.0f;
+        if (m_End - m_Pos < (ptrdiff_t)sizeof(v))
+        {
+            m_bBad = true;
+            return v;
+        }
+        memcpy(&v, m_Pos, sizeof(v));
+        m_Pos += sizeof(v);
+        return v;
+    }
+
+    void GetStr(std::string& out)
+    {
+        uint64_t len = GetU();
+        if (len > (uint64_t)(m_End - m_Pos))
+        {
+            m_bBad = true;
+            return;
+        }
+        out.assign((const char*)m_Pos, (size_t)len);
+        m_Pos += len;
+    }
+
+    void GetVec(BpVec& v)
+    {
+        v.x = GetF();
+        v.y = GetF();
+        v.z = GetF();
+    }
+
+    void GetItem(BpItem& it)
+    {
+        GetStr(it.label);
+        GetStr(it.path);
+        uint64_t flags = GetU();
+        it.invisible = (flags & 1) != 0;
+        it.isWall = (flags & 2) != 0;
+        it.beamRainbow = (flags & 4) != 0;
+        GetVec(it.pos);
+        GetVec(it.ang);
+        GetVec(it.pos2);
+        it.scale = GetF();
+        it.wallYaw = GetF();
+        uint64_t beam = GetU();
+        it.beamR = (int)(beam & 255);
+        it.beamG = (int)(beam >> 8 & 255);
+        it.beamB = (int)(beam >> 16 & 255);
+        uint64_t color = GetU();
+        it.itemR = (int)(color & 255);
+        it.itemG = (int)(color >> 8 & 255);
+        it.itemB = (int)(color >> 16 & 255);
+        it.minPlayers = (int)GetS();
+        it.layers = (uint32_t)GetU();
+        it.points.clear();
+        if (flags & 8)
+        {
+            uint64_t n = GetU();
+            if (n > (uint64_t)BP_POLY_MAX_POINTS)
+            {
+                m_bBad = true;
+                return;
+            }
+            it.points.resize((size_t)n);
+            for (BpVec& p : it.points)
+            {
+                GetVec(p);
+            }
+            it.polyHeight = GetF();
+            it.polyThick = GetF();
+        }
+    }
+
+    const uint8_t* m_Data = nullptr;
+    const uint8_t* m_End = nullptr;
+    const uint8_t* m_Pos = nullptr;
+    double m_Start = 0.0;
+    double m_Now = 0.0;
+    bool m_bBad = false;
+};
+
+// IBpBackend decorator that records each call before forwarding it. Entities
+// get small sequential ids in the trace; player queries are recorded without
+// their answers (the handlers' view of players comes from REC_PLAYER).
+// Reads that change nothing in the game (liveness, fields, files, globals)
+// are forwarded unrecorded.
+class BpRecBackend final : public IBpBackend
+{
+public:
+    explicit BpRecBackend(BpRecWriter& w) : m_W(w) {}
+
+    void Attach(IBpBackend* inner)
+    {
+        m_Inner = inner;
+        m_Ids.clear();
+        m_NextId = 1;
+    }
+
+    IBpBackend* Inner() const { return m_Inner; }
+
+    BpEnt CreateEntity(const char* cls) override
+    {
+        BpEnt e = m_Inner->CreateEntity(cls);
+        if (e)
+        {
+            m_Ids[e] = m_NextId++;
+        }
+        Call(RC_CREATE, e, cls);
+        return e;
+    }
+    void Spawn(BpEnt ent, const BpSpawnKV* kv) override
+    {
+        Call(RC_SPAWN, ent, nullptr);
+        m_Inner->Spawn(ent, kv);
+    }
+    void Teleport(BpEnt ent, const BpVec* pos, const BpVec* ang) override
+    {
+        Call(RC_TELEPORT, ent, nullptr);
+        m_Inner->Teleport(ent, pos, ang);
+    }
+    void SetModel(BpEnt ent, const char* model) override
+    {
+        Call(RC_SET_MODEL, ent, model);
+        m_Inner->SetModel(ent, model);
+    }
+    void Remove(BpEnt ent) override
+    {
+        Call(RC_REMOVE, ent, nullptr);
+        m_Ids.erase(ent);
+        m_Inner->Remove(ent);
+    }
+    bool Alive(BpEnt ent) override
+    {
+        return m_Inner->Alive(ent);
+    }
+    void StateChanged(BpEnt ent, const char* cls, const char* field) override
+    {
+        Call(RC_STATE_CHANGED, ent, field);
+        m_Inner->StateChanged(ent, cls, field);
+    }
+    bool SetField(BpEnt ent, NetToken field, const BpFieldValue& value) override
+    {
+        char tok[8];
+        snprintf(tok, sizeof(tok), "%d", (int)field);
+        Call(RC_SET_FIELD, ent, tok);
+        return m_Inner->SetField(ent, field, value);
+    }
+    bool GetField(BpEnt ent, NetToken field, BpFieldValue& out) override
+    {
+        return m_Inner->GetField(ent, field, out);
+    }
+    bool HasCollisionBounds() override
+    {
+        return m_Inner->HasCollisionBounds();
+    }
+    void SetCollisionBounds(BpEnt ent, const BpVec& mins, const BpVec& maxs) override
+    {
+        Call(RC_SET_BOUNDS, ent, nullptr);
+        m_Inner->SetCollisionBounds(ent, mins, maxs);
+    }
+    void FindByName(const char* prefix, const std::function<void(BpEnt ent, const char* name)>& fn) override
+    {
+        m_Inner->FindByName(prefix, fn);
+    }
+    void NextFrame(std::function<void()> fn) override
+    {
+        Call(RC_NEXT_FRAME, nullptr, nullptr);
+        m_Inner->NextFrame(std::move(fn));
+    }
+    void CreateTimer(float delay, std::function<float()> fn) override
+    {
+        Call(RC_TIMER, nullptr, nullptr);
+        m_Inner->CreateTimer(delay, std::move(fn));
+    }
+    double Time() override
+    {
+        return m_Inner->Time();
+    }
+    bool RayTrace(int slot, BpVec& eye, BpVec& hit) override
+    {
+        Call(RC_RAY_TRACE, nullptr, nullptr);
+        return m_Inner->RayTrace(slot, eye, hit);
+    }
+    bool IsConnected(int slot) override
+    {
+        Call(RC_PLAYER_QUERY, nullptr, nullptr);
+        return m_Inner->IsConnected(slot);
+    }
+    bool IsInGame(int slot) override
+    {
+        Call(RC_PLAYER_QUERY, nullptr, nullptr);
+        return m_Inner->IsInGame(slot);
+    }
+    bool IsFakeClient(int slot) override
+    {
+        Call(RC_PLAYER_QUERY, nullptr, nullptr);
+        return m_Inner->IsFakeClient(slot);
+    }
+    int Team(int slot) override
+    {
+        Call(RC_PLAYER_QUERY, nullptr, nullptr);
+        return m_Inner->Team(slot);
+    }
+    uint64_t SteamID(int slot) override
+    {
+        Call(RC_PLAYER_QUERY, nullptr, nullptr);
+        return m_Inner->SteamID(slot);
+    }
+    bool HasPermission(int slot, const char* permission) override
+    {
+        Call(RC_PLAYER_QUERY, nullptr, nullptr);
+        return m_Inner->HasPermission(slot, permission);
+    }
+    bool HasFlag(int slot, const char* flag) override
+    {
+        Call(RC_PLAYER_QUERY, nullptr, nullptr);
+        return m_Inner->HasFlag(slot, flag);
+    }
+    bool TeleportPlayer(int slot, const BpVec& pos, const BpVec& ang) override
+    {
+        Call(RC_TELEPORT, nullptr, nullptr);
+        return m_Inner->TeleportPlayer(slot, pos, ang);
+    }
+    void PrintToChat(int slot, const char* msg) override
+    {
+        Call(RC_CHAT, nullptr, nullptr);
+        m_Inner->PrintToChat(slot, msg);
+    }
+    void PrintToChatAll(const char* msg) override
+    {
+        Call(RC_CHAT, nullptr, nullptr);
+        m_Inner->PrintToChatAll(msg);
+    }
+    void ShowMenu(int slot, const BpMenu& menu) override
+    {
+        Call(RC_MENU, nullptr, menu.name.c_str());
+        m_Inner->ShowMenu(slot, menu);
+    }
+    void CloseMenu(int slot) override
+    {
+        Call(RC_MENU, nullptr, nullptr);
+        m_Inner->CloseMenu(slot);
+    }
+    const char* MapName() override
+    {
+        return m_Inner->MapName();
+    }
+    int TickCount() override
+    {
+        return m_Inner->TickCount();
+    }
+    const char* Language() override
+    {
+        return m_Inner->Language();
+    }
+    size_t FileSize(const char* path) override
+    {
+        return m_Inner->FileSize(path);
+    }
+    bool ReadFile(const char* path, std::string& out) override
+    {
+        return m_Inner->ReadFile(path, out);
+    }
+    bool WriteFile(const char* path, const std::string& data) override
+    {
+        return m_Inner->WriteFile(path, data);
+    }
+    void RemoveFile(const char* path) override
+    {
+        m_Inner->RemoveFile(path);
+    }
+
+private:
+    void Call(BpRecCall op, BpEnt ent, const char* detail)
+    {
+        uint32_t id = 0;
+        if (ent)
+        {
+            auto it = m_Ids.find(ent);
+            id = it != m_Ids.end() ? it->second : 0;
+        }
+        m_W.Begin(REC_CALL, m_Inner->Time());
+        m_W.PutU(op);
+        m_W.PutU(id);
+        m_W.PutStr(detail);
+        m_W.End();
+    }
+
+    IBpBackend* m_Inner = nullptr;
+    BpRecWriter& m_W;
+    std::unordered_map<BpEnt, uint32_t> m_Ids;
+    uint32_t m_NextId = 1;
+};
+
+#endif //_INCLUDE_BLOCKERPASSES_RECORD_H_
@@ -0,0 +1,339 @@
+#ifndef _INCLUDE_BLOCKERPASSES_SIGSCAN_H_
+#define _INCLUDE_BLOCKERPASSES_SIGSCAN_H_
+
+// Multi-pattern signature scanner. Kept free of SDK headers so it can be
+// built into the standalone benchmark (bench/sigscan_bench.cpp).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIGSCAN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <dlfcn.h>
+#include <link.h>
+#include <elf.h>
+#include <sys/stat.h>
+#endif
+
+static const size_t SIG_NOT_FOUND = (size_t)-1;
+
+struct SigPattern
+{
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> mask;      // 1 = byte must match, 0 = wildcard
+    size_t anchor = 0;              // first of two consecutive fixed bytes
+    bool pair = true;               // false if the pattern has no fixed pair
+    size_t offset = SIG_NOT_FOUND;  // first match, relative to the scanned range
+    int hits = 0;                   // capped at 2: only uniqueness matters
+};
+
+// "48 81 C7 ? ? ? ? E9" -- '?' and '??' are wildcards.
+inline bool SigParse(const char* text, SigPattern& out)
+{
+    out = SigPattern();
+    const char* p = text;
+    while (*p)
+    {
+        while (*p == ' ' || *p == '\t')
+        {
+            ++p;
+        }
+        if (!*p)
+        {
+            break;
+        }
+        if (*p == '?')
+        {
+            out.bytes.push_back(0);
+            out.mask.push_back(0);
+            while (*p == '?')
+            {
+                ++p;
+            }
+            continue;
+        }
+        if (!isxdigit((unsigned char)p[0]) || !isxdigit((unsigned char)p[1]))
+        {
+            return false;
+        }
+        char hex[3] = { p[0], p[1], 0 };
+        out.bytes.push_back((uint8_t)strtoul(hex, nullptr, 16));
+        out.mask.push_back(1);
+        p += 2;
+    }
+
+    size_t n = out.bytes.size();
+    for (size_t i = 0; i + 1 < n; ++i)
+    {
+        if (out.mask[i] && out.mask[i + 1])
+        {
+            out.anchor = i;
+            out.pair = true;
+            return true;
+        }
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (out.mask[i])
+        {
+            out.anchor = i;
+            out.pair = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool SigMatchAt(const uint8_t* data, const SigPattern& pat)
+{
+    for (size_t i = 0; i < pat.bytes.size(); ++i)
+    {
+        if (pat.mask[i] && data[i] != pat.bytes[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Records a candidate anchor hit at 'pos'; returns true once the pattern is settled.
+inline bool SigNoteCandidate(const uint8_t* data, size_t size, size_t pos, SigPattern& pat)
+{
+    if (pos < pat.anchor)
+    {
+        return false;
+    }
+    size_t start = pos - pat.anchor;
+    if (start + pat.bytes.size() > size || !SigMatchAt(data + start, pat))
+    {
+        return false;
+    }
+    if (pat.offset == SIG_NOT_FOUND)
+    {
+        pat.offset = start;
+    }
+    return ++pat.hits >= 2;
+}
+
+// Plain byte-at-a-time scan of a single pattern; reference for the benchmark.
+inline void SigScanScalar(const uint8_t* data, size_t size, SigPattern& pat)
+{
+    pat.offset = SIG_NOT_FOUND;
+    pat.hits = 0;
+    size_t n = pat.bytes.size();
+    if (!n || n > size)
+    {
+        return;
+    }
+    for (size_t i = 0; i + n <= size; ++i)
+    {
+        if (SigMatchAt(data + i, pat))
+        {
+            if (pat.offset == SIG_NOT_FOUND)
+            {
+                pat.offset = i;
+            }
+            if (++pat.hits >= 2)
+            {
+                return;
+            }
+        }
+    }
+}
+
+inline unsigned SigLowestBit(unsigned v)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, v);
+    return (unsigned)idx;
+#else
+    return (unsigned)__builtin_ctz(v);
+#endif
+}
+
+// Resolves every pattern in one pass over [data, data + size). Each
+// 16-byte block is loaded once and compared against every pattern's anchor
+// pair; full comparisons only run on anchor hits.
+inline void SigScanMulti(const uint8_t* data, size_t size, SigPattern* pats, size_t count)
+{
+    size_t open = 0;
+    for (size_t k = 0; k < count; ++k)
+    {
+        pats[k].offset = SIG_NOT_FOUND;
+        pats[k].hits = 0;
+        if (!pats[k].bytes.empty())
+        {
+            ++open;
+        }
+    }
+    if (!open)
+    {
+        return;
+    }
+
+    size_t pos = 0;
+#if defined(SIGSCAN_SSE2)
+    struct Lane
+    {
+        __m128i first;
+        __m128i second;
+    };
+    std::vector<Lane> lanes(count);
+    for (size_t k = 0; k < count; ++k)
+    {
+        const SigPattern& p = pats[k];
+        uint8_t b0 = p.bytes.empty() ? 0 : p.bytes[p.anchor];
+        uint8_t b1 = (p.pair && !p.bytes.empty()) ? p.bytes[p.anchor + 1] : 0;
+        lanes[k].first = _mm_set1_epi8((char)b0);
+        lanes[k].second = _mm_set1_epi8((char)b1);
+    }
+    for (; pos + 17 <= size && open; pos += 16)
+    {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(data + pos));
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(data + pos + 1));
+        for (size_t k = 0; k < count; ++k)
+        {
+            SigPattern& p = pats[k];
+            if (p.bytes.empty() || p.hits >= 2)
+            {
+                continue;
+            }
+            __m128i eq = _mm_cmpeq_epi8(v0, lanes[k].first);
+            if (p.pair)
+            {
+                eq = _mm_and_si128(eq, _mm_cmpeq_epi8(v1, lanes[k].second));
+            }
+            unsigned bits = (unsigned)_mm_movemask_epi8(eq);
+            while (bits)
+            {
+                unsigned bit = SigLowestBit(bits);
+                bits &= bits - 1;
+                if (SigNoteCandidate(data, size, pos + bit, p))
+                {
+                    --open;
+                    break;
+                }
+            }
+        }
+    }
+#endif
+    for (; pos < size && open; ++pos)
+    {
+        for (size_t k = 0; k < count; ++k)
+        {
+            SigPattern& p = pats[k];
+            if (p.bytes.empty() || p.hits >= 2 || data[pos] != p.bytes[p.anchor])
+            {
+                continue;
+            }
+            if (p.pair && (pos + 1 >= size || data[pos + 1] != p.bytes[p.anchor + 1]))
+            {
+                continue;
+            }
+            if (SigNoteCandidate(data, size, pos, p))
+            {
+                --open;
+            }
+        }
+    }
+}
+
+struct SigRange
+{
+    const uint8_t* base;
+    size_t size;
+};
+
+struct SigModule
+{
+    const uint8_t* base = nullptr;
+    std::vector<SigRange> text;
+    std::string path;
+    std::string identity;   // GNU build ID, or path:size:mtime when absent
+};
+
+#if defined(__linux__)
+// Describes the loaded ELF image containing 'addr': load base, executable
+// segments and a build identity for the on-disk offset cache.
+inline bool SigDescribeModule(const void* addr, SigModule& out)
+{
+    Dl_info info;
+    if (!dladdr(addr, &info) || !info.dli_fbase)
+    {
+        return false;
+    }
+    out = SigModule();
+    out.base = (const uint8_t*)info.dli_fbase;
+    out.path = info.dli_fname ? info.dli_fname : "";
+
+    const ElfW(Ehdr)* eh = (const ElfW(Ehdr)*)out.base;
+    if (memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0)
+    {
+        return false;
+    }
+    const ElfW(Phdr)* ph = (const ElfW(Phdr)*)(out.base + eh->e_phoff);
+
+    // Shared objects are linked at 0, so p_vaddr is relative to the load base.
+    for (int i = 0; i < eh->e_phnum; ++i)
+    {
+        const uint8_t* seg = out.base + ph[i].p_vaddr;
+        if (ph[i].p_type == PT_LOAD && (ph[i].p_flags & PF_X))
+        {
+            SigRange r = { seg, (size_t)ph[i].p_memsz };
+            out.text.push_back(r);
+        }
+        else if (ph[i].p_type == PT_NOTE && out.identity.empty())
+        {
+            size_t off = 0;
+            while (off + sizeof(ElfW(Nhdr)) <= ph[i].p_memsz)
+            {
+                const ElfW(Nhdr)* nh = (const ElfW(Nhdr)*)(seg + off);
+                const uint8_t* name = (const uint8_t*)(nh + 1);
+                const uint8_t* desc = name + ((nh->n_namesz + 3) & ~3u);
+                if (nh->n_type == NT_GNU_BUILD_ID && nh->n_namesz == 4 && !memcmp(name, "GNU", 4))
+                {
+                    static const char hex[] = "0123456789abcdef";
+                    for (uint32_t b = 0; b < nh->n_descsz; ++b)
+                    {
+                        out.identity += hex[desc[b] >> 4];
+                        out.identity += hex[desc[b] & 15];
+                    }
+                    break;
+                }
+                off += sizeof(ElfW(Nhdr)) + ((nh->n_namesz + 3) & ~3u) + ((nh->n_descsz + 3) & ~3u);
+            }
+        }
+    }
+
+    if (out.identity.empty())
+    {
+        struct stat st;
+        if (!out.path.empty() && stat(out.path.c_str(), &st) == 0)
+        {
+            out.identity = out.path + ":" + std::to_string((long long)st.st_size) + ":" + std::to_string((long long)st.st_mtime);
+        }
+    }
+    return !out.text.empty();
+}
+#else
+inline bool SigDescribeModule(const void*, SigModule&)
+{
+    return false;
+}
+#endif
+
+#endif //_INCLUDE_BLOCKERPASSES_SIGSCAN_H_
@@ -0,0 +1,469 @@
+#ifndef _INCLUDE_BLOCKERPASSES_SPATIAL_H_
+#define _INCLUDE_BLOCKERPASSES_SPATIAL_H_
+
+// Bounding-volume hierarchy over the layout for crosshair picking and "items
+// near me" queries. Every item is one or more boxes turned about the
+// vertical axis: a wall is its collision box (BpComputeWallGeom; a polyline
+// wall one box per compiled segment, so the empty inside of an L or a
+// diagonal does not pick it), a prop a box of BP_PICK_PROP_HALF * scale
+// standing on its origin, since model bounds are not known without the
+// engine.
+//
+// The tree follows g_ItemsRevision like the other per-layout caches: Sync()
+// with an unchanged revision is free, an edit that keeps the item count
+// (move, resize, turn) refits the existing tree bottom-up in O(n), and an
+// add or delete, or every BP_PICK_MAX_REFITS refits, rebuilds it with
+// median splits in O(n log n). No SDK types: items are read through .x/.y/.z.
+
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "Layout.h"
+
+static const float BP_PICK_PROP_HALF = 24.0f;
+static const int BP_PICK_LEAF_SIZE = 4;
+static const int BP_PICK_MAX_REFITS = 32;
+
+struct BpAabb
+{
+    BpVec lo = BpVec(FLT_MAX, FLT_MAX, FLT_MAX);
+    BpVec hi = BpVec(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    void Add(const BpAabb& o)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            lo[a] = fminf(lo[a], o.lo[a]);
+            hi[a] = fmaxf(hi[a], o.hi[a]);
+        }
+    }
+    void Add(const BpVec& p)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            lo[a] = fminf(lo[a], p[a]);
+            hi[a] = fmaxf(hi[a], p[a]);
+        }
+    }
+};
+
+// Box turned by 'yaw' degrees about the vertical axis through 'c'.
+struct BpPickBox
+{
+    BpVec c;
+    BpVec h;
+    float cosY = 1.0f;
+    float sinY = 0.0f;
+};
+
+template <class Item>
+inline void BpPickShape(const Item& it, BpPickBox& out)
+{
+    float yaw;
+    if (it.isWall)
+    {
+        BpWallGeom g;
+        BpComputeWallGeom(BpVec(it.pos.x, it.pos.y, it.pos.z), BpVec(it.pos2.x, it.pos2.y, it.pos2.z), it.wallYaw, g);
+        out.c = g.center;
+        out.h = g.maxs;
+        yaw = g.yaw;
+    }
+    else
+    {
+        float s = fminf(fmaxf(it.scale, 0.05f), 20.0f);
+        float half = BP_PICK_PROP_HALF * s;
+        out.c = BpVec(it.pos.x, it.pos.y, it.pos.z + half);
+        out.h = BpVec(half, half, half);
+        yaw = it.ang.y;
+    }
+    float rad = yaw * BP_PI / 180.0f;
+    out.cosY = cosf(rad);
+    out.sinY = sinf(rad);
+}
+
+// Every pick box of 'it', appended to 'out'; several for a polyline wall.
+template <class Item>
+inline void BpPickShapes(const Item& it, std::vector<BpPickBox>& out)
+{
+    if (!it.isWall || it.points.empty())
+    {
+        out.emplace_back();
+        BpPickShape(it, out.back());
+        return;
+    }
+    std::vector<BpVec> points;
+    points.reserve(it.points.size());
+    for (const auto& q : it.points)
+    {
+        points.push_back(BpVec(q.x, q.y, q.z));
+    }
+    BpWallGeom g;
+    BpCompilePolyline(points, it.polyHeight, it.polyThick, g);
+    auto add = [&out](const BpWallGeom& s) {
+        BpPickBox b;
+        b.c = s.center;
+        b.h = s.maxs;
+        float rad = s.yaw * BP_PI / 180.0f;
+        b.cosY = cosf(rad);
+        b.sinY = sinf(rad);
+        out.push_back(b);
+    };
+    if (g.boxes.empty())
+    {
+        add(g);     // a path with no length is a post
+    }
+    for (const BpWallGeom& s : g.boxes)
+    {
+        add(s);
+    }
+}
+
+inline void BpPickBounds(const BpPickBox& b, BpAabb& out)
+{
+    float hx = fabsf(b.h.x * b.cosY) + fabsf(b.h.y * b.sinY);
+    float hy = fabsf(b.h.x * b.sinY) + fabsf(b.h.y * b.cosY);
+    out.lo = BpVec(b.c.x - hx, b.c.y - hy, b.c.z - b.h.z);
+    out.hi = BpVec(b.c.x + hx, b.c.y + hy, b.c.z + b.h.z);
+}
+
+// Slab test; 't' is the entry distance along 'd' (0 when 'o' is inside).
+inline bool BpRaySlabs(const float o[3], const float d[3], const float lo[3], const float hi[3], float maxT, float& t)
+{
+    float t0 = 0.0f, t1 = maxT;
+    for (int a = 0; a < 3; ++a)
+    {
+        if (fabsf(d[a]) < 1e-12f)
+        {
+            if (o[a] < lo[a] || o[a] > hi[a])
+            {
+                return false;
+            }
+            continue;
+        }
+        float inv = 1.0f / d[a];
+        float ta = (lo[a] - o[a]) * inv;
+        float tb = (hi[a] - o[a]) * inv;
+        if (ta > tb)
+        {
+            std::swap(ta, tb);
+        }
+        t0 = fmaxf(t0, ta);
+        t1 = fminf(t1, tb);
+        if (t0 > t1)
+        {
+            return false;
+        }
+    }
+    t = t0;
+    return true;
+}
+
+inline bool BpRayAabb(const BpVec& o, const BpVec& d, const BpAabb& b, float maxT, float& t)
+{
+    return BpRaySlabs(&o.x, &d.x, &b.lo.x, &b.hi.x, maxT, t);
+}
+
+// Ray against the turned box, in the box's own frame.
+inline bool BpRayPickBox(const BpVec& o, const BpVec& d, const BpPickBox& b, float maxT, float& t)
+{
+    float rx = o.x - b.c.x, ry = o.y - b.c.y;
+    float lo[3] = { rx * b.cosY + ry * b.sinY, -rx * b.sinY + ry * b.cosY, o.z - b.c.z };
+    float ld[3] = { d.x * b.cosY + d.y * b.sinY, -d.x * b.sinY + d.y * b.cosY, d.z };
+    float mn[3] = { -b.h.x, -b.h.y, -b.h.z };
+    return BpRaySlabs(lo, ld, mn, &b.h.x, maxT, t);
+}
+
+// Squared distance from 'p' to the box, 0 inside.
+inline float BpPickDistSq(const BpPickBox& b, const BpVec& p)
+{
+    float rx = p.x - b.c.x, ry = p.y - b.c.y;
+    float l[3] = { rx * b.cosY + ry * b.sinY, -rx * b.sinY + ry * b.cosY, p.z - b.c.z };
+    float sq = 0.0f;
+    for (int a = 0; a < 3; ++a)
+    {
+        float e = fabsf(l[a]) - b.h[a];
+        sq += e > 0.0f ? e * e : 0.0f;
+    }
+    return sq;
+}
+
+inline float BpAabbDistSq(const BpAabb& b, const BpVec& p)
+{
+    float sq = 0.0f;
+    for (int a = 0; a < 3; ++a)
+    {
+        float e = fmaxf(fmaxf(b.lo[a] - p[a], p[a] - b.hi[a]), 0.0f);
+        sq += e * e;
+    }
+    return sq;
+}
+
+class BpItemIndex
+{
+public:
+    template <class Item>
+    void Sync(const std::vector<Item>& items, int revision)
+    {
+        if (revision == m_Revision && items.size() == m_Items)
+        {
+            return;
+        }
+        size_t shapes = m_Shapes.size();
+        m_Shapes.clear();
+        m_Owner.clear();
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            BpPickShapes(items[i], m_Shapes);
+            m_Owner.resize(m_Shapes.size(), (int)i);
+        }
+        bool sameCount = items.size() == m_Items && m_Shapes.size() == shapes && !m_Nodes.empty();
+        m_Items = items.size();
+        m_Bounds.resize(m_Shapes.size());
+        for (size_t k = 0; k < m_Shapes.size(); ++k)
+        {
+            BpPickBounds(m_Shapes[k], m_Bounds[k]);
+        }
+        if (sameCount && m_Refits < BP_PICK_MAX_REFITS)
+        {
+            Refit();
+            ++m_Refits;
+        }
+        else
+        {
+            Build();
+            m_Refits = 0;
+        }
+        m_Revision = revision;
+    }
+
+    void Clear()
+    {
+        m_Shapes.clear();
+        m_Owner.clear();
+        m_Bounds.clear();
+        m_Items = 0;
+        m_Order.clear();
+        m_Nodes.clear();
+        m_Revision = -1;
+    }
+
+    size_t Size() const { return m_Shapes.size(); }
+
+    // Nearest accepted item the ray o + t*d (d unit length) enters with
+    // t <= maxT; -1 if none. 'accept' takes an item index.
+    template <class Accept>
+    int Pick(const BpVec& o, const BpVec& d, float maxT, Accept accept, float* tOut = nullptr) const
+    {
+        int best = -1;
+        float bestT = maxT;
+        int stack[64];
+        int sp = 0;
+        float t;
+        if (m_Nodes.empty() || !BpRayAabb(o, d, m_Nodes[0].box, bestT, t))
+        {
+            return -1;
+        }
+        stack[sp++] = 0;
+        while (sp)
+        {
+            const Node& n = m_Nodes[stack[--sp]];
+            if (!BpRayAabb(o, d, n.box, bestT, t))
+            {
+                continue;
+            }
+            if (n.count)
+            {
+                for (int k = n.first; k < n.first + n.count; ++k)
+                {
+                    int i = m_Order[k];
+                    if (BpRayPickBox(o, d, m_Shapes[i], bestT, t) && (t < bestT || best < 0) && accept(m_Owner[i]))
+                    {
+                        bestT = t;
+                        best = m_Owner[i];
+                    }
+                }
+                continue;
+            }
+            // Far child first on the stack, so the near one is opened first
+            // and tightens bestT for the other.
+            int a = n.first, b = n.first + 1;
+            float ta = FLT_MAX, tb = FLT_MAX;
+            bool ha = BpRayAabb(o, d, m_Nodes[a].box, bestT, ta);
+            bool hb = BpRayAabb(o, d, m_Nodes[b].box, bestT, tb);
+            if (ha && hb && tb < ta)
+            {
+                std::swap(a, b);
+                std::swap(ha, hb);
+            }
+            if (hb)
+            {
+                stack[sp++] = b;
+            }
+            if (ha)
+            {
+                stack[sp++] = a;
+            }
+        }
+        if (tOut && best >= 0)
+        {
+            *tOut = bestT;
+        }
+        return best;
+    }
+
+    // Accepted items within 'radius' of 'p' (distance to the nearest of
+    // their boxes, 0 inside), nearest first, as (distance, index).
+    template <class Accept>
+    void Within(const BpVec& p, float radius, Accept accept, std::vector<std::pair<float, int>>& out) const
+    {
+        out.clear();
+        if (m_Nodes.empty())
+        {
+            return;
+        }
+        float r2 = radius * radius;
+        int stack[64];
+        int sp = 0;
+        stack[sp++] = 0;
+        while (sp)
+        {
+            const Node& n = m_Nodes[stack[--sp]];
+            if (BpAabbDistSq(n.box, p) > r2)
+            {
+                continue;
+            }
+            if (n.count)
+            {
+                for (int k = n.first; k < n.first + n.count; ++k)
+                {
+                    int i = m_Order[k];
+                    float dsq = BpPickDistSq(m_Shapes[i], p);
+                    if (dsq <= r2 && accept(m_Owner[i]))
+                    {
+                        out.emplace_back(sqrtf(dsq), m_Owner[i]);
+                    }
+                }
+                continue;
+            }
+            stack[sp++] = n.first;
+            stack[sp++] = n.first + 1;
+        }
+        std::sort(out.begin(), out.end());
+        // A polyline near 'p' matches once per segment; keep its nearest.
+        if (m_Shapes.size() != m_Items)
+        {
+            m_Seen.assign(m_Items, 0);
+            size_t w = 0;
+            for (const auto& e : out)
+            {
+                if (!m_Seen[e.second])
+                {
+                    m_Seen[e.second] = 1;
+                    out[w++] = e;
+                }
+            }
+            out.resize(w);
+        }
+    }
+
+private:
+    // Inner nodes: children at 'first' and 'first + 1', count 0. Leaves:
+    // m_Order[first, first + count). Children always follow their parent.
+    struct Node
+    {
+        BpAabb box;
+        int first = 0;
+        int count = 0;
+    };
+
+    void Build()
+    {
+        size_t n = m_Shapes.size();
+        m_Order.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            m_Order[i] = (int)i;
+        }
+        m_Nodes.clear();
+        if (!n)
+        {
+            return;
+        }
+        m_Nodes.reserve(2 * n / BP_PICK_LEAF_SIZE + 2);
+        m_Nodes.emplace_back();
+        Split(0, 0, (int)n, 0);
+    }
+
+    void Split(int node, int first, int count, int depth)
+    {
+        BpAabb box, centres;
+        for (int k = first; k < first + count; ++k)
+        {
+            box.Add(m_Bounds[m_Order[k]]);
+            centres.Add(m_Shapes[m_Order[k]].c);
+        }
+        m_Nodes[node].box = box;
+        // The traversal stacks hold 64 entries; depth stays far below that
+        // with median splits (2^30 items).
+        if (count <= BP_PICK_LEAF_SIZE || depth >= 30)
+        {
+            m_Nodes[node].first = first;
+            m_Nodes[node].count = count;
+            return;
+        }
+        int axis = 0;
+        for (int a = 1; a < 3; ++a)
+        {
+            if (centres.hi[a] - centres.lo[a] > centres.hi[axis] - centres.lo[axis])
+            {
+                axis = a;
+            }
+        }
+        int mid = first + count / 2;
+        std::nth_element(m_Order.begin() + first, m_Order.begin() + mid, m_Order.begin() + first + count,
+            [this, axis](int a, int b) { return m_Shapes[a].c[axis] < m_Shapes[b].c[axis]; });
+        int left = (int)m_Nodes.size();
+        m_Nodes.emplace_back();
+        m_Nodes.emplace_back();
+        m_Nodes[node].first = left;
+        m_Nodes[node].count = 0;
+        Split(left, first, mid - first, depth + 1);
+        Split(left + 1, mid, first + count - mid, depth + 1);
+    }
+
+    void Refit()
+    {
+        for (size_t k = m_Nodes.size(); k-- > 0;)
+        {
+            Node& n = m_Nodes[k];
+            BpAabb box;
+            if (n.count)
+            {
+                for (int j = n.first; j < n.first + n.count; ++j)
+                {
+                    box.Add(m_Bounds[m_Order[j]]);
+                }
+            }
+            else
+            {
+                box = m_Nodes[n.first].box;
+                box.Add(m_Nodes[n.first + 1].box);
+            }
+            n.box = box;
+        }
+    }
+
+    std::vector<BpPickBox> m_Shapes;
+    std::vector<int> m_Owner;       // item of each shape
+    std::vector<BpAabb> m_Bounds;
+    std::vector<int> m_Order;
+    std::vector<Node> m_Nodes;
+    size_t m_Items = 0;
+    mutable std::vector<uint8_t> m_Seen;
+    int m_Revision = -1;
+    int m_Refits = 0;
+};
+
+#endif //_INCLUDE_BLOCKERPASSES_SPATIAL_H_
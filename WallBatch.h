@@ -0,0 +1,331 @@
+#ifndef _INCLUDE_BLOCKERPASSES_WALLBATCH_H_
+#define _INCLUDE_BLOCKERPASSES_WALLBATCH_H_
+
+// Wall geometry for many walls at once: the same results as
+// BpComputeWallGeom (corners, collision centre, half-extents and yaw) plus
+// the surrounding box half-extents, from structure-of-arrays input. One
+// kernel, written against a small lane type, is instantiated for AVX2 (8
+// walls per step), SSE2 (4) and plain floats, picked at compile time like
+// SigScan.h; define BP_WALLBATCH_SCALAR to force the scalar lanes.
+//
+// Sine and cosine come from a polynomial on the yaw reduced to +-45 degrees
+// instead of libm, so rotated corners can differ from BpComputeWallGeom in
+// the last bits (tests/wallbatch_props.cpp checks the two agree to 1e-3
+// units, and the lane types against each other).
+// Walls with no yaw, and the collision box of any wall within a degree of
+// a multiple of 90, match exactly. All three lane types run the same
+// operations in the same order and agree bit for bit, as long as the
+// compiler is not allowed to fuse the scalar lanes' multiply-adds (-mfma).
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "Layout.h"
+
+#if !defined(BP_WALLBATCH_SCALAR)
+#if defined(__AVX2__)
+#define BP_WALLBATCH_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BP_WALLBATCH_SSE2 1
+#include <emmintrin.h>
+#endif
+#endif
+
+struct BpLaneScalar
+{
+    typedef float F;
+    typedef int32_t I;
+    typedef bool M;
+    static const int W = 1;
+
+    static F Load(const float* p) { return *p; }
+    static void Store(float* p, F v) { *p = v; }
+    static F Set(float v) { return v; }
+    static F Add(F a, F b) { return a + b; }
+    static F Sub(F a, F b) { return a - b; }
+    static F Mul(F a, F b) { return a * b; }
+    static F Min(F a, F b) { return a < b ? a : b; }
+    static F Max(F a, F b) { return a > b ? a : b; }
+    static F Abs(F a) { return fabsf(a); }
+    static F Neg(F a) { return -a; }
+    static I Round(F a) { return (I)nearbyintf(a); }
+    static F ToF(I a) { return (F)a; }
+    static M Bit(I a, int bit) { return (a & bit) != 0; }
+    static M Lt(F a, F b) { return a < b; }
+    static M Eq(F a, F b) { return a == b; }
+    static M And(M a, M b) { return a && b; }
+    static F Sel(M m, F a, F b) { return m ? a : b; }
+};
+
+#if defined(BP_WALLBATCH_SSE2)
+struct BpLaneSSE2
+{
+    typedef __m128 F;
+    typedef __m128i I;
+    typedef __m128 M;
+    static const int W = 4;
+
+    static F Load(const float* p) { return _mm_loadu_ps(p); }
+    static void Store(float* p, F v) { _mm_storeu_ps(p, v); }
+    static F Set(float v) { return _mm_set1_ps(v); }
+    static F Add(F a, F b) { return _mm_add_ps(a, b); }
+    static F Sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F Mul(F a, F b) { return _mm_mul_ps(a, b); }
+    // minps/maxps return the second operand on ties and NaN, as the scalar
+    // a < b ? a : b does.
+    static F Min(F a, F b) { return _mm_min_ps(a, b); }
+    static F Max(F a, F b) { return _mm_max_ps(a, b); }
+    static F Abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static F Neg(F a) { return _mm_xor_ps(_mm_set1_ps(-0.0f), a); }
+    static I Round(F a) { return _mm_cvtps_epi32(a); }     // nearest-even, as nearbyintf
+    static F ToF(I a) { return _mm_cvtepi32_ps(a); }
+    static M Bit(I a, int bit)
+    {
+        __m128i b = _mm_set1_epi32(bit);
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(a, b), b));
+    }
+    static M Lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+    static M Eq(F a, F b) { return _mm_cmpeq_ps(a, b); }
+    static M And(M a, M b) { return _mm_and_ps(a, b); }
+    static F Sel(M m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+};
+typedef BpLaneSSE2 BpLaneWide;
+#elif defined(BP_WALLBATCH_AVX2)
+struct BpLaneAVX2
+{
+    typedef __m256 F;
+    typedef __m256i I;
+    typedef __m256 M;
+    static const int W = 8;
+
+    static F Load(const float* p) { return _mm256_loadu_ps(p); }
+    static void Store(float* p, F v) { _mm256_storeu_ps(p, v); }
+    static F Set(float v) { return _mm256_set1_ps(v); }
+    static F Add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F Sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F Mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F Min(F a, F b) { return _mm256_min_ps(a, b); }
+    static F Max(F a, F b) { return _mm256_max_ps(a, b); }
+    static F Abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static F Neg(F a) { return _mm256_xor_ps(_mm256_set1_ps(-0.0f), a); }
+    static I Round(F a) { return _mm256_cvtps_epi32(a); }
+    static F ToF(I a) { return _mm256_cvtepi32_ps(a); }
+    static M Bit(I a, int bit)
+    {
+        __m256i b = _mm256_set1_epi32(bit);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(a, b), b));
+    }
+    static M Lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static M Eq(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static M And(M a, M b) { return _mm256_and_ps(a, b); }
+    static F Sel(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+};
+typedef BpLaneAVX2 BpLaneWide;
+#endif
+
+class BpWallBatch
+{
+public:
+    // Input
+    enum
+    {
+        IN_X1, IN_Y1, IN_Z1, IN_X2, IN_Y2, IN_Z2,
+        IN_YAW,         // as stored, for the collision yaw
+        IN_YAW_MOD,     // yaw in [0, 360] as BpComputeWallGeom normalises it
+        IN_COUNT
+    };
+    // Output; corners 4-7 are corners 0-3 at OUT_ZHI instead of OUT_ZLO.
+    enum
+    {
+        OUT_CX0, OUT_CY0, OUT_CX1, OUT_CY1, OUT_CX2, OUT_CY2, OUT_CX3, OUT_CY3,
+        OUT_ZLO, OUT_ZHI,
+        OUT_CENTER_X, OUT_CENTER_Y, OUT_CENTER_Z,
+        OUT_HALF_X, OUT_HALF_Y, OUT_HALF_Z,
+        OUT_YAW,
+        OUT_COS, OUT_SIN,       // of OUT_YAW
+        OUT_SURROUND_X, OUT_SURROUND_Y,
+        OUT_COUNT
+    };
+
+    size_t Size() const { return m_Size; }
+
+    // Capacity is kept a multiple of 8 so the wide kernels need no tail;
+    // the padding lanes hold zero walls.
+    void Resize(size_t n)
+    {
+        m_Size = n;
+        m_Stride = (n + 7) & ~(size_t)7;
+        m_In.assign(m_Stride * IN_COUNT, 0.0f);
+        m_Out.resize(m_Stride * OUT_COUNT);
+    }
+
+    template <class V>
+    void Set(size_t i, const V& p1, const V& p2, float yaw)
+    {
+        float* in = &m_In[i];
+        in[IN_X1 * m_Stride] = p1.x;
+        in[IN_Y1 * m_Stride] = p1.y;
+        in[IN_Z1 * m_Stride] = p1.z;
+        in[IN_X2 * m_Stride] = p2.x;
+        in[IN_Y2 * m_Stride] = p2.y;
+        in[IN_Z2 * m_Stride] = p2.z;
+        in[IN_YAW * m_Stride] = yaw;
+        // fmodf is exact; the + 360 rounds, and BpComputeWallGeom decides
+        // the collision fold on the rounded value, so the kernel must too.
+        float mod = fmodf(yaw, 360.0f);
+        in[IN_YAW_MOD * m_Stride] = mod < 0.0f ? mod + 360.0f : mod;
+    }
+
+    void Compute()
+    {
+#if defined(BP_WALLBATCH_SSE2) || defined(BP_WALLBATCH_AVX2)
+        ComputeWith<BpLaneWide>();
+#else
+        ComputeWith<BpLaneScalar>();
+#endif
+    }
+
+    // Compute() with a given lane type, for checking one against another
+    // (tests/wallbatch_props.cpp).
+    template <class L>
+    void ComputeWith()
+    {
+        size_t n = L::W == 1 ? m_Size : m_Stride;
+        for (size_t i = 0; i < n; i += L::W)
+        {
+            Kernel<L>(i);
+        }
+    }
+
+    float Out(int field, size_t i) const { return m_Out[field * m_Stride + i]; }
+
+    BpVec Corner(size_t i, int k) const
+    {
+        return BpVec(Out(OUT_CX0 + 2 * (k & 3), i), Out(OUT_CY0 + 2 * (k & 3), i), Out(k < 4 ? OUT_ZLO : OUT_ZHI, i));
+    }
+
+    // Beam 'e' of the wireframe: the 12 edges, then the 12 face diagonals.
+    void Edge(size_t i, int e, BpVec& a, BpVec& b) const
+    {
+        const int* pair = e < 12 ? BP_WALL_EDGES[e] : BP_WALL_DIAGONALS[e - 12];
+        a = Corner(i, pair[0]);
+        b = Corner(i, pair[1]);
+    }
+
+    // BpComputeWallGeom's result for wall 'i', with any vector type.
+    template <class V>
+    void Get(size_t i, BpWallGeomT<V>& g) const
+    {
+        for (int k = 0; k < 8; ++k)
+        {
+            BpVec c = Corner(i, k);
+            g.corners[k] = V(c.x, c.y, c.z);
+        }
+        g.center = V(Out(OUT_CENTER_X, i), Out(OUT_CENTER_Y, i), Out(OUT_CENTER_Z, i));
+        g.maxs = V(Out(OUT_HALF_X, i), Out(OUT_HALF_Y, i), Out(OUT_HALF_Z, i));
+        g.mins = V(-g.maxs.x, -g.maxs.y, -g.maxs.z);
+        g.surround = V(Out(OUT_SURROUND_X, i), Out(OUT_SURROUND_Y, i), Out(OUT_HALF_Z, i));
+        g.yaw = Out(OUT_YAW, i);
+        g.boxes.clear();
+        g.outline.clear();
+        g.outlineEdges = 0;
+    }
+
+private:
+    template <class L>
+    static typename L::F Poly(typename L::F x2, float c0, float c1, float c2)
+    {
+        return L::Add(L::Set(c0), L::Mul(x2, L::Add(L::Set(c1), L::Mul(x2, L::Set(c2)))));
+    }
+
+    template <class L>
+    void Kernel(size_t i)
+    {
+        typedef typename L::F F;
+        typedef typename L::M M;
+        const float* in = &m_In[i];
+        float* out = &m_Out[i];
+        size_t s = m_Stride;
+
+        F x1 = L::Load(in + IN_X1 * s), y1 = L::Load(in + IN_Y1 * s), z1 = L::Load(in + IN_Z1 * s);
+        F x2 = L::Load(in + IN_X2 * s), y2 = L::Load(in + IN_Y2 * s), z2 = L::Load(in + IN_Z2 * s);
+        F yaw = L::Load(in + IN_YAW * s);
+        F yawMod = L::Load(in + IN_YAW_MOD * s);
+
+        F half = L::Set(0.5f);
+        F minX = L::Min(x1, x2), maxX = L::Max(x1, x2);
+        F minY = L::Min(y1, y2), maxY = L::Max(y1, y2);
+        F minZ = L::Min(z1, z2), maxZ = L::Max(z1, z2);
+        F cx = L::Mul(L::Add(minX, maxX), half);
+        F cy = L::Mul(L::Add(minY, maxY), half);
+        F cz = L::Mul(L::Add(minZ, maxZ), half);
+
+        // yaw = 90q + r, |r| <= 45, q in 0..4; r is exact.
+        typename L::I q = L::Round(L::Mul(yawMod, L::Set(1.0f / 90.0f)));
+        F r = L::Sub(yawMod, L::Mul(L::ToF(q), L::Set(90.0f)));
+        F a = L::Mul(r, L::Set(BP_PI / 180.0f));
+        F a2 = L::Mul(a, a);
+        // Cephes sinf/cosf minimax coefficients on [-pi/4, pi/4].
+        F sinR = L::Add(a, L::Mul(L::Mul(a, a2), Poly<L>(a2, -1.6666654611e-1f, 8.3321608736e-3f, -1.9515295891e-4f)));
+        F cosR = L::Add(L::Sub(L::Set(1.0f), L::Mul(a2, half)),
+            L::Mul(L::Mul(a2, a2), Poly<L>(a2, 4.166664568298827e-2f, -1.388731625493765e-3f, 2.443315711809948e-5f)));
+        M odd = L::Bit(q, 1);
+        M flip = L::Bit(q, 2);
+        F sinA = L::Sel(odd, cosR, sinR);
+        F cosA = L::Sel(odd, L::Neg(sinR), cosR);
+        sinA = L::Sel(flip, L::Neg(sinA), sinA);
+        cosA = L::Sel(flip, L::Neg(cosA), cosA);
+
+        // Corners, turned about the centre unless the yaw is exactly zero
+        // (BpComputeWallGeom leaves those untouched).
+        M still = L::Eq(yaw, L::Set(0.0f));
+        const F xs[4] = { minX, maxX, maxX, minX };
+        const F ys[4] = { minY, minY, maxY, maxY };
+        for (int k = 0; k < 4; ++k)
+        {
+            F dx = L::Sub(xs[k], cx);
+            F dy = L::Sub(ys[k], cy);
+            F rx = L::Add(cx, L::Sub(L::Mul(dx, cosA), L::Mul(dy, sinA)));
+            F ry = L::Add(cy, L::Add(L::Mul(dx, sinA), L::Mul(dy, cosA)));
+            L::Store(out + (OUT_CX0 + 2 * k) * s, L::Sel(still, xs[k], rx));
+            L::Store(out + (OUT_CY0 + 2 * k) * s, L::Sel(still, ys[k], ry));
+        }
+        L::Store(out + OUT_ZLO * s, minZ);
+        L::Store(out + OUT_ZHI * s, maxZ);
+        L::Store(out + OUT_CENTER_X * s, cx);
+        L::Store(out + OUT_CENTER_Y * s, cy);
+        L::Store(out + OUT_CENTER_Z * s, cz);
+
+        // Collision box: within a degree of a multiple of 90 the turn is
+        // folded into the extents (swapped on odd quadrants) and the yaw
+        // dropped.
+        F one = L::Set(1.0f);
+        F hx = L::Max(L::Mul(L::Sub(maxX, minX), half), one);
+        F hy = L::Max(L::Mul(L::Sub(maxY, minY), half), one);
+        F hz = L::Max(L::Mul(L::Sub(maxZ, minZ), half), one);
+        M aligned = L::Lt(L::Abs(r), one);
+        M swap = L::And(aligned, odd);
+        F bx = L::Sel(swap, hy, hx);
+        F by = L::Sel(swap, hx, hy);
+        F bcos = L::Sel(aligned, one, cosA);
+        F bsin = L::Sel(aligned, L::Set(0.0f), sinA);
+        L::Store(out + OUT_HALF_X * s, bx);
+        L::Store(out + OUT_HALF_Y * s, by);
+        L::Store(out + OUT_HALF_Z * s, hz);
+        L::Store(out + OUT_YAW * s, L::Sel(aligned, L::Set(0.0f), yaw));
+        L::Store(out + OUT_COS * s, bcos);
+        L::Store(out + OUT_SIN * s, bsin);
+        F ac = L::Abs(bcos), as = L::Abs(bsin);
+        L::Store(out + OUT_SURROUND_X * s, L::Add(L::Mul(bx, ac), L::Mul(by, as)));
+        L::Store(out + OUT_SURROUND_Y * s, L::Add(L::Mul(bx, as), L::Mul(by, ac)));
+    }
+
+    size_t m_Size = 0;
+    size_t m_Stride = 0;
+    std::vector<float> m_In;
+    std::vector<float> m_Out;
+};
+
+#endif //_INCLUDE_BLOCKERPASSES_WALLBATCH_H_
@@ -0,0 +1,677 @@
+// Micro-benchmarks for the plugin's pure logic (Layout.h, KvText.h, Spatial.h,
+// WallBatch.h) over
+// fixed synthetic layouts, so numbers are comparable between commits.
+//
+//   g++ -O2 -std=c++17 -I.. bp_bench.cpp -o bp_bench
+//   ./bp_bench [--sizes 10,100,1000,10000] [--reps N] [--warmup N]
+//              [--filter substr] [--json]
+//
+// or configure with --enable-tools (or --tools-only, which needs no SDK or
+// Metamod:Source) and build the bp_bench target.
+//
+// Each case runs 'warmup' untimed repetitions, then 'reps' timed ones; a
+// repetition repeats the operation until it has run for at least ~20 ms, so
+// cheap cases are not dominated by timer resolution. Reported figures are
+// ns per operation (min / median / mean over the repetitions). Layouts are
+// generated from a fixed seed: the same size always yields the same items.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Layout.h"
+#include "KvText.h"
+#include "Spatial.h"
+#include "WallBatch.h"
+
+struct Options
+{
+    std::vector<int> sizes = { 10, 100, 1000, 10000 };
+    int reps = 7;
+    int warmup = 2;
+    const char* filter = nullptr;
+    bool json = false;
+};
+
+struct Result
+{
+    std::string name;
+    int size;
+    uint64_t iters;
+    double minNs;
+    double medianNs;
+    double meanNs;
+};
+
+// Folded into the output so the optimiser cannot drop the measured work.
+static volatile uint64_t g_Sink = 0;
+
+static inline void Sink(uint64_t v)
+{
+    g_Sink = g_Sink + v;
+}
+
+static inline void SinkF(float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    Sink(bits);
+}
+
+static double Now()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t g_Rng;
+
+static uint32_t Rand()
+{
+    g_Rng ^= g_Rng << 13;
+    g_Rng ^= g_Rng >> 7;
+    g_Rng ^= g_Rng << 17;
+    return (uint32_t)(g_Rng >> 16);
+}
+
+static float RandF(float lo, float hi)
+{
+    return lo + (hi - lo) * (float)(Rand() & 0xFFFFFF) / (float)0xFFFFFF;
+}
+
+// Roughly what real maps look like: a third walls, a quarter of those turned
+// off-axis, some rainbow, thresholds spread over 0..12 with many defaults.
+static void MakeLayout(int n, std::vector<BpItem>& items)
+{
+    g_Rng = 0x9E3779B97F4A7C15ull ^ (uint64_t)n;
+    static const float yaws[] = { 0.0f, 90.0f, 180.0f, 270.0f, 30.0f, 45.0f, 135.0f, 317.5f };
+    items.clear();
+    items.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        BpItem& it = items[i];
+        it.pos = BpVec(RandF(-3000.0f, 3000.0f), RandF(-3000.0f, 3000.0f), RandF(-200.0f, 400.0f));
+        it.minPlayers = (Rand() % 3) ? (int)(Rand() % 13) : -1;
+        if (Rand() % 3 == 0)
+        {
+            it.isWall = true;
+            it.pos2 = it.pos + BpVec(RandF(8.0f, 256.0f), RandF(8.0f, 256.0f), RandF(64.0f, 192.0f));
+            it.wallYaw = yaws[(Rand() & 3) ? (Rand() & 3) : 4 + (Rand() & 3)];
+            it.beamRainbow = (Rand() % 5) == 0;
+            it.beamR = (int)(Rand() & 255);
+            it.beamG = (int)(Rand() & 255);
+            it.beamB = (int)(Rand() & 255);
+        }
+        else
+        {
+            char path[96];
+            snprintf(path, sizeof(path), "models/props/de_bench/prop_%03u.vmdl", Rand() % 200);
+            it.path = path;
+            it.ang = BpVec(0.0f, RandF(0.0f, 360.0f), 0.0f);
+            it.scale = (Rand() % 4) ? 1.0f : RandF(0.5f, 2.0f);
+            it.invisible = (Rand() % 10) == 0;
+        }
+    }
+}
+
+static void WriteLayout(const std::vector<BpItem>& items, std::string& out)
+{
+    BpKv root("BlockerPasses");
+    BpKv* map = root.FindKey("de_bench", true);
+    char key[16];
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        snprintf(key, sizeof(key), "%d", (int)i);
+        BpWriteItem(map->FindKey(key, true), items[i]);
+    }
+    out.clear();
+    root.SaveToString(out);
+}
+
+// Runs 'op' (one call == one operation over 'perCall' items) and times it.
+template <class Op>
+static Result Measure(const Options& o, const char* name, int size, uint64_t perCall, Op op)
+{
+    // Calibrate: double the call count until a repetition takes >= 20 ms.
+    uint64_t calls = 1;
+    for (;;)
+    {
+        double t0 = Now();
+        for (uint64_t c = 0; c < calls; ++c)
+        {
+            op();
+        }
+        double dt = Now() - t0;
+        if (dt >= 0.02 || calls >= (1ull << 30))
+        {
+            break;
+        }
+        calls *= 2;
+    }
+    for (int w = 0; w < o.warmup; ++w)
+    {
+        for (uint64_t c = 0; c < calls; ++c)
+        {
+            op();
+        }
+    }
+
+    std::vector<double> ns;
+    for (int r = 0; r < o.reps; ++r)
+    {
+        double t0 = Now();
+        for (uint64_t c = 0; c < calls; ++c)
+        {
+            op();
+        }
+        ns.push_back((Now() - t0) * 1e9 / (double)(calls * perCall));
+    }
+    std::sort(ns.begin(), ns.end());
+    double sum = 0.0;
+    for (double v : ns)
+    {
+        sum += v;
+    }
+
+    Result res;
+    res.name = name;
+    res.size = size;
+    res.iters = calls * perCall;
+    res.minNs = ns.front();
+    res.medianNs = ns[ns.size() / 2];
+    res.meanNs = sum / (double)ns.size();
+    return res;
+}
+
+static bool Wanted(const Options& o, const char* name)
+{
+    return !o.filter || strstr(name, o.filter);
+}
+
+static void RunSize(const Options& o, int n, std::vector<Result>& out)
+{
+    std::vector<BpItem> items;
+    MakeLayout(n, items);
+    uint64_t count = (uint64_t)n;
+
+    std::vector<int> walls;
+    for (int i = 0; i < n; ++i)
+    {
+        if (items[i].isWall)
+        {
+            walls.push_back(i);
+        }
+    }
+    uint64_t wallCount = walls.empty() ? 1 : (uint64_t)walls.size();
+
+    // SpawnWallCollisions: corners, centre and extents of every wall.
+    if (Wanted(o, "wall_geom"))
+    {
+        out.push_back(Measure(o, "wall_geom", n, wallCount, [&]() {
+            BpWallGeom g;
+            for (int i : walls)
+            {
+                BpComputeWallGeom(items[i].pos, items[i].pos2, items[i].wallYaw, g);
+                SinkF(g.center.x + g.maxs.y);
+            }
+        }));
+    }
+
+    // The same through BpWallBatch: fill, compute, read back the collision
+    // box; then the wireframe endpoints straight from the batch.
+    if (Wanted(o, "wall_batch"))
+    {
+        BpWallBatch batch;
+        out.push_back(Measure(o, "wall_batch", n, wallCount, [&]() {
+            batch.Resize(walls.size());
+            for (size_t k = 0; k < walls.size(); ++k)
+            {
+                const BpItem& it = items[walls[k]];
+                batch.Set(k, it.pos, it.pos2, it.wallYaw);
+            }
+            batch.Compute();
+            for (size_t k = 0; k < walls.size(); ++k)
+            {
+                SinkF(batch.Out(BpWallBatch::OUT_CENTER_X, k) + batch.Out(BpWallBatch::OUT_HALF_Y, k));
+            }
+        }));
+        out.push_back(Measure(o, "wireframe_batch", n, wallCount, [&]() {
+            batch.Resize(walls.size());
+            for (size_t k = 0; k < walls.size(); ++k)
+            {
+                const BpItem& it = items[walls[k]];
+                batch.Set(k, it.pos, it.pos2, it.wallYaw);
+            }
+            batch.Compute();
+            for (size_t k = 0; k < walls.size(); ++k)
+            {
+                float acc = 0.0f;
+                BpVec a, b, c, d;
+                for (int e = 0; e < 12; ++e)
+                {
+                    batch.Edge(k, e, a, b);
+                    batch.Edge(k, e + 12, c, d);
+                    acc += (b - a).x + (d - c).y;
+                }
+                SinkF(acc);
+            }
+        }));
+    }
+
+    // DrawWireframe: beam endpoints for the full outline plus a rainbow hue.
+    if (Wanted(o, "wireframe"))
+    {
+        out.push_back(Measure(o, "wireframe", n, wallCount, [&]() {
+            BpWallGeom g;
+            for (int i : walls)
+            {
+                const BpItem& it = items[i];
+                BpComputeWallGeom(it.pos, it.pos2, it.wallYaw, g);
+                float acc = 0.0f;
+                for (int e = 0; e < 12; ++e)
+                {
+                    const BpVec& a = g.corners[BP_WALL_EDGES[e][0]];
+                    const BpVec& b = g.corners[BP_WALL_EDGES[e][1]];
+                    const BpVec& c = g.corners[BP_WALL_DIAGONALS[e][0]];
+                    const BpVec& d = g.corners[BP_WALL_DIAGONALS[e][1]];
+                    acc += (b - a).x + (d - c).y;
+                }
+                int r = it.beamR, gr = it.beamG, bl = it.beamB;
+                if (it.beamRainbow)
+                {
+                    BpHueToRGB((float)(i * 37 % 360), r, gr, bl);
+                }
+                SinkF(acc);
+                Sink((uint64_t)(r + gr + bl));
+            }
+        }));
+    }
+
+    // SpawnOneCollisionBox: world bounds of the (possibly rotated) box.
+    if (Wanted(o, "collision_bounds"))
+    {
+        out.push_back(Measure(o, "collision_bounds", n, wallCount, [&]() {
+            for (int i : walls)
+            {
+                const BpItem& it = items[i];
+                float ox, oy;
+                BpSurroundHalf(fabsf(it.pos2.x - it.pos.x) * 0.5f, fabsf(it.pos2.y - it.pos.y) * 0.5f, it.wallYaw, ox, oy);
+                SinkF(ox + oy);
+            }
+        }));
+    }
+
+    // Round start: threshold order, open set, geometry and budget fit.
+    if (Wanted(o, "round_plan"))
+    {
+        std::vector<int> order, spawn;
+        std::vector<BpWallGeom> geom;
+        std::vector<uint8_t> beams;
+        int players = 0;
+        out.push_back(Measure(o, "round_plan", n, count, [&]() {
+            BpSortByThreshold(items, 4, order);
+            size_t first = BpFirstAbove(order, items, 4, players);
+            players = (players + 3) % 14;
+            spawn.assign(order.begin() + first, order.end());
+            geom.resize(spawn.size());
+            for (size_t k = 0; k < spawn.size(); ++k)
+            {
+                const BpItem& it = items[spawn[k]];
+                if (it.isWall)
+                {
+                    BpComputeWallGeom(it.pos, it.pos2, it.wallYaw, geom[k]);
+                }
+            }
+            BpBudgetResult res = BpAllocateBudget(items, spawn, geom, beams, n * 4);
+            Sink((uint64_t)res.cost);
+        }));
+    }
+
+    // FindItemByCrosshair: nearest live item to a hit point, 64 queries.
+    if (Wanted(o, "nearest"))
+    {
+        std::vector<int> live(n);
+        for (int i = 0; i < n; ++i)
+        {
+            live[i] = i;
+        }
+        std::vector<BpVec> hits;
+        for (int q = 0; q < 64; ++q)
+        {
+            const BpItem& it = items[Rand() % n];
+            hits.push_back(it.pos + BpVec(RandF(-40.0f, 40.0f), RandF(-40.0f, 40.0f), RandF(-20.0f, 20.0f)));
+        }
+        out.push_back(Measure(o, "nearest", n, (uint64_t)hits.size(), [&]() {
+            for (const BpVec& h : hits)
+            {
+                int idx = BpNearestItem(items, live.begin(), live.end(), [](int i) { return i; }, h, 100.0f);
+                Sink((uint64_t)(idx + 1));
+            }
+        }));
+    }
+
+    // Crosshair picking: eye rays from ~100 units off an item through it,
+    // against the BVH and against a scan of every box; then a 1500-unit
+    // edit-list query, and the index build and refit behind them. Picks
+    // accept only live items through a per-item slot table, as the plugin's
+    // g_LiveSlot does.
+    if (Wanted(o, "pick"))
+    {
+        std::vector<BpVec> eyes, dirs;
+        for (int q = 0; q < 64; ++q)
+        {
+            const BpItem& it = items[Rand() % n];
+            BpVec target = it.isWall ? BpVec((it.pos.x + it.pos2.x) * 0.5f, (it.pos.y + it.pos2.y) * 0.5f, (it.pos.z + it.pos2.z) * 0.5f)
+                                     : it.pos + BpVec(0.0f, 0.0f, 20.0f);
+            BpVec eye = target + BpVec(RandF(-100.0f, 100.0f), RandF(-100.0f, 100.0f), RandF(0.0f, 60.0f));
+            BpVec d = target - eye;
+            float len = sqrtf(d.x * d.x + d.y * d.y + d.z * d.z) + 1e-6f;
+            eyes.push_back(eye);
+            dirs.push_back(BpVec(d.x / len, d.y / len, d.z / len));
+        }
+        std::vector<int> liveSlot(n);
+        for (int i = 0; i < n; ++i)
+        {
+            liveSlot[i] = (i % 8) ? i : -1;
+        }
+        auto isLive = [&liveSlot](int i) { return liveSlot[i] >= 0; };
+        BpItemIndex index;
+        int revision = 0;
+        out.push_back(Measure(o, "pick_build", n, count, [&]() {
+            index.Clear();
+            index.Sync(items, ++revision);
+            Sink(index.Size());
+        }));
+        out.push_back(Measure(o, "pick_refit", n, count, [&]() {
+            index.Sync(items, ++revision);
+            Sink(index.Size());
+        }));
+        index.Clear();
+        index.Sync(items, ++revision);
+        out.push_back(Measure(o, "pick", n, (uint64_t)eyes.size(), [&]() {
+            for (size_t q = 0; q < eyes.size(); ++q)
+            {
+                Sink((uint64_t)(index.Pick(eyes[q], dirs[q], 4096.0f, isLive) + 1));
+            }
+        }));
+        std::vector<BpPickBox> boxes(n);
+        for (int i = 0; i < n; ++i)
+        {
+            BpPickShape(items[i], boxes[i]);
+        }
+        out.push_back(Measure(o, "pick_linear", n, (uint64_t)eyes.size(), [&]() {
+            for (size_t q = 0; q < eyes.size(); ++q)
+            {
+                int best = -1;
+                float bestT = 4096.0f, t;
+                for (int i = 0; i < n; ++i)
+                {
+                    if (liveSlot[i] >= 0 && BpRayPickBox(eyes[q], dirs[q], boxes[i], bestT, t))
+                    {
+                        bestT = t;
+                        best = i;
+                    }
+                }
+                Sink((uint64_t)(best + 1));
+            }
+        }));
+        std::vector<std::pair<float, int>> nearby;
+        out.push_back(Measure(o, "pick_within", n, (uint64_t)eyes.size(), [&]() {
+            for (const BpVec& e : eyes)
+            {
+                index.Within(e, 1500.0f, isLive, nearby);
+                Sink(nearby.size());
+            }
+        }));
+    }
+
+    // Rainbow timer: one hue per rainbow wall per tick.
+    if (Wanted(o, "hue"))
+    {
+        float hue = 0.0f;
+        out.push_back(Measure(o, "hue", n, count, [&]() {
+            for (int i = 0; i < n; ++i)
+            {
+                int r = 0, g = 0, b = 0;
+                BpHueToRGB(hue + (float)i, r, g, b);
+                Sink((uint64_t)(r ^ g ^ b));
+            }
+            hue += 7.0f;
+        }));
+    }
+
+    // bp_data.ini round trip.
+    std::string text;
+    WriteLayout(items, text);
+
+    if (Wanted(o, "serialize"))
+    {
+        std::string buf;
+        out.push_back(Measure(o, "serialize", n, count, [&]() {
+            WriteLayout(items, buf);
+            Sink(buf.size());
+        }));
+    }
+
+    if (Wanted(o, "parse"))
+    {
+        out.push_back(Measure(o, "parse", n, count, [&]() {
+            BpKv kv;
+            bool ok = kv.LoadFromBuffer(text.data(), text.size());
+            Sink(ok ? 1 : 0);
+        }));
+    }
+
+    if (Wanted(o, "read_items"))
+    {
+        BpKv kv;
+        kv.LoadFromBuffer(text.data(), text.size());
+        BpKv* map = kv.FindKey("de_bench");
+        std::vector<BpItem> loaded;
+        out.push_back(Measure(o, "read_items", n, count, [&]() {
+            loaded.clear();
+            for (BpKv* k = map ? map->GetFirstTrueSubKey() : nullptr; k; k = k->GetNextTrueSubKey())
+            {
+                BpItem it;
+                BpReadItem(k, it);
+                if (BpItemUsable(it))
+                {
+                    loaded.push_back(std::move(it));
+                }
+            }
+            Sink(loaded.size());
+        }));
+    }
+}
+
+// BpWallBatch against BpComputeWallGeom on random walls and the yaws that
+// sit on the kernel's branches; a mismatch fails the run rather than
+// timing a kernel that is wrong. Yaws stay within a few turns: far out,
+// BpComputeWallGeom's own yaw * pi / 180 loses more than the tolerance.
+static bool CheckWallBatch()
+{
+    static const float yaws[] = {
+        0.0f, -0.0f, 90.0f, -90.0f, 180.0f, 270.0f, 360.0f, 720.0f, 45.0f, -45.0f, 135.0f, 0.999f, 1.001f,
+        89.0f, 89.5f, 90.5f, 91.001f, 269.2f, 359.5f, -359.5f, 30.0f, 317.5f, 1234.5f, -1079.75f
+    };
+    const int n = 20000;
+    std::vector<BpItem> walls(n);
+    g_Rng = 0xC0FFEEull;
+    for (int i = 0; i < n; ++i)
+    {
+        BpItem& it = walls[i];
+        it.pos = BpVec(RandF(-16000.0f, 16000.0f), RandF(-16000.0f, 16000.0f), RandF(-4000.0f, 4000.0f));
+        it.pos2 = it.pos + BpVec(RandF(-512.0f, 512.0f), RandF(-512.0f, 512.0f), RandF(-256.0f, 256.0f));
+        if (i % 7 == 0)
+        {
+            it.pos2.x = it.pos.x;      // flat, clamped to 1
+        }
+        it.wallYaw = (i % 3) ? yaws[Rand() % (sizeof(yaws) / sizeof(yaws[0]))] : RandF(-720.0f, 720.0f);
+    }
+    BpWallBatch batch;
+    batch.Resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        batch.Set(i, walls[i].pos, walls[i].pos2, walls[i].wallYaw);
+    }
+    batch.Compute();
+
+    float worst = 0.0f;
+    int bad = 0;
+    auto close = [&](float got, float want) {
+        float err = fabsf(got - want);
+        worst = fmaxf(worst, err);
+        return err <= 1e-3f + 2e-7f * fabsf(want);
+    };
+    for (int i = 0; i < n; ++i)
+    {
+        BpWallGeom want, got;
+        BpComputeWallGeom(walls[i].pos, walls[i].pos2, walls[i].wallYaw, want);
+        batch.Get(i, got);
+        bool ok = got.yaw == want.yaw;
+        for (int a = 0; a < 3; ++a)
+        {
+            ok &= got.center[a] == want.center[a] && got.maxs[a] == want.maxs[a] && got.mins[a] == want.mins[a];
+            ok &= close(got.surround[a], want.surround[a]);
+            for (int k = 0; k < 8; ++k)
+            {
+                ok &= close(got.corners[k][a], want.corners[k][a]);
+            }
+        }
+        if (!ok && bad++ < 5)
+        {
+            fprintf(stderr, "wall_batch: wall %d (yaw %g) differs from BpComputeWallGeom\n", i, walls[i].wallYaw);
+        }
+    }
+    if (bad)
+    {
+        fprintf(stderr, "wall_batch: %d of %d walls differ, worst corner error %g\n", bad, n, worst);
+    }
+    return bad == 0;
+}
+
+// Independent of layout size; run once.
+static void RunFixed(const Options& o, std::vector<Result>& out)
+{
+    if (Wanted(o, "normalize"))
+    {
+        static const char* names[] = {
+            "de_mirage", "maps/de_inferno.vpk", "workshop/3070212801/de_dust2_remake.vpk",
+            "DE_Ancient | Premier", "cs_office"
+        };
+        const uint64_t count = sizeof(names) / sizeof(names[0]);
+        out.push_back(Measure(o, "normalize", 0, count, [&]() {
+            for (const char* s : names)
+            {
+                Sink(BpNormalizeMapName(s).size());
+            }
+        }));
+    }
+}
+
+static bool ParseSizes(const char* arg, std::vector<int>& sizes)
+{
+    sizes.clear();
+    const char* p = arg;
+    while (*p)
+    {
+        char* end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v <= 0 || v > 1000000)
+        {
+            return false;
+        }
+        sizes.push_back((int)v);
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',')
+        {
+            return false;
+        }
+    }
+    return !sizes.empty();
+}
+
+static void Usage(const char* argv0)
+{
+    fprintf(stderr, "usage: %s [--sizes 10,100,1000,10000] [--reps N] [--warmup N] [--filter substr] [--json]\n", argv0);
+}
+
+int main(int argc, char** argv)
+{
+    Options o;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* a = argv[i];
+        bool hasNext = i + 1 < argc;
+        if (!strcmp(a, "--json"))
+        {
+            o.json = true;
+        }
+        else if (!strcmp(a, "--sizes") && hasNext)
+        {
+            if (!ParseSizes(argv[++i], o.sizes))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (!strcmp(a, "--reps") && hasNext)
+        {
+            o.reps = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--warmup") && hasNext)
+        {
+            o.warmup = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--filter") && hasNext)
+        {
+            o.filter = argv[++i];
+        }
+        else
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (o.reps <= 0 || o.warmup < 0)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (Wanted(o, "wall_batch") && !CheckWallBatch())
+    {
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for (int n : o.sizes)
+    {
+        RunSize(o, n, results);
+    }
+    RunFixed(o, results);
+
+    if (o.json)
+    {
+        printf("{\n  \"reps\": %d,\n  \"warmup\": %d,\n  \"results\": [\n", o.reps, o.warmup);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            printf("    {\"name\": \"%s\", \"size\": %d, \"iters\": %llu, \"min_ns\": %.2f, \"median_ns\": %.2f, \"mean_ns\": %.2f}%s\n",
+                r.name.c_str(), r.size, (unsigned long long)r.iters, r.minNs, r.medianNs, r.meanNs,
+                i + 1 < results.size() ? "," : "");
+        }
+        printf("  ]\n}\n");
+    }
+    else
+    {
+        printf("%-18s %8s %12s %12s %12s\n", "case", "items", "min ns/op", "median", "mean");
+        for (const Result& r : results)
+        {
+            printf("%-18s %8d %12.2f %12.2f %12.2f\n", r.name.c_str(), r.size, r.minNs, r.medianNs, r.meanNs);
+        }
+    }
+    return g_Sink == 0xFFFFFFFFFFFFFFFFull ? 2 : 0;
+}
@@ -36,6 +36,10 @@ parser.options.add_argument('--enable-optimize', action='store_const', const='1'
 parser.options.add_argument('-s', '--sdks', default='all', dest='sdks',
                        help='Build against specified SDKs; valid args are "all", "present", or '
                             'comma-delimited list of engine names (default: "all")')
+parser.options.add_argument('--enable-tools', action='store_const', const='1', dest='tools',
+                       help='Also build the offline tools, benchmarks and checks (bench/, tools/, fuzz/, tests/)')
+parser.options.add_argument('--tools-only', action='store_const', const='1', dest='tools_only',
+                       help='Build only the offline tools, benchmarks and checks; needs no Metamod:Source or HL2SDK')
 parser.options.add_argument('--targets', type=str, dest='targets', default=None,
                             help="Override the target architecture (use commas to separate multiple targets).")
 parser.Configure()
@@ -0,0 +1,145 @@
+#ifndef _INCLUDE_BLOCKERPASSES_FUZZMAIN_H_
+#define _INCLUDE_BLOCKERPASSES_FUZZMAIN_H_
+
+// Shared pieces of the fuzz harnesses. Built with -DBP_LIBFUZZER the
+// harnesses are plain libFuzzer targets; without it this header adds a main()
+// that runs every file (or every file in every directory) given on the
+// command line through LLVMFuzzerTestOneInput once, so any compiler can
+// replay a corpus or a crasher:
+//
+//   ./fuzz_bp_data [--timeout-ms N] <file|dir>...
+//
+// Per-input limits: BpKvLimits below bound what the parser will build, and
+// the driver fails an input that takes longer than the timeout (libFuzzer:
+// -timeout=1 -rss_limit_mb=512 -malloc_limit_mb=128).
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "../KvText.h"
+
+// Inputs past this are ignored; the parser's own byte limit sits just above
+// so the failure path is fuzzed too.
+static const size_t FUZZ_MAX_INPUT = 1u << 20;
+
+inline BpKvLimits FuzzLimits()
+{
+    BpKvLimits l;
+    l.maxBytes = FUZZ_MAX_INPUT / 2;
+    l.maxDepth = 32;
+    l.maxNodes = 100000;
+    l.maxToken = 4096;
+    return l;
+}
+
+#define FUZZ_CHECK(cond)                                                        \
+    do                                                                          \
+    {                                                                           \
+        if (!(cond))                                                            \
+        {                                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            abort();                                                            \
+        }                                                                       \
+    } while (0)
+
+inline bool FuzzSameTree(const BpKv* a, const BpKv* b)
+{
+    if (strcmp(a->GetName(), b->GetName()) || a->IsSection() != b->IsSection() || strcmp(a->GetString(), b->GetString()))
+    {
+        return false;
+    }
+    const BpKv* ca = a->GetFirstSubKey();
+    const BpKv* cb = b->GetFirstSubKey();
+    for (; ca && cb; ca = ca->GetNextKey(), cb = cb->GetNextKey())
+    {
+        if (!FuzzSameTree(ca, cb))
+        {
+            return false;
+        }
+    }
+    return !ca && !cb;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+#ifndef BP_LIBFUZZER
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+static bool FuzzRunFile(const std::string& path, double timeoutMs, double& slowest)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        fprintf(stderr, "%s: cannot open\n", path.c_str());
+        return false;
+    }
+    std::vector<uint8_t> buf;
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+    {
+        buf.insert(buf.end(), chunk, chunk + n);
+    }
+    fclose(f);
+
+    auto t0 = std::chrono::steady_clock::now();
+    LLVMFuzzerTestOneInput(buf.data(), buf.size());
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    if (ms > slowest)
+    {
+        slowest = ms;
+    }
+    if (ms > timeoutMs)
+    {
+        fprintf(stderr, "%s: %.1f ms, over the %.0f ms limit\n", path.c_str(), ms, timeoutMs);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    double timeoutMs = 1000.0;
+    int files = 0;
+    int failed = 0;
+    double slowest = 0.0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--timeout-ms") && i + 1 < argc)
+        {
+            timeoutMs = atof(argv[++i]);
+            continue;
+        }
+        std::error_code ec;
+        if (std::filesystem::is_directory(argv[i], ec))
+        {
+            for (const auto& e : std::filesystem::recursive_directory_iterator(argv[i], ec))
+            {
+                if (e.is_regular_file())
+                {
+                    ++files;
+                    failed += FuzzRunFile(e.path().string(), timeoutMs, slowest) ? 0 : 1;
+                }
+            }
+        }
+        else
+        {
+            ++files;
+            failed += FuzzRunFile(argv[i], timeoutMs, slowest) ? 0 : 1;
+        }
+    }
+    if (!files)
+    {
+        fprintf(stderr, "usage: %s [--timeout-ms N] <file|dir>...\n", argv[0]);
+        return 1;
+    }
+    printf("%d inputs, %d failed, slowest %.2f ms\n", files, failed, slowest);
+    return failed ? 1 : 0;
+}
+#endif
+
+#endif //_INCLUDE_BLOCKERPASSES_FUZZMAIN_H_
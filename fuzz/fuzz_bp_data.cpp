@@ -0,0 +1,143 @@
+// Fuzz target for the bp_data.ini reader: BpKv parsing plus the walk
+// LoadDataForMap does over every map section (budget, layers, items via
+// BpReadItem/BpItemUsable, prefab instances via BpInstanceUsable), the round
+// planning that consumes the items, and the SaveData round trip.
+//
+//   clang++ -g -O1 -std=c++17 -fsanitize=fuzzer,address,undefined -DBP_LIBFUZZER -I.. fuzz_bp_data.cpp -o fuzz_bp_data
+//   mkdir -p corpus_bp_data
+//   ./fuzz_bp_data corpus_bp_data seeds ../data -dict=kv.dict -max_len=65536 -timeout=1 -rss_limit_mb=512 -malloc_limit_mb=128
+//
+// Without -DBP_LIBFUZZER (any compiler) it replays files: ./fuzz_bp_data ../data seeds
+//
+// Checks, besides "does not crash or hang":
+//  - usable items carry no NaN or infinity;
+//  - a parsed tree saved and re-parsed is identical;
+//  - items and instances written back the way SaveData does read back as
+//    the same count.
+
+#include "FuzzMain.h"
+#include "../Layout.h"
+#include "../Prefab.h"
+
+static void CheckMap(BpKv* mapKV)
+{
+    BpNormalizeMapName(mapKV->GetName());
+    int budget = mapKV->GetInt("budget", -1);
+    std::vector<std::string> layers;
+    if (BpKv* layersKV = mapKV->FindKey("layers"))
+    {
+        for (BpKv* l = layersKV->GetFirstValue(); l && (int)layers.size() < BP_MAX_LAYERS; l = l->GetNextValue())
+        {
+            layers.push_back(l->GetString());
+        }
+    }
+
+    // No settings here, so every instance is one of an unknown prefab.
+    std::vector<BpItem> items, instances;
+    for (BpKv* k = mapKV->GetFirstTrueSubKey(); k; k = k->GetNextTrueSubKey())
+    {
+        if (!strcasecmp(k->GetName(), "layers"))
+        {
+            continue;
+        }
+        BpItem it;
+        BpReadItem(k, it);
+        if (BpInstanceUsable(it))
+        {
+            instances.push_back(std::move(it));
+        }
+        else if (BpItemUsable(it))
+        {
+            FUZZ_CHECK(BpVecFinite(it.pos) && BpVecFinite(it.ang));
+            items.push_back(std::move(it));
+        }
+    }
+
+    // BuildRoundPlan / ApplyRoundPlan on what was read.
+    std::vector<int> order;
+    BpSortByThreshold(items, 10, order);
+    FUZZ_CHECK(order.size() == items.size());
+    for (int players : { 0, 5, 10, 64 })
+    {
+        size_t first = BpFirstAbove(order, items, 10, players);
+        FUZZ_CHECK(first <= order.size());
+        std::vector<int> spawn(order.begin() + first, order.end());
+        std::vector<BpWallGeom> geom(spawn.size());
+        for (size_t i = 0; i < spawn.size(); ++i)
+        {
+            const BpItem& it = items[spawn[i]];
+            if (it.isWall)
+            {
+                BpComputeItemGeom(it, geom[i]);
+                FUZZ_CHECK(geom[i].outline.size() % 2 == 0 && geom[i].outlineEdges <= BpWallBeams(geom[i], BEAMS_FULL));
+                FUZZ_CHECK(geom[i].boxes.size() < (size_t)BP_POLY_MAX_POINTS);
+                float ox, oy;
+                BpSurroundHalf(geom[i].maxs.x, geom[i].maxs.y, geom[i].yaw, ox, oy);
+            }
+        }
+        std::vector<uint8_t> beams;
+        BpBudgetResult res = BpAllocateBudget(items, spawn, geom, beams, budget);
+        FUZZ_CHECK(spawn.size() == geom.size() && beams.size() == spawn.size());
+        int cost = 0;
+        size_t walls = 0;
+        for (size_t i = 0; i < spawn.size(); ++i)
+        {
+            bool wall = items[spawn[i]].isWall;
+            cost += wall ? BpWallBoxes(geom[i]) + BpWallBeams(geom[i], beams[i]) : 1;
+            walls += wall ? BpWallBoxes(geom[i]) : 0;
+        }
+        // Collision boxes are never cut, so only a budget they fit in holds.
+        FUZZ_CHECK(!res.cut || (int)walls > budget || cost <= budget);
+    }
+
+    // SaveData: every item back out, then read again.
+    BpKv out("BPData");
+    BpKv* outMap = out.FindKey(mapKV->GetName(), true);
+    std::vector<const BpItem*> list;
+    BpCollapsePrefabs(items, instances, std::vector<BpPrefab>(), list);
+    FUZZ_CHECK(list.size() == items.size() + instances.size());
+    for (const BpItem* it : list)
+    {
+        BpKv* k = outMap->CreateNewKey();
+        k->SetName("item");
+        BpWriteItem(k, *it);
+    }
+    std::string text;
+    out.SaveToString(text);
+    BpKv back("BPData");
+    FUZZ_CHECK(back.LoadFromBuffer(text.data(), text.size()));
+    BpKv* backMap = back.GetFirstTrueSubKey();
+    FUZZ_CHECK(backMap);
+    size_t count = 0;
+    for (BpKv* k = backMap->GetFirstTrueSubKey(); k; k = k->GetNextTrueSubKey())
+    {
+        BpItem it;
+        BpReadItem(k, it);
+        count += BpItemUsable(it) || BpInstanceUsable(it) ? 1 : 0;
+    }
+    FUZZ_CHECK(count == list.size());
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (size > FUZZ_MAX_INPUT)
+    {
+        return 0;
+    }
+    BpKv root("BPData");
+    root.SetLimits(FuzzLimits());
+    // KeyValues keeps what parsed before an error, and so does the plugin.
+    root.LoadFromBuffer((const char*)data, size);
+
+    std::string text;
+    root.SaveToString(text);
+    BpKv again;
+    FUZZ_CHECK(again.LoadFromBuffer(text.data(), text.size()));
+    FUZZ_CHECK(FuzzSameTree(&root, &again));
+
+    for (BpKv* mapKV = root.GetFirstTrueSubKey(); mapKV; mapKV = mapKV->GetNextTrueSubKey())
+    {
+        CheckMap(mapKV);
+    }
+    return 0;
+}
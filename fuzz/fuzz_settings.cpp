@@ -0,0 +1,139 @@
+// Fuzz target for the settings.ini and phrases readers: BpKv parsing plus
+// the walks LoadSettings and LoadPhrases do. Signature patterns from the
+// "signatures" section go through SigParse and both scanners (which must
+// agree), phrase values through the format check PrintChatKey relies on,
+// and prefabs through BpReadPrefabs and an expansion at the map's corners.
+//
+//   clang++ -g -O1 -std=c++17 -fsanitize=fuzzer,address,undefined -DBP_LIBFUZZER -I.. fuzz_settings.cpp -o fuzz_settings
+//   mkdir -p corpus_settings
+//   ./fuzz_settings corpus_settings seeds ../configs ../translations -dict=kv.dict -max_len=65536 -timeout=1 -rss_limit_mb=512 -malloc_limit_mb=128
+//
+// Without -DBP_LIBFUZZER (any compiler) it replays files: ./fuzz_settings ../configs ../translations
+
+#include "FuzzMain.h"
+#include "../SigScan.h"
+#include "../Phrases.h"
+#include "../Prefab.h"
+
+static const char* const SETTINGS_INTS[] = {
+    "min_players_to_open", "debug_log", "ignore_spectators", "idle_mode", "stats_dump", "reload_handoff", "entity_budget"
+};
+static const char* const SETTINGS_STRINGS[] = {
+    "access_permission", "access_flag", "log_level", "log_categories", "log_target", "chat_command",
+    "console_cmd_bp", "console_cmd_access", "console_cmd_profile", "profile"
+};
+static const char* const SIG_NAMES[] = { "SetCollisionBounds" };
+
+static void CheckSignature(const char* text, const uint8_t* data, size_t size)
+{
+    SigPattern scalar;
+    if (!SigParse(text, scalar))
+    {
+        return;
+    }
+    SigPattern multi = scalar;
+    SigScanScalar(data, size, scalar);
+    SigScanMulti(data, size, &multi, 1);
+    FUZZ_CHECK(scalar.offset == multi.offset);
+    FUZZ_CHECK(scalar.hits == multi.hits);
+}
+
+// A phrase accepted for a fallback format must format with that
+// fallback's arguments.
+static void CheckPhrase(const char* value)
+{
+    char buf[256];
+    if (BpFormatCompatible(value, "%d"))
+    {
+        snprintf(buf, sizeof(buf), value, 42);
+    }
+    if (BpFormatCompatible(value, "%s"))
+    {
+        snprintf(buf, sizeof(buf), value, "de_mirage");
+    }
+    if (BpFormatCompatible(value, "%d %s %.1f"))
+    {
+        snprintf(buf, sizeof(buf), value, 7, "x", 1.5);
+    }
+    if (BpFormatCompatible(value, ""))
+    {
+        snprintf(buf, sizeof(buf), value, 0);
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (size > FUZZ_MAX_INPUT)
+    {
+        return 0;
+    }
+    BpKv kv("BlockerPasses");
+    kv.SetLimits(FuzzLimits());
+    kv.LoadFromBuffer((const char*)data, size);
+
+    std::string text;
+    kv.SaveToString(text);
+    BpKv again;
+    FUZZ_CHECK(again.LoadFromBuffer(text.data(), text.size()));
+    FUZZ_CHECK(FuzzSameTree(&kv, &again));
+
+    // LoadSettings.
+    for (const char* key : SETTINGS_INTS)
+    {
+        kv.GetInt(key, 0);
+    }
+    for (const char* key : SETTINGS_STRINGS)
+    {
+        kv.GetString(key, "");
+    }
+    if (BpKv* sigs = kv.FindKey("signatures"))
+    {
+        for (const char* name : SIG_NAMES)
+        {
+            BpKv* list = sigs->FindKey(name);
+            for (BpKv* v = list ? list->GetFirstValue() : nullptr; v; v = v->GetNextValue())
+            {
+                CheckSignature(v->GetString(), data, size);
+            }
+        }
+    }
+    if (BpKv* models = kv.FindKey("models"))
+    {
+        for (BpKv* m = models->GetFirstTrueSubKey(); m; m = m->GetNextTrueSubKey())
+        {
+            m->GetString("label", "");
+            m->GetString("path", "");
+        }
+    }
+
+    // Prefabs: every part of every placement must be an item the plugin
+    // spawns.
+    std::vector<BpPrefab> prefabs;
+    BpReadPrefabs(&kv, prefabs);
+    for (const BpPrefab& pf : prefabs)
+    {
+        FUZZ_CHECK(!pf.parts.empty() && pf.parts.size() <= (size_t)BP_PREFAB_MAX_PARTS);
+        for (float yaw : { 0.0f, 90.0f, -270.0f, 33.3f })
+        {
+            BpItem inst;
+            inst.prefab = pf.name;
+            inst.pos = BpVec(16384.0f, -16384.0f, yaw);
+            inst.ang = BpVec(0.0f, yaw, 0.0f);
+            std::vector<BpItem> parts;
+            BpExpandPrefab(pf, inst, 0, parts);
+            FUZZ_CHECK(parts.size() == pf.parts.size());
+            for (const BpItem& it : parts)
+            {
+                FUZZ_CHECK(BpItemUsable(it) && it.group == 0);
+            }
+        }
+    }
+
+    // LoadPhrases, for both shipped languages.
+    for (BpKv* p = kv.GetFirstTrueSubKey(); p; p = p->GetNextTrueSubKey())
+    {
+        CheckPhrase(p->GetString("ru", ""));
+        CheckPhrase(p->GetString("en", ""));
+    }
+    return 0;
+}
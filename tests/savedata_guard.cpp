@@ -0,0 +1,96 @@
+// SaveData merges the current map into bp_data.ini; this checks that a file
+// it cannot read whole (over the byte limit, nested too deep, or cut off
+// mid-token) is left byte for byte as it was, while a missing or valid one
+// is written with the other maps kept.
+//
+//   g++ -O2 -std=c++17 -pthread -I.. savedata_guard.cpp ../Core.cpp -o savedata_guard
+//   ./savedata_guard
+//
+// or configure with --enable-tools (or --tools-only, which needs no SDK or
+// Metamod:Source) and build the savedata_guard target.
+// Exits 1 if any case fails.
+
+#include <stdio.h>
+#include <string>
+#include "tools/MockBackend.h"
+#include "Core.h"
+
+static const char* DATA_PATH = "addons/data/bp_data.ini";
+
+static MockBackend g_Mock;
+
+static const char* g_Valid =
+    "\"BPData\"\n"
+    "{\n"
+    "\t\"de_other\"\n"
+    "\t{\n"
+    "\t\t\"budget\"\t\"100\"\n"
+    "\t}\n"
+    "}\n";
+
+static void Save()
+{
+    g_CurrentMap = "de_guard";
+    g_MapBudget = 50;
+    SaveData();
+}
+
+// An existing file SaveData must not touch.
+static int Untouched(const char* name, const std::string& data)
+{
+    g_Mock.files[DATA_PATH] = data;
+    Save();
+    auto it = g_Mock.files.find(DATA_PATH);
+    if (it == g_Mock.files.end() || it->second != data)
+    {
+        fprintf(stderr, "%s: file was rewritten\n", name);
+        return 1;
+    }
+    printf("%-10s kept (%zu bytes)\n", name, data.size());
+    return 0;
+}
+
+int main()
+{
+    g_Backend = &g_Mock;
+    g_LogLevel = -1;
+    int failed = 0;
+
+    g_Mock.files.erase(DATA_PATH);
+    Save();
+    BpKv fresh("BPData");
+    if (!KvLoadFile(&fresh, DATA_PATH) || !fresh.FindKey("de_guard"))
+    {
+        fprintf(stderr, "missing: file not written\n");
+        ++failed;
+    }
+
+    g_Mock.files[DATA_PATH] = g_Valid;
+    Save();
+    BpKv merged("BPData");
+    if (!KvLoadFile(&merged, DATA_PATH) || !merged.FindKey("de_other") || !merged.FindKey("de_guard"))
+    {
+        fprintf(stderr, "valid: other maps not kept\n");
+        ++failed;
+    }
+
+    // The start of a valid file, cut off inside a quoted key.
+    std::string cut = g_Valid;
+    cut.resize(cut.find("budget") + 3);
+    failed += Untouched("truncated", cut);
+
+    std::string deep = "\"BPData\"\n{\n";
+    for (int i = 0; i <= BpKvLimits().maxDepth; ++i)
+    {
+        deep += "\"k\" {\n";
+    }
+    failed += Untouched("too-deep", deep);
+
+    // Valid text padded past the byte cap with trailing whitespace.
+    std::string big = g_Valid;
+    big.resize(BpKvLimits().maxBytes + 1, '\n');
+    failed += Untouched("too-big", big);
+
+    g_Backend = nullptr;
+    return failed ? 1 : 0;
+}
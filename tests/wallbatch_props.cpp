@@ -0,0 +1,271 @@
+// Property check for WallBatch.h: every lane type built into this binary
+// against BpComputeWallGeom, on random walls and on the inputs that sit on
+// the kernel's branches (yaw near multiples of 90, negative and huge yaw,
+// inverted corners, zero-size boxes), plus each wide lane against the
+// scalar one bit for bit.
+//
+//   g++ -O2 -std=c++17 -I.. wallbatch_props.cpp -o wallbatch_props
+//   ./wallbatch_props [--count N] [--seed N]
+//
+// or configure with --enable-tools (or --tools-only, which needs no SDK or
+// Metamod:Source) and build the wallbatch_props target.
+// Exits 1 if any lane type disagrees, after printing the first few walls
+// each one got wrong.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "Layout.h"
+#include "WallBatch.h"
+
+struct Wall
+{
+    BpVec p1, p2;
+    float yaw;
+};
+
+static uint64_t g_Rng;
+
+static uint32_t Rand()
+{
+    g_Rng ^= g_Rng << 13;
+    g_Rng ^= g_Rng >> 7;
+    g_Rng ^= g_Rng << 17;
+    return (uint32_t)(g_Rng >> 16);
+}
+
+static float RandF(float lo, float hi)
+{
+    return lo + (hi - lo) * (float)(Rand() & 0xFFFFFF) / (float)0xFFFFFF;
+}
+
+static bool SameBits(float a, float b)
+{
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Yaws on and either side of each branch of the kernel: the quadrant
+// rounding at 45 + 90k, the one-degree collision fold around 90k, the
+// exact-zero shortcut, and the fmodf reduction for large and negative yaw.
+static void EdgeYaws(std::vector<float>& out)
+{
+    static const float offsets[] = { 0.0f, 1e-4f, 0.5f, 0.999f, 1.0f, 1.001f, 44.999f, 45.0f, 45.001f };
+    for (int k = -8; k <= 8; ++k)
+    {
+        float base = 90.0f * k;
+        for (float d : offsets)
+        {
+            out.push_back(base + d);
+            out.push_back(base - d);
+        }
+        out.push_back(nextafterf(base + 1.0f, base));
+        out.push_back(nextafterf(base + 1.0f, base + 2.0f));
+        out.push_back(nextafterf(base - 1.0f, base));
+        out.push_back(nextafterf(base - 1.0f, base - 2.0f));
+    }
+    static const float big[] = {
+        -0.0f, 1e-30f, -1e-30f, 1234.5f, -1079.75f, 3600.0f, -3600.0f, 3645.0f,
+        1e6f, -1e6f, 1e6f + 90.0f, 16777216.0f, -16777216.0f, 1e20f, -3e38f
+    };
+    out.insert(out.end(), big, big + sizeof(big) / sizeof(big[0]));
+}
+
+// Boxes with the corners in every order and with any axis flat.
+static void EdgeBoxes(std::vector<Wall>& out, const std::vector<float>& yaws)
+{
+    const BpVec lo(-128.0f, 64.0f, -32.0f), hi(256.0f, 96.0f, 160.0f);
+    for (int shape = 0; shape < 8 + 4; ++shape)
+    {
+        BpVec p1 = lo, p2 = hi;
+        if (shape < 8)
+        {
+            // Inverted: swap p1 and p2 on the axes in 'shape'.
+            for (int a = 0; a < 3; ++a)
+            {
+                if (shape & (1 << a))
+                {
+                    float t = p1[a];
+                    p1[a] = p2[a];
+                    p2[a] = t;
+                }
+            }
+        }
+        else if (shape < 11)
+        {
+            p2[shape - 8] = p1[shape - 8];      // flat on one axis
+        }
+        else
+        {
+            p2 = p1;                            // a point
+        }
+        for (float yaw : yaws)
+        {
+            out.push_back({ p1, p2, yaw });
+        }
+    }
+}
+
+static void RandomWalls(std::vector<Wall>& out, int n, const std::vector<float>& yaws)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        Wall w;
+        w.p1 = BpVec(RandF(-16000.0f, 16000.0f), RandF(-16000.0f, 16000.0f), RandF(-4000.0f, 4000.0f));
+        w.p2 = w.p1 + BpVec(RandF(-512.0f, 512.0f), RandF(-512.0f, 512.0f), RandF(-256.0f, 256.0f));
+        if (i % 11 == 0)
+        {
+            int a = Rand() % 3;
+            w.p2[a] = w.p1[a];
+        }
+        switch (i % 4)
+        {
+        case 0: w.yaw = RandF(-720.0f, 720.0f); break;
+        case 1: w.yaw = yaws[Rand() % yaws.size()]; break;
+        case 2: w.yaw = 90.0f * (int)(Rand() % 9 - 4) + RandF(-1.5f, 1.5f); break;
+        default: w.yaw = RandF(-1e7f, 1e7f); break;
+        }
+        out.push_back(w);
+    }
+}
+
+// The WallBatch.h contract: centre, half-extents and collision yaw exactly
+// as BpComputeWallGeom; corners and surrounding box to 1e-3 units. Far
+// out, BpComputeWallGeom's own yaw * pi / 180 loses more than that, so the
+// rotated fields are compared with it on the same turn taken modulo 360.
+template <class L>
+static int CheckLane(const char* lane, const std::vector<Wall>& walls, std::vector<float>* bits)
+{
+    BpWallBatch batch;
+    batch.Resize(walls.size());
+    for (size_t i = 0; i < walls.size(); ++i)
+    {
+        batch.Set(i, walls[i].p1, walls[i].p2, walls[i].yaw);
+    }
+    batch.ComputeWith<L>();
+
+    int bad = 0;
+    float worst = 0.0f;
+    auto close = [&](float got, float want) {
+        float err = fabsf(got - want);
+        worst = err > worst ? err : worst;
+        return err <= 1e-3f + 2e-7f * fabsf(want);
+    };
+    for (size_t i = 0; i < walls.size(); ++i)
+    {
+        const Wall& w = walls[i];
+        BpWallGeom want, turn, got;
+        BpComputeWallGeom(w.p1, w.p2, w.yaw, want);
+        BpComputeWallGeom(w.p1, w.p2, fabsf(w.yaw) > 1440.0f ? fmodf(w.yaw, 360.0f) : w.yaw, turn);
+        batch.Get(i, got);
+
+        const char* what = nullptr;
+        if (!SameBits(got.yaw, want.yaw) && !(got.yaw == 0.0f && want.yaw == 0.0f))
+        {
+            what = "collision yaw";
+        }
+        for (int a = 0; a < 3 && !what; ++a)
+        {
+            if (got.center[a] != want.center[a] || got.mins[a] != want.mins[a] || got.maxs[a] != want.maxs[a])
+            {
+                what = "collision box";
+            }
+            else if (!close(got.surround[a], turn.surround[a]))
+            {
+                what = "surrounding box";
+            }
+            for (int k = 0; k < 8 && !what; ++k)
+            {
+                bool exact = w.yaw == 0.0f;
+                if (exact ? got.corners[k][a] != want.corners[k][a] : !close(got.corners[k][a], turn.corners[k][a]))
+                {
+                    what = "corners";
+                }
+            }
+        }
+        if (what && bad++ < 8)
+        {
+            fprintf(stderr, "%s: wall %zu (%g %g %g .. %g %g %g, yaw %.9g): %s differ from BpComputeWallGeom\n",
+                lane, i, w.p1.x, w.p1.y, w.p1.z, w.p2.x, w.p2.y, w.p2.z, w.yaw, what);
+        }
+    }
+
+    // Raw outputs, so the lane types can be held to each other bit for bit.
+    int diverged = 0;
+    if (bits->empty())
+    {
+        for (int f = 0; f < BpWallBatch::OUT_COUNT; ++f)
+        {
+            for (size_t i = 0; i < walls.size(); ++i)
+            {
+                bits->push_back(batch.Out(f, i));
+            }
+        }
+    }
+    else
+    {
+        size_t j = 0;
+        for (int f = 0; f < BpWallBatch::OUT_COUNT; ++f)
+        {
+            for (size_t i = 0; i < walls.size(); ++i, ++j)
+            {
+                if (!SameBits(batch.Out(f, i), (*bits)[j]) && diverged++ < 8)
+                {
+                    fprintf(stderr, "%s: wall %zu (yaw %.9g) output %d is %.9g, the scalar lanes give %.9g\n",
+                        lane, i, walls[i].yaw, f, batch.Out(f, i), (*bits)[j]);
+                }
+            }
+        }
+    }
+
+    printf("%-8s %zu walls: %d differ from BpComputeWallGeom (worst rotated error %g), %d from scalar\n",
+        lane, walls.size(), bad, worst, diverged);
+    return bad + diverged;
+}
+
+int main(int argc, char** argv)
+{
+    int count = 200000;
+    uint64_t seed = 0xC0FFEEull;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        if (a == "--count" && i + 1 < argc)
+        {
+            count = atoi(argv[++i]);
+        }
+        else if (a == "--seed" && i + 1 < argc)
+        {
+            seed = strtoull(argv[++i], nullptr, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--count N] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    g_Rng = seed ? seed : 1;
+
+    std::vector<float> yaws;
+    EdgeYaws(yaws);
+    std::vector<Wall> walls;
+    EdgeBoxes(walls, yaws);
+    RandomWalls(walls, count, yaws);
+    // One more than a multiple of 8, so the wide kernels run over padding.
+    while (walls.size() % 8 != 1)
+    {
+        walls.push_back({ BpVec(1.0f, 2.0f, 3.0f), BpVec(-4.0f, 5.0f, -6.0f), 89.5f });
+    }
+
+    std::vector<float> bits;
+    int failed = CheckLane<BpLaneScalar>("scalar", walls, &bits);
+#if defined(BP_WALLBATCH_SSE2)
+    failed += CheckLane<BpLaneSSE2>("sse2", walls, &bits);
+#elif defined(BP_WALLBATCH_AVX2)
+    failed += CheckLane<BpLaneAVX2>("avx2", walls, &bits);
+#else
+    printf("no wide lanes in this build\n");
+#endif
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,592 @@
+#ifndef _INCLUDE_BLOCKERPASSES_LAYOUTLINT_H_
+#define _INCLUDE_BLOCKERPASSES_LAYOUTLINT_H_
+
+// Checks and rewrites for one map section of a bp_data file, used by
+// bp_lint. Everything here works on the BpItem list BpReadItem produces, so
+// what is flagged is what the plugin would load. Prefab instances are
+// checked as placed (origin, yaw, a prefab settings.ini defines) and kept
+// as they are; with the prefab list their parts count towards the entity
+// totals.
+//
+// The optimizer only makes changes the plugin cannot see a difference in
+// (or that it would make itself on load):
+//  - items LoadDataForMap drops (no model, NaN/infinity) are dropped;
+//  - wall corners are stored min/max and the wall yaw folded into [0, 90)
+//    by swapping the x and y extents (a box turned 90 degrees about its
+//    centre is the same box), angles into (-180, 180];
+//  - exact duplicates go;
+//  - walls with the same yaw, spawn conditions and beam colour that share
+//    a cross-section and touch or overlap along the third axis become one
+//    box, saving a collision entity and its outline;
+//  - polyline paths lose the points BpPolySimplify drops anyway.
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include "../Layout.h"
+#include "../Prefab.h"
+
+static const float LINT_WORLD_LIMIT = 16384.0f;    // CS2 maps fit in +-16384
+static const float LINT_ANGLE_LIMIT = 100000.0f;   // past this a float angle has no sub-degree precision
+static const float LINT_EPS = 0.01f;               // units; faces closer than this touch
+
+enum BpLintLevel
+{
+    LINT_NOTE = 0,
+    LINT_WARN,
+    LINT_ERROR,
+    LINT_LEVEL_COUNT
+};
+
+static const char* const BP_LINT_LEVEL_NAMES[LINT_LEVEL_COUNT] = { "note", "warning", "error" };
+
+enum BpLintCode
+{
+    LC_NON_FINITE = 0,
+    LC_OUT_OF_BOUNDS,
+    LC_ANGLE_RANGE,
+    LC_ANGLE_DENORMAL,
+    LC_NO_MODEL,
+    LC_UNKNOWN_MODEL,
+    LC_SCALE,
+    LC_WALL_DEGENERATE,
+    LC_WALL_FLAT,
+    LC_WALL_INVERTED,
+    LC_DUPLICATE,
+    LC_OVERLAP,
+    LC_MAP_NAME,
+    LC_POLY_REDUNDANT,
+    LC_PREFAB_UNKNOWN,
+    LC_COUNT
+};
+
+static const char* const BP_LINT_CODE_NAMES[LC_COUNT] = {
+    "non-finite", "out-of-bounds", "angle-range", "angle-denormal", "no-model", "unknown-model", "scale",
+    "wall-degenerate", "wall-flat", "wall-inverted", "duplicate", "overlap", "map-name", "poly-redundant",
+    "prefab-unknown"
+};
+
+static const BpLintLevel BP_LINT_CODE_LEVELS[LC_COUNT] = {
+    LINT_ERROR, LINT_ERROR, LINT_ERROR, LINT_NOTE, LINT_ERROR, LINT_WARN, LINT_WARN,
+    LINT_ERROR, LINT_WARN, LINT_NOTE, LINT_ERROR, LINT_WARN, LINT_WARN, LINT_NOTE,
+    LINT_WARN
+};
+
+struct BpLintIssue
+{
+    BpLintCode code;
+    int item;       // 1-based position in the section, 0 for the section itself
+    std::string text;
+};
+
+struct BpLintReport
+{
+    std::string map;
+    std::vector<BpLintIssue> issues;
+    int counts[LINT_LEVEL_COUNT] = {};
+    int items = 0;
+    int dropped = 0;
+    int duplicates = 0;
+    int merged = 0;
+    int canonicalized = 0;
+    int entitiesBefore = 0;
+    int entitiesAfter = 0;
+    std::vector<BpItem> optimized;
+};
+
+// Wall box in the frame it is turned in: centre, half-extents along the
+// turned x/y and world z, and the yaw.
+struct BpLintBox
+{
+    BpVec c;
+    BpVec h;
+    float yaw = 0.0f;
+};
+
+inline void BpLintAdd(BpLintReport& r, BpLintCode code, int item, const char* fmt, ...)
+{
+    char buf[512];
+    va_list va;
+    va_start(va, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, va);
+    va_end(va);
+    r.issues.push_back({ code, item, buf });
+    ++r.counts[BP_LINT_CODE_LEVELS[code]];
+}
+
+// Angle into (-180, 180]; fmod is exact, so this is the angle the value
+// already meant.
+inline float BpCanonicalAngle(float a)
+{
+    float r = fmodf(a, 360.0f);
+    if (r > 180.0f)
+    {
+        r -= 360.0f;
+    }
+    else if (r <= -180.0f)
+    {
+        r += 360.0f;
+    }
+    return r == 0.0f ? 0.0f : r;   // no "-0.000000" in the file
+}
+
+inline BpLintBox BpLintWallBox(const BpItem& it)
+{
+    BpLintBox b;
+    for (int a = 0; a < 3; ++a)
+    {
+        b.c[a] = (it.pos[a] + it.pos2[a]) * 0.5f;
+        b.h[a] = fabsf(it.pos2[a] - it.pos[a]) * 0.5f;
+    }
+    float y = fmodf(it.wallYaw, 180.0f);
+    if (y < 0.0f)
+    {
+        y += 180.0f;
+    }
+    if (y >= 90.0f)
+    {
+        y -= 90.0f;
+        std::swap(b.h.x, b.h.y);
+    }
+    if (y > 90.0f - 1e-4f)
+    {
+        y = 0.0f;
+        std::swap(b.h.x, b.h.y);
+    }
+    b.yaw = y < 1e-4f ? 0.0f : y;
+    return b;
+}
+
+inline void BpLintSetWallBox(BpItem& it, const BpLintBox& b)
+{
+    for (int a = 0; a < 3; ++a)
+    {
+        it.pos[a] = (b.c[a] - b.h[a]) + 0.0f;   // + 0 turns -0 into 0
+        it.pos2[a] = (b.c[a] + b.h[a]) + 0.0f;
+    }
+    it.wallYaw = b.yaw;
+}
+
+// Corners of the collision box the plugin builds for a wall, and the test
+// whether a point lies in another one.
+inline void BpLintCorners(const BpWallGeom& g, BpVec out[8])
+{
+    float rad = g.yaw * BP_PI / 180.0f;
+    float cosA = cosf(rad), sinA = sinf(rad);
+    for (int i = 0; i < 8; ++i)
+    {
+        float x = (i & 1) ? g.maxs.x : g.mins.x;
+        float y = (i & 2) ? g.maxs.y : g.mins.y;
+        float z = (i & 4) ? g.maxs.z : g.mins.z;
+        out[i] = BpVec(g.center.x + x * cosA - y * sinA, g.center.y + x * sinA + y * cosA, g.center.z + z);
+    }
+}
+
+inline bool BpLintInside(const BpWallGeom& g, const BpVec& p)
+{
+    float rad = g.yaw * BP_PI / 180.0f;
+    float cosA = cosf(rad), sinA = sinf(rad);
+    BpVec d = p - g.center;
+    float x = d.x * cosA + d.y * sinA;
+    float y = -d.x * sinA + d.y * cosA;
+    return fabsf(x) <= g.maxs.x + LINT_EPS && fabsf(y) <= g.maxs.y + LINT_EPS && fabsf(d.z) <= g.maxs.z + LINT_EPS;
+}
+
+inline bool BpLintSameSpawn(const BpItem& a, const BpItem& b)
+{
+    return a.isWall == b.isWall && a.minPlayers == b.minPlayers && a.layers == b.layers && a.invisible == b.invisible;
+}
+
+// Merges 'b' into 'a' when their union is a box; see the top of the file.
+inline bool BpLintTryMerge(BpLintBox& a, const BpLintBox& b)
+{
+    if (fabsf(a.yaw - b.yaw) > 1e-3f)
+    {
+        return false;
+    }
+    float rad = a.yaw * BP_PI / 180.0f;
+    float cosA = cosf(rad), sinA = sinf(rad);
+    float ca[3] = { a.c.x * cosA + a.c.y * sinA, -a.c.x * sinA + a.c.y * cosA, a.c.z };
+    float cb[3] = { b.c.x * cosA + b.c.y * sinA, -b.c.x * sinA + b.c.y * cosA, b.c.z };
+    int along = -1;
+    for (int k = 0; k < 3; ++k)
+    {
+        bool same = fabsf(ca[k] - cb[k]) <= LINT_EPS && fabsf(a.h[k] - b.h[k]) <= LINT_EPS;
+        if (same)
+        {
+            continue;
+        }
+        if (along >= 0)
+        {
+            return false;
+        }
+        along = k;
+    }
+    if (along < 0)
+    {
+        return true;   // same box
+    }
+    float lo = fminf(ca[along] - a.h[along], cb[along] - b.h[along]);
+    float hi = fmaxf(ca[along] + a.h[along], cb[along] + b.h[along]);
+    if (hi - lo > 2.0f * (a.h[along] + b.h[along]) + LINT_EPS)
+    {
+        return false;   // a gap between them
+    }
+    ca[along] = (lo + hi) * 0.5f;
+    a.h[along] = (hi - lo) * 0.5f;
+    a.c = BpVec(ca[0] * cosA - ca[1] * sinA, ca[0] * sinA + ca[1] * cosA, ca[2]);
+    return true;
+}
+
+// Entities the plugin creates for the whole list with no budget; instances
+// count as their parts when 'prefabs' knows them.
+inline int BpLintEntities(const std::vector<BpItem>& list, const std::vector<BpPrefab>* prefabs)
+{
+    std::vector<BpItem> items;
+    for (const BpItem& it : list)
+    {
+        const BpPrefab* pf = prefabs && !it.prefab.empty() ? BpFindPrefab(*prefabs, it.prefab) : nullptr;
+        if (pf)
+        {
+            BpExpandPrefab(*pf, it, -1, items);
+        }
+        else if (it.prefab.empty())
+        {
+            items.push_back(it);
+        }
+    }
+    std::vector<int> spawn(items.size());
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        spawn[i] = (int)i;
+    }
+    std::vector<BpWallGeom> geom(items.size());
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        if (items[i].isWall)
+        {
+            BpComputeItemGeom(items[i], geom[i]);
+        }
+    }
+    std::vector<uint8_t> beams;
+    return BpAllocateBudget(items, spawn, geom, beams, 0).cost;
+}
+
+inline void BpLintVec(BpLintReport& r, int n, const char* what, const BpVec& v)
+{
+    if (!BpVecFinite(v))
+    {
+        BpLintAdd(r, LC_NON_FINITE, n, "%s (%g %g %g) is not finite; the plugin skips this item", what, v.x, v.y, v.z);
+    }
+    else if (fabsf(v.x) > LINT_WORLD_LIMIT || fabsf(v.y) > LINT_WORLD_LIMIT || fabsf(v.z) > LINT_WORLD_LIMIT)
+    {
+        BpLintAdd(r, LC_OUT_OF_BOUNDS, n, "%s (%g %g %g) is outside the map (+-%.0f)", what, v.x, v.y, v.z, LINT_WORLD_LIMIT);
+    }
+}
+
+// Per-item checks on what BpReadItem produced.
+inline void BpLintPolyline(BpLintReport& r, int n, const BpItem& it)
+{
+    bool finite = true;
+    for (size_t k = 0; k < it.points.size(); ++k)
+    {
+        char what[32];
+        snprintf(what, sizeof(what), "point %zu", k + 1);
+        BpLintVec(r, n, what, it.points[k]);
+        finite &= BpVecFinite(it.points[k]);
+    }
+    if (!std::isfinite(it.polyHeight) || !std::isfinite(it.polyThick))
+    {
+        BpLintAdd(r, LC_NON_FINITE, n, "polyline height %g, thickness %g", it.polyHeight, it.polyThick);
+        return;
+    }
+    if (!finite)
+    {
+        return;
+    }
+    if (it.polyHeight < 2.0f || it.polyThick < 2.0f)
+    {
+        BpLintAdd(r, LC_WALL_FLAT, n, "polyline height %g, thickness %g; it spawns at least 2 units of each", it.polyHeight,
+            it.polyThick);
+    }
+    std::vector<BpVec> path;
+    BpPolySimplify(it.points, path);
+    if (path.size() < 2)
+    {
+        BpLintAdd(r, LC_WALL_DEGENERATE, n, "polyline has no length; it spawns as a %.0f-unit post", fmaxf(it.polyThick, 2.0f));
+    }
+    else if (path.size() < it.points.size())
+    {
+        BpLintAdd(r, LC_POLY_REDUNDANT, n, "%zu of %zu points are repeated or on a straight run", it.points.size() - path.size(),
+            it.points.size());
+    }
+}
+
+inline void BpLintInstance(BpLintReport& r, int n, const BpItem& it, const std::vector<BpPrefab>* prefabs)
+{
+    BpLintVec(r, n, "origin", it.pos);
+    if (!std::isfinite(it.ang.y))
+    {
+        BpLintAdd(r, LC_NON_FINITE, n, "prefab yaw %g; the plugin skips this instance", it.ang.y);
+    }
+    else if (fabsf(it.ang.y) > LINT_ANGLE_LIMIT)
+    {
+        BpLintAdd(r, LC_ANGLE_RANGE, n, "prefab yaw %g is not a usable angle", it.ang.y);
+    }
+    if (prefabs && !BpFindPrefab(*prefabs, it.prefab))
+    {
+        BpLintAdd(r, LC_PREFAB_UNKNOWN, n, "prefab %s is not in settings.ini; the plugin keeps the instance but spawns nothing",
+            it.prefab.c_str());
+    }
+}
+
+inline void BpLintItem(BpLintReport& r, int n, const BpItem& it, const std::unordered_set<std::string>* models,
+    const std::vector<BpPrefab>* prefabs)
+{
+    if (!it.prefab.empty())
+    {
+        BpLintInstance(r, n, it, prefabs);
+        return;
+    }
+    if (!it.points.empty())
+    {
+        BpLintPolyline(r, n, it);
+    }
+    else
+    {
+        BpLintVec(r, n, it.isWall ? "corner 1" : "position", it.pos);
+    }
+    for (int a = 0; a < 3; ++a)
+    {
+        float v = it.ang[a];
+        if (!std::isfinite(v) || fabsf(v) > LINT_ANGLE_LIMIT)
+        {
+            BpLintAdd(r, std::isfinite(v) ? LC_ANGLE_RANGE : LC_NON_FINITE, n, "angle a%c = %g is not a usable angle", "xyz"[a], v);
+        }
+        else if (v > 180.0f || v <= -180.0f)
+        {
+            BpLintAdd(r, LC_ANGLE_DENORMAL, n, "angle a%c = %g is %g", "xyz"[a], v, BpCanonicalAngle(v));
+        }
+    }
+    if (!it.isWall)
+    {
+        if (it.path.empty())
+        {
+            BpLintAdd(r, LC_NO_MODEL, n, "prop without a model; the plugin skips it");
+        }
+        else if (models && !models->count(it.path))
+        {
+            BpLintAdd(r, LC_UNKNOWN_MODEL, n, "model %s is not in settings.ini", it.path.c_str());
+        }
+        if (!std::isfinite(it.scale))
+        {
+            BpLintAdd(r, LC_NON_FINITE, n, "scale %g", it.scale);
+        }
+        else if (it.scale < 0.05f || it.scale > 20.0f)
+        {
+            BpLintAdd(r, LC_SCALE, n, "scale %g is clamped to %g", it.scale, fminf(fmaxf(it.scale, 0.05f), 20.0f));
+        }
+        return;
+    }
+
+    if (!it.points.empty())
+    {
+        return;     // corners and yaw come from the path
+    }
+    BpLintVec(r, n, "corner 2", it.pos2);
+    if (!std::isfinite(it.wallYaw))
+    {
+        BpLintAdd(r, LC_NON_FINITE, n, "wall yaw %g", it.wallYaw);
+    }
+    if (!BpVecFinite(it.pos) || !BpVecFinite(it.pos2))
+    {
+        return;
+    }
+    int flat = 0;
+    std::string inverted;
+    for (int a = 0; a < 3; ++a)
+    {
+        flat += fabsf(it.pos2[a] - it.pos[a]) < LINT_EPS ? 1 : 0;
+        if (it.pos[a] > it.pos2[a])
+        {
+            inverted += "xyz"[a];
+        }
+    }
+    if (flat >= 2)
+    {
+        BpLintAdd(r, LC_WALL_DEGENERATE, n, "wall has no area (%d flat axes); it spawns as a 2-unit %s", flat, flat == 3 ? "cube" : "post");
+    }
+    else if (flat == 1)
+    {
+        BpLintAdd(r, LC_WALL_FLAT, n, "wall has zero thickness; it spawns 2 units thick");
+    }
+    if (!inverted.empty())
+    {
+        BpLintAdd(r, LC_WALL_INVERTED, n, "corners inverted on %s", inverted.c_str());
+    }
+}
+
+// Checks 'items' (in file order) and fills r.optimized. 'models' and
+// 'prefabs' are the settings.ini lists, or null to skip those checks.
+inline void BpLintMap(BpLintReport& r, const std::vector<BpItem>& items, const std::unordered_set<std::string>* models,
+    const std::vector<BpPrefab>* prefabs = nullptr)
+{
+    r.items = (int)items.size();
+    std::string norm = BpNormalizeMapName(r.map.c_str());
+    if (norm != r.map)
+    {
+        BpLintAdd(r, LC_MAP_NAME, 0, "section name is looked up as \"%s\" and never matches", norm.c_str());
+    }
+
+    std::vector<int> usable;
+    std::vector<BpItem> loaded;
+    for (int i = 0; i < (int)items.size(); ++i)
+    {
+        BpLintItem(r, i + 1, items[i], models, prefabs);
+        if (BpItemUsable(items[i]) || BpInstanceUsable(items[i]))
+        {
+            usable.push_back(i);
+            loaded.push_back(items[i]);
+        }
+    }
+    r.dropped = r.items - (int)usable.size();
+    r.entitiesBefore = BpLintEntities(loaded, prefabs);
+
+    // Pairs, over what the plugin loads.
+    std::vector<BpWallGeom> geom(loaded.size());
+    for (size_t i = 0; i < loaded.size(); ++i)
+    {
+        if (loaded[i].isWall)
+        {
+            BpComputeItemGeom(loaded[i], geom[i]);
+        }
+    }
+    for (size_t j = 0; j < loaded.size(); ++j)
+    {
+        const BpItem& b = loaded[j];
+        for (size_t i = 0; i < j; ++i)
+        {
+            const BpItem& a = loaded[i];
+            if (BpItemSame(a, b))
+            {
+                BpLintAdd(r, LC_DUPLICATE, usable[j] + 1, "duplicate of item %d", usable[i] + 1);
+                break;
+            }
+            if (!BpLintSameSpawn(a, b))
+            {
+                continue;
+            }
+            if (a.isWall && a.points.empty())     // a polyline's bounding box is not solid
+            {
+                BpVec ca[8];
+                BpLintCorners(geom[j], ca);
+                bool inside = true;
+                for (int k = 0; k < 8 && inside; ++k)
+                {
+                    inside = BpLintInside(geom[i], ca[k]);
+                }
+                if (inside)
+                {
+                    BpLintAdd(r, LC_OVERLAP, usable[j] + 1, "wall lies inside item %d", usable[i] + 1);
+                    break;
+                }
+            }
+            else if (a.path == b.path && a.prefab == b.prefab && fabsf(a.pos.x - b.pos.x) < LINT_EPS && fabsf(a.pos.y - b.pos.y) < LINT_EPS &&
+                fabsf(a.pos.z - b.pos.z) < LINT_EPS && fabsf(a.ang.x - b.ang.x) < LINT_EPS &&
+                fabsf(a.ang.y - b.ang.y) < LINT_EPS && fabsf(a.ang.z - b.ang.z) < LINT_EPS && a.scale == b.scale)
+            {
+                BpLintAdd(r, LC_OVERLAP, usable[j] + 1, "same model in the same place as item %d", usable[i] + 1);
+                break;
+            }
+        }
+    }
+
+    std::stable_sort(r.issues.begin(), r.issues.end(), [](const BpLintIssue& a, const BpLintIssue& b) { return a.item < b.item; });
+
+    // Optimize: canonical form first, so duplicates that differ only in
+    // how they were written are caught too.
+    std::vector<BpItem>& out = r.optimized;
+    for (BpItem it : loaded)
+    {
+        bool changed = false;
+        for (int a = 0; a < 3; ++a)
+        {
+            float v = BpCanonicalAngle(it.ang[a]);
+            changed |= v != it.ang[a];
+            it.ang[a] = v;
+        }
+        if (!it.points.empty())
+        {
+            std::vector<BpVec> path;
+            BpPolySimplify(it.points, path);
+            if (path.size() >= 2 && path.size() < it.points.size())
+            {
+                it.points.swap(path);
+                BpPolyRefit(it);
+                changed = true;
+            }
+        }
+        else if (it.isWall)
+        {
+            BpLintBox b = BpLintWallBox(it);
+            bool inverted = it.pos.x > it.pos2.x || it.pos.y > it.pos2.y || it.pos.z > it.pos2.z;
+            if (inverted || b.yaw != it.wallYaw)
+            {
+                BpLintSetWallBox(it, b);
+                changed = true;
+            }
+        }
+        r.canonicalized += changed ? 1 : 0;
+
+        bool dup = false;
+        for (const BpItem& o : out)
+        {
+            if (BpItemSame(o, it))
+            {
+                dup = true;
+                break;
+            }
+        }
+        if (dup)
+        {
+            ++r.duplicates;
+            continue;
+        }
+        out.push_back(std::move(it));
+    }
+
+    for (bool again = true; again;)
+    {
+        again = false;
+        for (size_t i = 0; i < out.size(); ++i)
+        {
+            if (!out[i].isWall || !out[i].points.empty())
+            {
+                continue;
+            }
+            BpLintBox bi = BpLintWallBox(out[i]);
+            for (size_t j = i + 1; j < out.size(); ++j)
+            {
+                const BpItem& b = out[j];
+                if (!b.isWall || !b.points.empty() || !BpLintSameSpawn(out[i], b) || out[i].beamR != b.beamR || out[i].beamG != b.beamG ||
+                    out[i].beamB != b.beamB || out[i].beamRainbow != b.beamRainbow)
+                {
+                    continue;
+                }
+                if (BpLintTryMerge(bi, BpLintWallBox(b)))
+                {
+                    BpLintSetWallBox(out[i], bi);
+                    out.erase(out.begin() + j);
+                    ++r.merged;
+                    again = true;
+                    --j;
+                }
+            }
+        }
+    }
+    r.entitiesAfter = BpLintEntities(out, prefabs);
+}
+
+#endif //_INCLUDE_BLOCKERPASSES_LAYOUTLINT_H_
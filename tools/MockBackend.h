@@ -0,0 +1,555 @@
+#ifndef _INCLUDE_BLOCKERPASSES_MOCKBACKEND_H_
+#define _INCLUDE_BLOCKERPASSES_MOCKBACKEND_H_
+
+// In-memory IBpBackend for the offline tools. Entities are plain records,
+// time is a virtual clock advanced by RunFrame(), and every call is counted
+// (and optionally logged) so two runs can be compared. Menus shown to a slot
+// are kept so a tool can pick an item from them (Select), and the game
+// filesystem is the 'files' map.
+//
+// Removed entities are kept as dead records rather than freed, so a stale
+// BpEnt never aliases a newer entity -- the same guarantee CHandle gives the
+// plugin. Long runs therefore grow by one small record per entity created.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <map>
+#include "../Backend.h"
+
+class MockBackend final : public IBpBackend
+{
+public:
+    enum Op
+    {
+        OP_CREATE = 0,
+        OP_SPAWN,
+        OP_TELEPORT,
+        OP_SET_MODEL,
+        OP_REMOVE,
+        OP_STATE_CHANGED,
+        OP_NEXT_FRAME,
+        OP_TIMER,
+        OP_RAY_TRACE,
+        OP_PLAYER_QUERY,
+        OP_SET_FIELD,
+        OP_SET_BOUNDS,
+        OP_MENU,
+        OP_CHAT,
+        OP_COUNT
+    };
+
+    struct Ent
+    {
+        uint32_t id = 0;
+        std::string cls;
+        std::string targetname;
+        std::string model;
+        bool spawned = false;
+        bool alive = true;
+        BpVec pos;
+        BpVec ang;
+        std::map<int, BpFieldValue> fields;     // unset reads as the default (white, opaque)
+    };
+
+    struct Call
+    {
+        double time;
+        Op op;
+        uint32_t ent;
+        std::string detail;
+    };
+
+    struct Player
+    {
+        bool connected = false;
+        bool inGame = false;
+        bool fake = false;
+        int team = 0;
+        bool alive = true;
+        bool admin = false;                     // passes every permission and flag check
+        uint64_t steamID = 0;
+        BpVec eye;
+        BpVec aim;
+    };
+
+    static const char* OpName(int op)
+    {
+        static const char* names[OP_COUNT] = {
+            "create", "spawn", "teleport", "set_model", "remove", "state_changed",
+            "next_frame", "timer", "ray_trace", "player_query", "set_field", "set_bounds",
+            "menu", "chat"
+        };
+        return op >= 0 && op < OP_COUNT ? names[op] : "?";
+    }
+
+    uint64_t counts[OP_COUNT] = {};
+    std::map<std::string, uint64_t> stateByField;   // "class::field" -> notifications
+    std::vector<Call> log;
+    bool logCalls = false;
+    uint64_t errors = 0;                            // calls on dead or unknown entities
+    int live = 0;
+    int peakLive = 0;
+    Player players[64];
+    double tickInterval = 1.0 / 64.0;
+    std::string mapName;
+    bool collisionBounds = true;                    // SetCollisionBounds resolved
+    std::map<std::string, std::string> files;
+    std::vector<std::string> chat;                  // filled while keepChat is set
+    bool keepChat = false;
+    std::function<void()> onFrameEnd;               // after the frame's timers, like GameFrame post
+
+    ~MockBackend()
+    {
+        for (Ent* e : m_Ents)
+        {
+            delete e;
+        }
+    }
+
+    BpEnt CreateEntity(const char* cls) override
+    {
+        Ent* e = new Ent();
+        e->id = (uint32_t)m_Ents.size() + 1;
+        e->cls = cls;
+        m_Ents.push_back(e);
+        ++live;
+        if (live > peakLive)
+        {
+            peakLive = live;
+        }
+        Record(OP_CREATE, e, cls);
+        return e;
+    }
+
+    void Spawn(BpEnt ent, const BpSpawnKV* kv) override
+    {
+        Ent* e = Check(ent);
+        Record(OP_SPAWN, e, nullptr);
+        if (!e)
+        {
+            return;
+        }
+        e->spawned = true;
+        for (size_t i = 0; kv && i < kv->entries.size(); ++i)
+        {
+            const BpSpawnKV::Entry& kve = kv->entries[i];
+            if (kve.kind == BpSpawnKV::KV_STRING && kve.key == "targetname")
+            {
+                e->targetname = kve.s;
+            }
+            else if (kve.kind == BpSpawnKV::KV_STRING && kve.key == "model")
+            {
+                e->model = kve.s;
+            }
+        }
+    }
+
+    void Teleport(BpEnt ent, const BpVec* pos, const BpVec* ang) override
+    {
+        Ent* e = Check(ent);
+        Record(OP_TELEPORT, e, nullptr);
+        if (e && pos)
+        {
+            e->pos = *pos;
+        }
+        if (e && ang)
+        {
+            e->ang = *ang;
+        }
+    }
+
+    void SetModel(BpEnt ent, const char* model) override
+    {
+        Ent* e = Check(ent);
+        Record(OP_SET_MODEL, e, model);
+        if (e)
+        {
+            e->model = model;
+        }
+    }
+
+    void Remove(BpEnt ent) override
+    {
+        Ent* e = Check(ent);
+        Record(OP_REMOVE, e, nullptr);
+        if (e)
+        {
+            e->alive = false;
+            e->targetname.clear();
+            e->model.clear();
+            --live;
+        }
+    }
+
+    bool Alive(BpEnt ent) override
+    {
+        const Ent* e = (const Ent*)ent;
+        return e && e->alive;
+    }
+
+    void StateChanged(BpEnt ent, const char* cls, const char* field) override
+    {
+        Ent* e = Check(ent);
+        std::string key = std::string(cls) + "::" + field;
+        Record(OP_STATE_CHANGED, e, key.c_str());
+        ++stateByField[key];
+    }
+
+    // Every entity the plugin makes is a model entity; the scene node only
+    // exists once it has spawned.
+    bool SetField(BpEnt ent, NetToken field, const BpFieldValue& value) override
+    {
+        Ent* e = Check(ent);
+        Record(OP_SET_FIELD, e, nullptr);
+        if (!e || (field == NF_BODY_COMPONENT && !e->spawned))
+        {
+            return false;
+        }
+        e->fields[field] = value;
+        return true;
+    }
+
+    bool GetField(BpEnt ent, NetToken field, BpFieldValue& out) override
+    {
+        Ent* e = Check(ent);
+        if (!e)
+        {
+            return false;
+        }
+        auto it = e->fields.find(field);
+        out = it != e->fields.end() ? it->second : BpFieldValue();
+        return true;
+    }
+
+    bool HasCollisionBounds() override
+    {
+        return collisionBounds;
+    }
+
+    void SetCollisionBounds(BpEnt ent, const BpVec& mins, const BpVec& maxs) override
+    {
+        Ent* e = Check(ent);
+        Record(OP_SET_BOUNDS, e, nullptr);
+        if (e)
+        {
+            e->fields[NF_MINS] = BpFieldValue(mins);
+            e->fields[NF_MAXS] = BpFieldValue(maxs);
+        }
+    }
+
+    void FindByName(const char* prefix, const std::function<void(BpEnt ent, const char* name)>& fn) override
+    {
+        size_t n = strlen(prefix);
+        for (Ent* e : m_Ents)
+        {
+            if (e->alive && !e->targetname.compare(0, n, prefix))
+            {
+                fn(e, e->targetname.c_str());
+            }
+        }
+    }
+
+    void NextFrame(std::function<void()> fn) override
+    {
+        Record(OP_NEXT_FRAME, nullptr, nullptr);
+        m_NextFrame.push_back(std::move(fn));
+    }
+
+    void CreateTimer(float delay, std::function<float()> fn) override
+    {
+        Record(OP_TIMER, nullptr, nullptr);
+        Timer t;
+        t.next = m_Now + (delay > tickInterval ? delay : tickInterval);
+        t.fn = std::move(fn);
+        m_Timers.push_back(std::move(t));
+    }
+
+    double Time() override
+    {
+        return m_Now;
+    }
+
+    bool RayTrace(int slot, BpVec& eye, BpVec& hit) override
+    {
+        Record(OP_RAY_TRACE, nullptr, nullptr);
+        if (slot < 0 || slot >= 64 || !players[slot].inGame)
+        {
+            return false;
+        }
+        eye = players[slot].eye;
+        hit = players[slot].aim;
+        return true;
+    }
+
+    bool IsConnected(int slot) override
+    {
+        ++counts[OP_PLAYER_QUERY];
+        return slot >= 0 && slot < 64 && players[slot].connected;
+    }
+
+    bool IsInGame(int slot) override
+    {
+        ++counts[OP_PLAYER_QUERY];
+        return slot >= 0 && slot < 64 && players[slot].inGame;
+    }
+
+    bool IsFakeClient(int slot) override
+    {
+        ++counts[OP_PLAYER_QUERY];
+        return slot >= 0 && slot < 64 && players[slot].fake;
+    }
+
+    int Team(int slot) override
+    {
+        ++counts[OP_PLAYER_QUERY];
+        return slot >= 0 && slot < 64 ? players[slot].team : 0;
+    }
+
+    uint64_t SteamID(int slot) override
+    {
+        ++counts[OP_PLAYER_QUERY];
+        return slot >= 0 && slot < 64 ? players[slot].steamID : 0;
+    }
+
+    bool HasPermission(int slot, const char*) override
+    {
+        ++counts[OP_PLAYER_QUERY];
+        return slot >= 0 && slot < 64 && players[slot].admin;
+    }
+
+    bool HasFlag(int slot, const char*) override
+    {
+        ++counts[OP_PLAYER_QUERY];
+        return slot >= 0 && slot < 64 && players[slot].admin;
+    }
+
+    bool TeleportPlayer(int slot, const BpVec& pos, const BpVec&) override
+    {
+        Record(OP_TELEPORT, nullptr, nullptr);
+        if (slot < 0 || slot >= 64 || !players[slot].inGame || !players[slot].alive)
+        {
+            return false;
+        }
+        players[slot].eye = pos;
+        return true;
+    }
+
+    void PrintToChat(int slot, const char* msg) override
+    {
+        Record(OP_CHAT, nullptr, nullptr);
+        if (keepChat)
+        {
+            chat.push_back(std::to_string(slot) + ": " + msg);
+        }
+    }
+
+    void PrintToChatAll(const char* msg) override
+    {
+        Record(OP_CHAT, nullptr, nullptr);
+        if (keepChat)
+        {
+            chat.push_back(std::string("all: ") + msg);
+        }
+    }
+
+    void ShowMenu(int slot, const BpMenu& menu) override
+    {
+        Record(OP_MENU, nullptr, menu.name.c_str());
+        if (slot >= 0 && slot < 64)
+        {
+            m_Menus[slot] = menu;
+        }
+    }
+
+    void CloseMenu(int slot) override
+    {
+        Record(OP_MENU, nullptr, nullptr);
+        m_Menus.erase(slot);
+    }
+
+    const char* MapName() override
+    {
+        return mapName.c_str();
+    }
+
+    int TickCount() override
+    {
+        return (int)(m_Now / tickInterval + 0.5);
+    }
+
+    const char* Language() override
+    {
+        return "en";
+    }
+
+    size_t FileSize(const char* path) override
+    {
+        auto it = files.find(path);
+        return it != files.end() ? it->second.size() : 0;
+    }
+
+    bool ReadFile(const char* path, std::string& out) override
+    {
+        auto it = files.find(path);
+        if (it == files.end())
+        {
+            return false;
+        }
+        out = it->second;
+        return true;
+    }
+
+    bool WriteFile(const char* path, const std::string& data) override
+    {
+        files[path] = data;
+        return true;
+    }
+
+    void RemoveFile(const char* path) override
+    {
+        files.erase(path);
+    }
+
+    // The menu the slot has open, or null.
+    const BpMenu* OpenMenu(int slot) const
+    {
+        auto it = m_Menus.find(slot);
+        return it != m_Menus.end() ? &it->second : nullptr;
+    }
+
+    // Picks the item with 'key' from the slot's open menu, as the player
+    // pressing its number would. False if no menu is open, the key is not
+    // on it or the item is disabled.
+    bool Select(int slot, const char* key)
+    {
+        const BpMenu* open = OpenMenu(slot);
+        if (!open)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < open->items.size(); ++i)
+        {
+            if (open->items[i].key == key)
+            {
+                if (!open->items[i].enabled || !open->callback)
+                {
+                    return false;
+                }
+                // The callback usually shows the next menu over this one.
+                BpMenu menu = *open;
+                menu.callback(menu.items[i].key.c_str(), menu.items[i].text.c_str(), (int)i, slot);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // One server frame: next-frame callbacks queued before it, then due timers.
+    void RunFrame()
+    {
+        m_Now += tickInterval;
+        std::vector<std::function<void()>> frame;
+        frame.swap(m_NextFrame);
+        for (auto& fn : frame)
+        {
+            fn();
+        }
+        for (size_t i = 0; i < m_Timers.size();)
+        {
+            if (m_Timers[i].next > m_Now + 1e-9)
+            {
+                ++i;
+                continue;
+            }
+            // The callback may add timers; keep it out of the vector while it runs.
+            std::function<float()> fn = std::move(m_Timers[i].fn);
+            float again = fn();
+            if (again < 0.0f)
+            {
+                m_Timers.erase(m_Timers.begin() + i);
+                continue;
+            }
+            m_Timers[i].fn = std::move(fn);
+            m_Timers[i].next = m_Now + (again > tickInterval ? again : tickInterval);
+            ++i;
+        }
+        if (onFrameEnd)
+        {
+            onFrameEnd();
+        }
+    }
+
+    void RunFor(double seconds)
+    {
+        double until = m_Now + seconds;
+        while (m_Now + tickInterval <= until + 1e-9)
+        {
+            RunFrame();
+        }
+    }
+
+    const Ent* Get(BpEnt ent) const
+    {
+        return (const Ent*)ent;
+    }
+
+    const std::vector<Ent*>& Entities() const
+    {
+        return m_Ents;
+    }
+
+    size_t PendingTimers() const
+    {
+        return m_Timers.size();
+    }
+
+    void ResetCounts()
+    {
+        for (uint64_t& c : counts)
+        {
+            c = 0;
+        }
+        stateByField.clear();
+        log.clear();
+        errors = 0;
+        peakLive = live;
+    }
+
+private:
+    struct Timer
+    {
+        double next;
+        std::function<float()> fn;
+    };
+
+    Ent* Check(BpEnt ent)
+    {
+        Ent* e = (Ent*)ent;
+        if (!e || !e->alive)
+        {
+            ++errors;
+            return nullptr;
+        }
+        return e;
+    }
+
+    void Record(Op op, const Ent* e, const char* detail)
+    {
+        ++counts[op];
+        if (logCalls)
+        {
+            log.push_back({ m_Now, op, e ? e->id : 0, detail ? detail : "" });
+        }
+    }
+
+    std::vector<Ent*> m_Ents;
+    std::vector<std::function<void()>> m_NextFrame;
+    std::vector<Timer> m_Timers;
+    std::map<int, BpMenu> m_Menus;
+    double m_Now = 0.0;
+};
+
+#endif //_INCLUDE_BLOCKERPASSES_MOCKBACKEND_H_
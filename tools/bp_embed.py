@@ -0,0 +1,392 @@
+# vim: set sts=2 ts=8 sw=2 tw=99 et ft=python:
+#
+# Compiles curated layout files (layouts/*.ini, bp_data.ini format) into the
+# constant tables Builtin.h reads, so the plugin has a layout for those maps
+# with no file read and no parsing. Run by AMBuilder at build time:
+#
+#   python3 bp_embed.py <out.h> <layout.ini>...
+#
+# Values are read the way BpKv and BpReadItem read them (first key wins,
+# names compare case-insensitively, numbers are strtod/strtol prefixes,
+# path points are strtof), and items LoadDataForMap would skip are left out
+# with a warning, so a built-in layout loads exactly like the same section
+# in bp_data.ini. Check the files with bp_lint first. A file that does not
+# parse, a map defined twice, or a limit below that no longer matches the
+# headers fails the build.
+
+import os
+import re
+import struct
+import sys
+
+# Limits the C++ readers use; check_constants() holds them to the headers on
+# every run, so a change on one side fails the build instead of drifting.
+MAX_LAYERS = 32             # BP_MAX_LAYERS, Layout.h
+POLY_MAX_POINTS = 32        # BP_POLY_MAX_POINTS, Layout.h
+POLY_HEIGHT = 256.0         # BP_POLY_HEIGHT, Layout.h
+POLY_THICK = 16.0           # BP_POLY_THICK, Layout.h
+PREFAB_MAX_EXTENT = 65536.0 # BP_PREFAB_MAX_EXTENT, Prefab.h
+FLT_MAX = struct.unpack('<f', b'\xff\xff\x7f\x7f')[0]
+
+CONSTANTS = [
+  ('Layout.h', 'BP_MAX_LAYERS', MAX_LAYERS),
+  ('Layout.h', 'BP_POLY_MAX_POINTS', POLY_MAX_POINTS),
+  ('Layout.h', 'BP_POLY_HEIGHT', POLY_HEIGHT),
+  ('Layout.h', 'BP_POLY_THICK', POLY_THICK),
+  ('Prefab.h', 'BP_PREFAB_MAX_EXTENT', PREFAB_MAX_EXTENT),
+]
+SOURCE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+
+
+class KvError(Exception):
+  pass
+
+
+class Kv(object):
+  def __init__(self, name, value=None):
+    self.name = name
+    self.value = value      # None for a section
+    self.children = []
+
+  def sections(self):
+    return [c for c in self.children if c.value is None]
+
+  def values(self):
+    return [c for c in self.children if c.value is not None]
+
+  def get(self, key, default=None):
+    key = key.lower()
+    for c in self.children:
+      if c.value is not None and c.name.lower() == key:
+        return c.value
+    return default
+
+
+# KvText.h's lexer: quoted tokens (a backslash is literal, the next " ends
+# one) and bare tokens, // comments, [$CONDITION] after a pair. Quoted
+# tokens are ('s', text), bare ones ('b', text).
+def tokenize(text):
+  i, n = 0, len(text)
+  while i < n:
+    c = text[i]
+    if c in ' \t\r\n':
+      i += 1
+    elif text.startswith('//', i):
+      while i < n and text[i] != '\n':
+        i += 1
+    elif c == '{' or c == '}':
+      yield c
+      i += 1
+    elif c == '[':
+      while i < n and text[i] not in ']\n':
+        i += 1
+      i += 1 if i < n and text[i] == ']' else 0
+    elif c == '"':
+      i += 1
+      j = text.find('"', i)
+      if j < 0:
+        raise KvError('unterminated string')
+      yield ('s', text[i:j])
+      i = j + 1
+    else:
+      j = i
+      while j < n and text[j] not in ' \t\r\n"{}':
+        j += 1
+      yield ('b', text[i:j])
+      i = j
+
+
+def parse(text):
+  if text.startswith('\ufeff'):
+    text = text[1:]
+  top = Kv('')
+  stack = [top]
+  toks = list(tokenize(text))
+  i = 0
+  while i < len(toks):
+    t = toks[i]
+    i += 1
+    if t == '}':
+      if len(stack) == 1:
+        raise KvError("unbalanced '}'")
+      stack.pop()
+      continue
+    if t == '{':
+      raise KvError("'{' without a key")
+    if i >= len(toks):
+      raise KvError('key without a value')
+    v = toks[i]
+    i += 1
+    # #include / #base "file" at the top level: not used by the plugin's files.
+    if len(stack) == 1 and t[0] == 'b' and t[1].lower() in ('#include', '#base'):
+      if not isinstance(v, tuple):
+        raise KvError('directive without a file')
+      continue
+    if v == '{':
+      c = Kv(t[1])
+      stack[-1].children.append(c)
+      stack.append(c)
+    elif v == '}':
+      raise KvError('key without a value')
+    else:
+      stack[-1].children.append(Kv(t[1], v[1]))
+  if len(stack) != 1:
+    raise KvError("missing '}'")
+  sections = top.sections()
+  if not sections:
+    raise KvError('no root section')
+  return sections[0]
+
+
+NUMBER = re.compile(r'\s*([+-]?(?:(?:\d+\.?\d*|\.\d+)(?:[eE][+-]?\d+)?|inf(?:inity)?|nan))', re.I)
+
+
+def to_float(d):
+  try:
+    return struct.unpack('<f', struct.pack('<f', d))[0]
+  except OverflowError:
+    return float('inf') if d > 0 else float('-inf')
+
+
+# GetFloat: strtod, saturated, then cast to float.
+def get_float(kv, key, default):
+  s = kv.get(key)
+  if s is None:
+    return default
+  m = NUMBER.match(s)
+  d = float(m.group(1)) if m else 0.0
+  if d > FLT_MAX:
+    return float('inf')
+  if d < -FLT_MAX:
+    return float('-inf')
+  return to_float(d)
+
+
+# GetInt: strtol (64-bit long, saturating), then cast to int.
+def get_int(kv, key, default):
+  s = kv.get(key)
+  if s is None:
+    return default
+  m = re.match(r'\s*([+-]?\d+)', s)
+  v = int(m.group(1)) if m else 0
+  v = max(-2 ** 63, min(2 ** 63 - 1, v))
+  v &= 0xFFFFFFFF
+  return v - 2 ** 32 if v >= 2 ** 31 else v
+
+
+# BpParsePoints: strtof triples, up to POLY_MAX_POINTS, a partial point
+# dropped. Keeps the text so the compiler rounds it as strtof does.
+def get_points(s):
+  pts = []
+  while len(pts) < POLY_MAX_POINTS:
+    p = []
+    for _ in range(3):
+      m = NUMBER.match(s)
+      if not m:
+        break
+      p.append(m.group(1))
+      s = s[m.end():]
+    if len(p) < 3:
+      break
+    pts.append(p)
+  return pts
+
+
+def finite(*vals):
+  return all(v == v and abs(v) != float('inf') for v in vals)
+
+
+def text_value(t):
+  return to_float(float(t))
+
+
+def c_point(t):
+  if not re.search(r'[.eE]', t):
+    t += '.0'       # "100f" is not a literal
+  return t + 'f'
+
+
+# BpReadItem, plus what BpItemUsable / BpInstanceUsable decide.
+def read_item(k):
+  it = {}
+  it['label'] = k.get('label', '')
+  it['path'] = k.get('path', '')
+  it['pos'] = [get_float(k, a, 0.0) for a in ('px', 'py', 'pz')]
+  it['ang'] = [get_float(k, a, 0.0) for a in ('ax', 'ay', 'az')]
+  it['scale'] = get_float(k, 'sc', 1.0)
+  it['invisible'] = get_int(k, 'iv', 0) != 0
+  it['prefab'] = k.get('prefab', '')
+  it['wall'] = not it['prefab'] and get_int(k, 'wall', 0) != 0
+  it['mp'] = get_int(k, 'mp', -1)
+  it['ly'] = get_int(k, 'ly', -1) & 0xFFFFFFFF
+  it['pos2'] = [0.0, 0.0, 0.0]
+  it['beam'] = [0, 128, 255]
+  it['rainbow'] = False
+  it['wy'] = 0.0
+  it['points'] = []
+  it['ph'] = POLY_HEIGHT
+  it['pw'] = POLY_THICK
+  it['color'] = [255, 255, 255]
+  if it['wall']:
+    it['pos2'] = [get_float(k, a, 0.0) for a in ('p2x', 'p2y', 'p2z')]
+    it['beam'] = [get_int(k, 'br', 0), get_int(k, 'bg', 128), get_int(k, 'bb', 255)]
+    it['rainbow'] = get_int(k, 'brb', 0) != 0
+    it['wy'] = get_float(k, 'wy', 0.0)
+    it['points'] = get_points(k.get('pts', ''))
+    if it['points']:
+      it['ph'] = get_float(k, 'ph', POLY_HEIGHT)
+      it['pw'] = get_float(k, 'pw', POLY_THICK)
+  else:
+    it['color'] = [get_int(k, 'ir', 255), get_int(k, 'ig', 255), get_int(k, 'ib', 255)]
+
+  if it['prefab']:
+    return it if finite(*it['pos']) and all(abs(v) <= PREFAB_MAX_EXTENT for v in it['pos']) and finite(it['ang'][1]) else None
+  if not it['path'] and not it['wall']:
+    return None
+  if not finite(*[text_value(t) for p in it['points'] for t in p]):
+    return None
+  if not finite(*(it['pos'] + it['ang'] + [it['scale']])):
+    return None
+  if it['wall'] and not finite(*(it['pos2'] + [it['wy'], it['ph'], it['pw']])):
+    return None
+  return it
+
+
+def c_string(s):
+  out = []
+  for b in s.encode('utf-8'):
+    c = chr(b)
+    if c in '"\\':
+      out.append('\\' + c)
+    elif 0x20 <= b < 0x7f:
+      out.append(c)
+    else:
+      out.append('\\%03o' % b)     # octal: never runs into the next character
+  return '"' + ''.join(out) + '"'
+
+
+def c_float(v):
+  s = repr(v)
+  if 'e' not in s and '.' not in s:
+    s += '.0'
+  return s + 'f'
+
+
+def c_vec(v):
+  return '{ %s, %s, %s }' % tuple(c_float(x) for x in v)
+
+
+def emit(maps, out):
+  w = out.append
+  w('// Generated by tools/bp_embed.py from layouts/*.ini; do not edit.')
+  w('// Included by Builtin.h.')
+  w('')
+  for n, (name, budget, layers, items) in enumerate(maps):
+    points = [p for it in items for p in it['points']]
+    if points:
+      w('static constexpr float BP_BUILTIN_POINTS_%d[] = {' % n)
+      for p in points:
+        w('    %s, %s, %s,' % tuple(c_point(t) for t in p))
+      w('};')
+    if layers:
+      w('static constexpr const char* BP_BUILTIN_LAYERS_%d[] = { %s };' % (n, ', '.join(c_string(l) for l in layers)))
+    if items:
+      w('static constexpr BpBuiltinItem BP_BUILTIN_ITEMS_%d[] = {' % n)
+      first = 0
+      for it in items:
+        flags = []
+        if it['wall']:
+          flags.append('BP_BUILTIN_WALL')
+        if it['invisible']:
+          flags.append('BP_BUILTIN_INVISIBLE')
+        if it['rainbow']:
+          flags.append('BP_BUILTIN_RAINBOW')
+        w('    { %s, %s, %s, %s, %s, %s, %s, %s, %s, { %d, %d, %d }, { %d, %d, %d }, %d, 0x%08Xu, %s, %d, %d, %s },' % (
+          c_string(it['label']), c_string(it['path']), c_vec(it['pos']), c_vec(it['ang']), c_vec(it['pos2']),
+          c_float(it['scale']), c_float(it['wy']), c_float(it['ph']), c_float(it['pw']),
+          it['beam'][0], it['beam'][1], it['beam'][2], it['color'][0], it['color'][1], it['color'][2],
+          it['mp'], it['ly'], ' | '.join(flags) or '0', first, len(it['points']), c_string(it['prefab'])))
+        first += len(it['points'])
+      w('};')
+    w('')
+
+  if not maps:
+    w('static constexpr const BpBuiltinMap* BP_BUILTIN_MAPS = nullptr;')
+  else:
+    w('static constexpr BpBuiltinMap BP_BUILTIN_MAPS[] = {')
+    for n, (name, budget, layers, items) in enumerate(maps):
+      w('    { %s, %d, %s, %d, %s, %d, %s },' % (
+        c_string(name), budget,
+        'BP_BUILTIN_LAYERS_%d' % n if layers else 'nullptr', len(layers),
+        'BP_BUILTIN_ITEMS_%d' % n if items else 'nullptr', len(items),
+        'BP_BUILTIN_POINTS_%d' % n if any(it['points'] for it in items) else 'nullptr'))
+    w('};')
+  w('static constexpr int BP_BUILTIN_MAP_COUNT = %d;' % len(maps))
+
+
+def check_constants():
+  headers = {}
+  ok = True
+  for header, name, value in CONSTANTS:
+    if header not in headers:
+      with open(os.path.join(SOURCE_DIR, header), 'r', encoding='utf-8') as fp:
+        headers[header] = fp.read()
+    m = re.search(r'static const (?:int|float) %s = ([-+0-9.eE]+)f?;' % name, headers[header])
+    if not m:
+      sys.stderr.write('%s: %s not found; update bp_embed.py\n' % (header, name))
+      ok = False
+    elif float(m.group(1)) != float(value):
+      sys.stderr.write('%s: %s is %s, bp_embed.py has %s\n' % (header, name, m.group(1), value))
+      ok = False
+  return ok
+
+
+def main(argv):
+  if len(argv) < 2:
+    sys.stderr.write('usage: %s <out.h> <layout.ini>...\n' % sys.argv[0])
+    return 2
+  if not check_constants():
+    return 1
+  maps = {}
+  for path in argv[1:]:
+    try:
+      with open(path, 'rb') as fp:
+        root = parse(fp.read().decode('utf-8'))
+    except (KvError, UnicodeDecodeError) as e:
+      sys.stderr.write('%s: %s\n' % (path, e))
+      return 1
+    for sec in root.sections():
+      # Lookups use the normalized, lower-case map name.
+      name = sec.name.lower()
+      if not name or re.search(r'[/\\. |]', name):
+        sys.stderr.write('%s: section "%s" is not a map name\n' % (path, sec.name))
+        return 1
+      if name in maps:
+        sys.stderr.write('%s: map %s is defined twice\n' % (path, name))
+        return 1
+      budget = get_int(sec, 'budget', -1)
+      layers = []
+      for c in sec.children:
+        if c.name.lower() == 'layers':
+          layers = [v.value for v in c.values()][:MAX_LAYERS]
+          break
+      items = []
+      for n, k in enumerate(sec.sections()):
+        if k.name.lower() == 'layers':
+          continue
+        it = read_item(k)
+        if it is None:
+          sys.stderr.write('%s: %s: item %d is skipped, as the plugin would\n' % (path, name, n + 1))
+          continue
+        items.append(it)
+      maps[name] = (name, budget, layers, items)
+
+  out = []
+  emit([maps[k] for k in sorted(maps, key=lambda k: k.encode('utf-8'))], out)     # strcmp order
+  with open(argv[0], 'w') as fp:
+    fp.write('\n'.join(out) + '\n')
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,304 @@
+// Offline linter and optimizer for bp_data files. Every map section of every
+// file given is checked on a pool of worker threads; see LayoutLint.h for
+// the checks and for what the optimizer changes.
+//
+//   g++ -O2 -std=c++17 -pthread -I.. bp_lint.cpp -o bp_lint
+//   ./bp_lint [options] <bp_data.ini>...
+//
+//   --settings FILE     settings.ini to check prop models and prefabs against
+//   --jobs N            worker threads (one per core)
+//   --write             rewrite each file with the optimized layouts
+//   --out FILE          write the optimized layout here (one input only)
+//   --quiet             summaries only, no per-item issues
+//   --json              one JSON object per map instead of the text report
+//
+// Exit status: 0 clean, 1 errors found, 2 a file could not be read or written.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include "../KvText.h"
+#include "LayoutLint.h"
+
+struct LintOptions
+{
+    std::vector<const char*> files;
+    const char* settings = nullptr;
+    const char* out = nullptr;
+    int jobs = 0;
+    bool write = false;
+    bool quiet = false;
+    bool json = false;
+};
+
+struct LintTask
+{
+    size_t file;
+    BpKv* section;
+    BpLintReport report;
+};
+
+static bool LoadSettings(const char* path, std::unordered_set<std::string>& out, std::vector<BpPrefab>& prefabs)
+{
+    BpKv kv("BlockerPasses");
+    std::string err;
+    if (!kv.LoadFromFile(path, &err))
+    {
+        fprintf(stderr, "%s: %s\n", path, err.c_str());
+        return false;
+    }
+    if (BpKv* models = kv.FindKey("models"))
+    {
+        for (BpKv* m = models->GetFirstTrueSubKey(); m; m = m->GetNextTrueSubKey())
+        {
+            const char* path = m->GetString("path", "");
+            if (*path)
+            {
+                out.insert(path);
+            }
+        }
+    }
+    BpReadPrefabs(&kv, prefabs);
+    return true;
+}
+
+static void ReadSection(BpKv* mapKV, std::vector<BpItem>& items)
+{
+    for (BpKv* k = mapKV->GetFirstTrueSubKey(); k; k = k->GetNextTrueSubKey())
+    {
+        if (!strcasecmp(k->GetName(), "layers"))
+        {
+            continue;
+        }
+        BpItem it;
+        BpReadItem(k, it);
+        items.push_back(std::move(it));
+    }
+}
+
+// Item keys replaced by the optimized list; "budget" and "layers" stay.
+static void WriteSection(BpKv* mapKV, const std::vector<BpItem>& items)
+{
+    std::vector<BpKv*> old;
+    for (BpKv* k = mapKV->GetFirstTrueSubKey(); k; k = k->GetNextTrueSubKey())
+    {
+        if (strcasecmp(k->GetName(), "layers"))
+        {
+            old.push_back(k);
+        }
+    }
+    for (BpKv* k : old)
+    {
+        mapKV->RemoveSubKey(k);
+    }
+    for (const BpItem& it : items)
+    {
+        BpKv* k = mapKV->CreateNewKey();
+        k->SetName("item");
+        BpWriteItem(k, it);
+    }
+}
+
+static void JsonString(const std::string& s)
+{
+    putchar('"');
+    for (unsigned char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            printf("\\%c", c);
+        }
+        else if (c < 0x20)
+        {
+            printf("\\u%04x", c);
+        }
+        else
+        {
+            putchar(c);
+        }
+    }
+    putchar('"');
+}
+
+static void Report(const LintOptions& opt, const char* file, const BpLintReport& r)
+{
+    int saved = r.entitiesBefore - r.entitiesAfter;
+    if (opt.json)
+    {
+        printf("{\"file\":");
+        JsonString(file);
+        printf(",\"map\":");
+        JsonString(r.map);
+        printf(",\"items\":%d,\"errors\":%d,\"warnings\":%d,\"notes\":%d,\"dropped\":%d,\"duplicates\":%d,\"merged\":%d,"
+            "\"canonicalized\":%d,\"entities\":{\"before\":%d,\"after\":%d,\"saved\":%d},\"issues\":[",
+            r.items, r.counts[LINT_ERROR], r.counts[LINT_WARN], r.counts[LINT_NOTE], r.dropped, r.duplicates, r.merged,
+            r.canonicalized, r.entitiesBefore, r.entitiesAfter, saved);
+        for (size_t i = 0; i < r.issues.size() && !opt.quiet; ++i)
+        {
+            const BpLintIssue& is = r.issues[i];
+            printf("%s{\"item\":%d,\"level\":\"%s\",\"code\":\"%s\",\"text\":", i ? "," : "", is.item,
+                BP_LINT_LEVEL_NAMES[BP_LINT_CODE_LEVELS[is.code]], BP_LINT_CODE_NAMES[is.code]);
+            JsonString(is.text);
+            putchar('}');
+        }
+        printf("]}\n");
+        return;
+    }
+
+    printf("%s: %s: %d items, %d errors, %d warnings, %d notes\n", file, r.map.c_str(), r.items,
+        r.counts[LINT_ERROR], r.counts[LINT_WARN], r.counts[LINT_NOTE]);
+    if (!opt.quiet)
+    {
+        for (const BpLintIssue& is : r.issues)
+        {
+            if (is.item)
+            {
+                printf("  item %d: %s [%s]: %s\n", is.item, BP_LINT_LEVEL_NAMES[BP_LINT_CODE_LEVELS[is.code]],
+                    BP_LINT_CODE_NAMES[is.code], is.text.c_str());
+            }
+            else
+            {
+                printf("  %s [%s]: %s\n", BP_LINT_LEVEL_NAMES[BP_LINT_CODE_LEVELS[is.code]], BP_LINT_CODE_NAMES[is.code], is.text.c_str());
+            }
+        }
+    }
+    printf("  optimized: %d dropped, %d duplicates, %d walls merged, %d canonicalized; entities %d -> %d (saved %d)\n",
+        r.dropped, r.duplicates, r.merged, r.canonicalized, r.entitiesBefore, r.entitiesAfter, saved);
+}
+
+int main(int argc, char** argv)
+{
+    LintOptions opt;
+    bool bad = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!strcmp(a, "--json"))
+        {
+            opt.json = true;
+        }
+        else if (!strcmp(a, "--quiet"))
+        {
+            opt.quiet = true;
+        }
+        else if (!strcmp(a, "--write"))
+        {
+            opt.write = true;
+        }
+        else if (!strcmp(a, "--out") && more)
+        {
+            opt.out = argv[++i];
+        }
+        else if (!strcmp(a, "--settings") && more)
+        {
+            opt.settings = argv[++i];
+        }
+        else if (!strcmp(a, "--jobs") && more)
+        {
+            opt.jobs = atoi(argv[++i]);
+        }
+        else if (a[0] != '-')
+        {
+            opt.files.push_back(a);
+        }
+        else
+        {
+            bad = true;
+            break;
+        }
+    }
+    if (bad || opt.files.empty() || opt.jobs < 0 || (opt.out && (opt.write || opt.files.size() != 1)))
+    {
+        fprintf(stderr, "usage: %s [--settings FILE] [--jobs N] [--write | --out FILE] [--quiet] [--json] <bp_data.ini>...\n", argv[0]);
+        return 2;
+    }
+
+    std::unordered_set<std::string> models;
+    std::vector<BpPrefab> prefabs;
+    if (opt.settings && !LoadSettings(opt.settings, models, prefabs))
+    {
+        return 2;
+    }
+
+    std::vector<std::unique_ptr<BpKv>> roots;
+    std::vector<LintTask> tasks;
+    for (size_t f = 0; f < opt.files.size(); ++f)
+    {
+        roots.emplace_back(new BpKv("BPData"));
+        std::string err;
+        if (!roots.back()->LoadFromFile(opt.files[f], &err))
+        {
+            fprintf(stderr, "%s: %s\n", opt.files[f], err.c_str());
+            return 2;
+        }
+        for (BpKv* mapKV = roots.back()->GetFirstTrueSubKey(); mapKV; mapKV = mapKV->GetNextTrueSubKey())
+        {
+            LintTask t;
+            t.file = f;
+            t.section = mapKV;
+            t.report.map = mapKV->GetName();
+            tasks.push_back(std::move(t));
+        }
+    }
+
+    // Workers only read the trees; each owns the reports it picks up.
+    std::atomic<size_t> next(0);
+    const std::unordered_set<std::string>* modelList = opt.settings ? &models : nullptr;
+    const std::vector<BpPrefab>* prefabList = opt.settings ? &prefabs : nullptr;
+    auto worker = [&]() {
+        for (size_t i; (i = next++) < tasks.size();)
+        {
+            std::vector<BpItem> items;
+            ReadSection(tasks[i].section, items);
+            BpLintMap(tasks[i].report, items, modelList, prefabList);
+        }
+    };
+    size_t jobs = opt.jobs ? (size_t)opt.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min(jobs, std::max<size_t>(tasks.size(), 1));
+    std::vector<std::thread> pool;
+    for (size_t j = 1; j < jobs; ++j)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& t : pool)
+    {
+        t.join();
+    }
+
+    int errors = 0, warnings = 0, saved = 0;
+    for (const LintTask& t : tasks)
+    {
+        Report(opt, opt.files[t.file], t.report);
+        errors += t.report.counts[LINT_ERROR];
+        warnings += t.report.counts[LINT_WARN];
+        saved += t.report.entitiesBefore - t.report.entitiesAfter;
+    }
+    if (!opt.json)
+    {
+        printf("%zu maps in %zu files: %d errors, %d warnings; optimizing saves %d entities\n",
+            tasks.size(), opt.files.size(), errors, warnings, saved);
+    }
+
+    if (opt.write || opt.out)
+    {
+        for (LintTask& t : tasks)
+        {
+            WriteSection(t.section, t.report.optimized);
+        }
+        for (size_t f = 0; f < opt.files.size(); ++f)
+        {
+            const char* path = opt.out ? opt.out : opt.files[f];
+            if (!roots[f]->SaveToFile(path))
+            {
+                fprintf(stderr, "%s: cannot write\n", path);
+                return 2;
+            }
+        }
+    }
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,518 @@
+// Replays a trace written by mm_bp_record (Record.h) through the plugin's
+// own handlers (Core.h) on MockBackend: rounds, player changes, map changes,
+// and the menu picks, pings and commands the admins made, at the recorded
+// times. Reports, per entry point, the time the server spent and the CPU the
+// replay spent, and engine calls and entity churn recorded against
+// replayed, so two builds can be compared on the same evening.
+//
+//   g++ -O2 -std=c++17 -pthread -I.. bp_replay.cpp ../Core.cpp -o bp_replay
+//   ./bp_replay <trace.bprec> [--json] [--dump]
+//
+//   --json   one JSON object instead of the text report
+//   --dump   print every record as it is replayed
+//
+// A menu record picks its key from the menu the replayed handlers left open
+// on that slot. Every recorded player passes the access check. The trace
+// does not carry crosshair rays or bp_data.ini, so items placed at the
+// crosshair and the layout a map start loads can come out differently: the
+// LAYOUT and ITEM_* records say what the server ended up with, and after
+// each entry point whose result differs the item list is brought back in
+// line and the entry point counted as diverged.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include "MockBackend.h"
+#include "../Core.h"
+
+static_assert((int)RC_COUNT == (int)MockBackend::OP_COUNT, "BpRecCall and MockBackend::Op must stay in step");
+
+static double CpuNow()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct CpuScope
+{
+    double& acc;
+    double t0;
+    explicit CpuScope(double& a) : acc(a), t0(CpuNow()) {}
+    ~CpuScope() { acc += CpuNow() - t0; }
+};
+
+static bool ReadDiskFile(const char* path, std::string& out)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        return false;
+    }
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    {
+        out.append(buf, n);
+    }
+    fclose(f);
+    return true;
+}
+
+// Makes the plugin's item list match the trace's, in the order the recorder
+// diffs them (Record.h SyncItems): deletions at the first index where the
+// lists part, items changed in place, then appends. Only the items touched
+// are respawned.
+static void SyncItems(const std::vector<BPItem>& want)
+{
+    bool wasLive = !g_Live.empty();
+    while (g_Items.size() > want.size())
+    {
+        int p = 0;
+        while (p < (int)want.size() && BpItemSame(g_Items[p], want[p]))
+        {
+            ++p;
+        }
+        Live_Destroy(&p, 1);
+        g_Items.erase(g_Items.begin() + p);
+        for (LiveEnt& le : g_Live)
+        {
+            if (le.index > p)
+            {
+                --le.index;
+            }
+        }
+        Live_Reindex();
+        ++g_ItemsRevision;
+    }
+    for (int i = 0; i < (int)g_Items.size(); ++i)
+    {
+        if (!BpItemSame(g_Items[i], want[i]))
+        {
+            g_Items[i] = want[i];
+            ++g_ItemsRevision;
+            RespawnLive(i);
+        }
+    }
+    while (g_Items.size() < want.size())
+    {
+        g_Items.push_back(want[g_Items.size()]);
+        ++g_ItemsRevision;
+        if (wasLive)
+        {
+            MakeLiveIfMissing((int)g_Items.size() - 1);
+        }
+    }
+}
+
+class Replay
+{
+public:
+    Replay()
+    {
+        g_Backend = &m_Be;
+        g_LogLevel = -1;
+        // GameFrame's post hook on a server.
+        m_Be.onFrameEnd = []() {
+            if (g_bDirtyFlush)
+            {
+                FlushDirty();
+            }
+        };
+    }
+
+    ~Replay()
+    {
+        g_Backend = nullptr;
+    }
+
+    bool Run(const std::string& data, bool dump)
+    {
+        BpRecReader rd;
+        std::string err;
+        if (!rd.Open(data, &err))
+        {
+            fprintf(stderr, "%s\n", err.c_str());
+            return false;
+        }
+        BpRecEvent ev;
+        while (rd.Next(ev))
+        {
+            if (dump)
+            {
+                Dump(ev);
+            }
+            Advance(ev.time);
+            Apply(ev);
+            m_Duration = ev.time;
+        }
+        {
+            CpuScope cs(m_Frames);
+            m_Be.RunFor(m_Be.tickInterval * 2);
+        }
+        if (rd.Bad())
+        {
+            fprintf(stderr, "warning: trace truncated or malformed at byte %zu, replayed what came before\n", rd.Offset());
+            m_bTruncated = true;
+        }
+        return true;
+    }
+
+    void Report(bool json) const
+    {
+        double cpu = m_Frames;
+        double recorded = 0.0;
+        for (int t = 0; t < REC_TYPE_COUNT; ++t)
+        {
+            cpu += m_Cpu[t];
+            recorded += m_RecordedUs[t] / 1000.0;
+        }
+        uint64_t created = g_Counters[CNT_ENT_CREATED];
+        uint64_t removed = g_Counters[CNT_ENT_DESTROYED];
+        if (json)
+        {
+            printf("{\"duration_s\":%.1f,\"truncated\":%s,\"entries\":{", m_Duration, m_bTruncated ? "true" : "false");
+            bool first = true;
+            for (int t = 0; t < REC_TYPE_COUNT; ++t)
+            {
+                if (!IsEntry(t) || !m_Entries[t])
+                {
+                    continue;
+                }
+                printf("%s\"%s\":{\"count\":%llu,\"diverged\":%llu,\"recorded_ms\":%.3f,\"replay_cpu_ms\":%.3f}", first ? "" : ",",
+                    BP_REC_TYPE_NAMES[t], (unsigned long long)m_Entries[t], (unsigned long long)m_Diverged[t], m_RecordedUs[t] / 1000.0,
+                    m_Cpu[t] * 1000.0);
+                first = false;
+            }
+            printf("},\"engine_calls\":{");
+            for (int op = 0; op < RC_COUNT; ++op)
+            {
+                printf("%s\"%s\":{\"recorded\":%llu,\"replayed\":%llu}", op ? "," : "", MockBackend::OpName(op),
+                    (unsigned long long)m_Calls[op], (unsigned long long)m_Be.counts[op]);
+            }
+            printf("},\"entities\":{\"recorded_created\":%llu,\"recorded_removed\":%llu,\"replayed_created\":%llu,\"replayed_removed\":%llu,\"peak_live\":%d},",
+                (unsigned long long)m_Calls[RC_CREATE], (unsigned long long)m_Calls[RC_REMOVE],
+                (unsigned long long)created, (unsigned long long)removed, m_Be.peakLive);
+            printf("\"edits\":{\"set\":%llu,\"add\":%llu,\"delete\":%llu,\"layouts\":%llu},",
+                (unsigned long long)m_Edits[0], (unsigned long long)m_Edits[1], (unsigned long long)m_Edits[2], (unsigned long long)m_Layouts);
+            printf("\"recorded_ms\":%.3f,\"replay_cpu_ms\":%.3f,\"frames_cpu_ms\":%.3f,\"menu_missed\":%llu,\"errors\":%llu}\n",
+                recorded, cpu * 1000.0, m_Frames * 1000.0, (unsigned long long)m_MenuMissed, (unsigned long long)m_Be.errors);
+            return;
+        }
+
+        printf("trace: %.1f s, %llu layouts, %llu item edits (%llu set, %llu added, %llu deleted)%s\n", m_Duration,
+            (unsigned long long)m_Layouts, (unsigned long long)(m_Edits[0] + m_Edits[1] + m_Edits[2]),
+            (unsigned long long)m_Edits[0], (unsigned long long)m_Edits[1], (unsigned long long)m_Edits[2],
+            m_bTruncated ? ", truncated" : "");
+        printf("%-16s %10s %10s %14s %16s\n", "entry point", "count", "diverged", "recorded ms", "replay cpu ms");
+        for (int t = 0; t < REC_TYPE_COUNT; ++t)
+        {
+            if (IsEntry(t) && m_Entries[t])
+            {
+                printf("%-16s %10llu %10llu %14.3f %16.3f\n", BP_REC_TYPE_NAMES[t], (unsigned long long)m_Entries[t],
+                    (unsigned long long)m_Diverged[t], m_RecordedUs[t] / 1000.0, m_Cpu[t] * 1000.0);
+            }
+        }
+        printf("%-16s %10s %10s %14.3f %16.3f\n", "total", "", "", recorded, cpu * 1000.0);
+        printf("(replay frames, timers and rainbow: %.3f ms)\n", m_Frames * 1000.0);
+        printf("%-16s %14s %14s\n", "engine call", "recorded", "replayed");
+        for (int op = 0; op < RC_COUNT; ++op)
+        {
+            printf("%-16s %14llu %14llu\n", MockBackend::OpName(op), (unsigned long long)m_Calls[op], (unsigned long long)m_Be.counts[op]);
+        }
+        printf("entities: recorded %llu created / %llu removed, replayed %llu / %llu, peak live %d; %llu calls on dead entities\n",
+            (unsigned long long)m_Calls[RC_CREATE], (unsigned long long)m_Calls[RC_REMOVE],
+            (unsigned long long)created, (unsigned long long)removed, m_Be.peakLive, (unsigned long long)m_Be.errors);
+        if (m_MenuMissed)
+        {
+            printf("%llu menu picks found no such menu or item open on their slot\n", (unsigned long long)m_MenuMissed);
+        }
+    }
+
+private:
+    static bool IsEntry(int t)
+    {
+        return t >= REC_MAP_START && t < REC_DONE;
+    }
+
+    void Advance(double t)
+    {
+        if (t <= m_Be.Time())
+        {
+            return;
+        }
+        CpuScope cs(m_Frames);
+        m_Be.RunFor(t - m_Be.Time());
+    }
+
+    void Apply(const BpRecEvent& ev)
+    {
+        if (IsEntry(ev.type))
+        {
+            m_Current = ev.type;
+            ++m_Entries[ev.type];
+        }
+        double& cpu = m_Cpu[m_Current];
+        int items = (int)m_Want.size();
+        switch (ev.type)
+        {
+            case REC_MAP_START:
+            {
+                m_Be.mapName = ev.s1;
+                CpuScope cs(cpu);
+                OnMapStart(ev.s1.c_str());
+                break;
+            }
+            case REC_MAP_END:
+            {
+                CpuScope cs(cpu);
+                OnMapEnd();
+                break;
+            }
+            case REC_ROUND_PREPARE:
+            {
+                CpuScope cs(cpu);
+                OnRoundPrepare("round_end");
+                break;
+            }
+            case REC_ROUND_START:
+            {
+                CpuScope cs(cpu);
+                OnRoundStart();
+                break;
+            }
+            case REC_PLAYER_EVENT:
+            {
+                CpuScope cs(cpu);
+                PlayerCountChanged(ev.slot, (int)ev.a);
+                break;
+            }
+            case REC_PLAYER_PING:
+            {
+                CpuScope cs(cpu);
+                OnPlayerPing(ev.slot, ev.v);
+                break;
+            }
+            case REC_MENU:
+            {
+                const BpMenu* open = m_Be.OpenMenu(ev.slot);
+                CpuScope cs(cpu);
+                if (!open || open->name != ev.s1 || !m_Be.Select(ev.slot, ev.s2.c_str()))
+                {
+                    ++m_MenuMissed;
+                }
+                break;
+            }
+            case REC_COMMAND:
+            {
+                CpuScope cs(cpu);
+                size_t cmdLen = ev.s1.find(' ');
+                if (!ev.s1.compare(0, cmdLen, g_ConCmdProfile))
+                {
+                    OnProfileCmd(ev.slot, ev.s1.c_str());
+                }
+                else
+                {
+                    OnBpCmd(ev.slot, ev.s1.c_str());
+                }
+                break;
+            }
+            case REC_DONE:
+            {
+                {
+                    CpuScope cs(cpu);
+                    Sync();
+                }
+                m_RecordedUs[m_Current] += (double)ev.a;
+                m_Current = 0;
+                break;
+            }
+            case REC_PLAYER:
+                if (ev.slot >= 0 && ev.slot < 64)
+                {
+                    MockBackend::Player& p = m_Be.players[ev.slot];
+                    p.connected = (ev.a & RPF_CONNECTED) != 0;
+                    p.inGame = (ev.a & RPF_IN_GAME) != 0;
+                    p.fake = (ev.a & RPF_FAKE) != 0;
+                    p.team = (int)ev.b;
+                    p.admin = true;
+                }
+                break;
+            case REC_CONFIG:
+                g_MinPlayersToOpen = (int)ev.a;
+                g_MapBudget = ev.b > 0 ? (int)ev.b : 0;
+                if (ev.c >= 0 && ev.c < (int)g_LayerNames.size())
+                {
+                    g_ActiveLayer = (int)ev.c;
+                }
+                g_bIgnoreSpectators = ev.d != 0;
+                break;
+            case REC_LAYOUT:
+                ++m_Layouts;
+                m_Map = ev.s1;
+                m_Want = ev.items;
+                // The layout written when recording starts has no entry point.
+                if (!m_Current)
+                {
+                    Sync();
+                }
+                break;
+            case REC_ITEM_SET:
+                if (ev.a >= 0 && ev.a < items)
+                {
+                    ++m_Edits[0];
+                    m_Want[ev.a] = ev.items[0];
+                    }
+                break;
+            case REC_ITEM_ADD:
+                ++m_Edits[1];
+                m_Want.push_back(ev.items[0]);
+                break;
+            case REC_ITEM_DEL:
+                if (ev.a >= 0 && ev.a < items)
+                {
+                    ++m_Edits[2];
+                    m_Want.erase(m_Want.begin() + ev.a);
+                    }
+                break;
+            case REC_CALL:
+                if (ev.a >= 0 && ev.a < RC_COUNT)
+                {
+                    ++m_Calls[ev.a];
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Holds the plugin to the layout the trace says the last handler left
+    // behind.
+    void Sync()
+    {
+        bool same = g_Items.size() == m_Want.size() && (m_Map.empty() || g_CurrentMap == m_Map);
+        for (size_t i = 0; same && i < m_Want.size(); ++i)
+        {
+            same = BpItemSame(g_Items[i], m_Want[i]);
+        }
+        if (same)
+        {
+            return;
+        }
+        ++m_Diverged[m_Current];
+        if (!m_Map.empty())
+        {
+            g_CurrentMap = m_Map;
+        }
+        SyncItems(m_Want);
+    }
+
+    void Dump(const BpRecEvent& ev) const
+    {
+        printf("%12.6f %-14s", ev.time, ev.type < REC_TYPE_COUNT ? BP_REC_TYPE_NAMES[ev.type] : "?");
+        switch (ev.type)
+        {
+            case REC_MAP_START:
+                printf(" %s", ev.s1.c_str());
+                break;
+            case REC_PLAYER_PING:
+                printf(" slot %d at %.1f %.1f %.1f", ev.slot, ev.v.x, ev.v.y, ev.v.z);
+                break;
+            case REC_PLAYER_EVENT:
+                printf(" slot %d kind %lld", ev.slot, (long long)ev.a);
+                break;
+            case REC_MENU:
+                printf(" slot %d %s/%s item %lld", ev.slot, ev.s1.c_str(), ev.s2.c_str(), (long long)ev.a);
+                break;
+            case REC_COMMAND:
+                printf(" slot %d \"%s\"", ev.slot, ev.s1.c_str());
+                break;
+            case REC_DONE:
+                printf(" %lld us", (long long)ev.a);
+                break;
+            case REC_PLAYER:
+                printf(" slot %d flags %lld team %lld", ev.slot, (long long)ev.a, (long long)ev.b);
+                break;
+            case REC_CONFIG:
+                printf(" min_players %lld budget %lld layer %lld ignore_spec %lld", (long long)ev.a, (long long)ev.b, (long long)ev.c, (long long)ev.d);
+                break;
+            case REC_LAYOUT:
+                printf(" %s, %zu items", ev.s1.c_str(), ev.items.size());
+                break;
+            case REC_ITEM_SET:
+            case REC_ITEM_DEL:
+                printf(" #%lld", (long long)ev.a);
+                break;
+            case REC_CALL:
+                printf(" %s ent %lld %s", MockBackend::OpName((int)ev.a), (long long)ev.b, ev.s1.c_str());
+                break;
+            default:
+                break;
+        }
+        printf("\n");
+    }
+
+    MockBackend m_Be;
+    std::string m_Map;
+    std::vector<BPItem> m_Want;         // the trace's item list
+    int m_Current = 0;
+    uint64_t m_Entries[REC_TYPE_COUNT] = {};
+    uint64_t m_Diverged[REC_TYPE_COUNT] = {};
+    uint64_t m_MenuMissed = 0;
+    double m_RecordedUs[REC_TYPE_COUNT] = {};
+    double m_Cpu[REC_TYPE_COUNT] = {};
+    double m_Frames = 0.0;
+    uint64_t m_Calls[RC_COUNT] = {};
+    uint64_t m_Edits[3] = {};
+    uint64_t m_Layouts = 0;
+    double m_Duration = 0.0;
+    bool m_bTruncated = false;
+};
+
+int main(int argc, char** argv)
+{
+    const char* path = nullptr;
+    bool json = false;
+    bool dump = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--json"))
+        {
+            json = true;
+        }
+        else if (!strcmp(argv[i], "--dump"))
+        {
+            dump = true;
+        }
+        else if (!path && argv[i][0] != '-')
+        {
+            path = argv[i];
+        }
+        else
+        {
+            path = nullptr;
+            break;
+        }
+    }
+    if (!path)
+    {
+        fprintf(stderr, "usage: %s <trace.bprec> [--json] [--dump]\n", argv[0]);
+        return 1;
+    }
+
+    std::string data;
+    if (!ReadDiskFile(path, data))
+    {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return 1;
+    }
+    Replay replay;
+    if (!replay.Run(data, dump))
+    {
+        return 1;
+    }
+    replay.Report(json);
+    return 0;
+}
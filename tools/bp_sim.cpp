@@ -0,0 +1,570 @@
+// Headless round simulator. Runs the plugin's own logic (Core.h) on one map
+// against MockBackend: rounds, player joins and leaves, and admin edits made
+// through the real menus and pings, then reports entity churn,
+// state-change traffic and CPU time spent in the plugin.
+//
+//   g++ -O2 -std=c++17 -pthread -I.. bp_sim.cpp ../Core.cpp -o bp_sim
+//   ./bp_sim <bp_data.ini> <map> [options]
+//
+//   --settings FILE     settings.ini to load; the built-in defaults otherwise
+//   --rounds N          rounds to play (100)
+//   --round-time S      seconds per round (60)
+//   --players A-B       human player range (2-20)
+//   --churn N           joins/leaves per round (4)
+//   --edits N           admin edits per round (0)
+//   --min-players N     override settings.ini min_players_to_open
+//   --budget N          entity budget; default is the map's "budget" key
+//   --seed N            RNG seed (1)
+//   --verbose           the plugin's console and log output on stderr
+//   --json              one JSON object instead of the text report
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <random>
+#include <chrono>
+#include "MockBackend.h"
+#include "../Core.h"
+
+struct SimOptions
+{
+    const char* file = nullptr;
+    const char* map = nullptr;
+    const char* settings = nullptr;
+    int rounds = 100;
+    double roundTime = 60.0;
+    int minHumans = 2;
+    int maxHumans = 20;
+    int churn = 4;
+    int edits = 0;
+    int minPlayers = -1;
+    int budget = -1;
+    unsigned seed = 1;
+    bool verbose = false;
+    bool json = false;
+};
+
+enum SimPhase
+{
+    SP_ROUND_START = 0,
+    SP_PLAYERS,
+    SP_EDITS,
+    SP_FRAMES,
+    SP_COUNT
+};
+
+static const char* g_SimPhaseNames[SP_COUNT] = { "round_start", "players", "edits", "frames" };
+
+// Edits are made from this slot, which joins first and never leaves.
+static const int ADMIN_SLOT = 0;
+
+static double CpuNow()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct CpuScope
+{
+    double& acc;
+    double t0;
+    explicit CpuScope(double& a) : acc(a), t0(CpuNow()) {}
+    ~CpuScope() { acc += CpuNow() - t0; }
+};
+
+static bool ReadDiskFile(const char* path, std::string& out)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+    {
+        return false;
+    }
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        out.append(buf, n);
+    }
+    fclose(fp);
+    return true;
+}
+
+static void StderrOut(BpColor, const char* text)
+{
+    fputs(text, stderr);
+}
+
+class Simulation
+{
+public:
+    Simulation(const SimOptions& opt) : m_Opt(opt), m_Rng(opt.seed) {}
+
+    ~Simulation()
+    {
+        Log_Stop();
+        g_Backend = nullptr;
+    }
+
+    bool Load()
+    {
+        std::string& data = m_Be.files["addons/data/bp_data.ini"];
+        if (!ReadDiskFile(m_Opt.file, data))
+        {
+            fprintf(stderr, "%s: cannot read\n", m_Opt.file);
+            return false;
+        }
+        if (m_Opt.settings && !ReadDiskFile(m_Opt.settings, m_Be.files["addons/configs/BlockerPasses/settings.ini"]))
+        {
+            fprintf(stderr, "%s: cannot read\n", m_Opt.settings);
+            return false;
+        }
+
+        g_Backend = &m_Be;
+        if (m_Opt.verbose)
+        {
+            g_ConsoleOut = StderrOut;
+            Log_Start();
+        }
+        // GameFrame's post hook on a server.
+        m_Be.onFrameEnd = []() {
+            if (g_bDirtyFlush)
+            {
+                FlushDirty();
+            }
+        };
+        m_Be.mapName = m_Opt.map;
+        OnMapStart(m_Opt.map);
+        if (!m_Opt.verbose)
+        {
+            g_LogLevel = -1;
+        }
+        if (g_Items.empty() && m_Opt.edits == 0)
+        {
+            fprintf(stderr, "%s: no items for map %s\n", m_Opt.file, g_CurrentMap.c_str());
+            return false;
+        }
+        if (m_Opt.minPlayers >= 0)
+        {
+            g_MinPlayersToOpen = m_Opt.minPlayers;
+        }
+        if (m_Opt.budget >= 0)
+        {
+            g_MapBudget = m_Opt.budget;
+        }
+        m_InitialItems = (int)g_Items.size();
+        return true;
+    }
+
+    void Run()
+    {
+        if (m_Opt.edits > 0)
+        {
+            MockBackend::Player& admin = m_Be.players[ADMIN_SLOT];
+            admin.admin = true;
+            admin.steamID = 76561197960265728ull;
+            Join();
+        }
+        int start = Uniform(m_Opt.minHumans, m_Opt.maxHumans);
+        while (Humans() < start)
+        {
+            Join();
+        }
+        RunFrames(m_Be.tickInterval * 2);
+        m_Be.ResetCounts();
+        for (uint64_t& c : g_Counters)
+        {
+            c = 0;
+        }
+
+        double wall0 = BpClock();
+        for (int r = 0; r < m_Opt.rounds; ++r)
+        {
+            {
+                CpuScope cs(m_Cpu[SP_ROUND_START]);
+                OnRoundPrepare("round_end");
+                OnRoundStart();
+            }
+            int events = m_Opt.churn + m_Opt.edits;
+            double step = m_Opt.roundTime / (events + 1);
+            int churnLeft = m_Opt.churn;
+            int editsLeft = m_Opt.edits;
+            for (int e = 0; e < events; ++e)
+            {
+                RunFrames(step);
+                bool churn = editsLeft == 0 || (churnLeft > 0 && Uniform(0, churnLeft + editsLeft - 1) < churnLeft);
+                if (churn)
+                {
+                    --churnLeft;
+                    CpuScope cs(m_Cpu[SP_PLAYERS]);
+                    PlayerEvent();
+                }
+                else
+                {
+                    --editsLeft;
+                    CpuScope cs(m_Cpu[SP_EDITS]);
+                    AdminEdit();
+                }
+            }
+            RunFrames(step);
+            int inUse = EntitiesInUse();
+            if (inUse > m_PeakInUse)
+            {
+                m_PeakInUse = inUse;
+            }
+        }
+        OnMapEnd();
+        RunFrames(m_Be.tickInterval * 2);
+        m_Wall = BpClock() - wall0;
+    }
+
+    void Report() const
+    {
+        uint64_t created = g_Counters[CNT_ENT_CREATED];
+        uint64_t removed = g_Counters[CNT_ENT_DESTROYED];
+        uint64_t issued = g_Counters[CNT_STATE_CHANGED];
+        uint64_t coalesced = g_Counters[CNT_STATE_COALESCED];
+        uint64_t marked = issued + coalesced;
+        double cpu = 0.0;
+        for (double c : m_Cpu)
+        {
+            cpu += c;
+        }
+        double coalescedPct = marked ? 100.0 * (double)coalesced / (double)marked : 0.0;
+        if (m_Opt.json)
+        {
+            printf("{\"map\":\"%s\",\"items\":%d,\"rounds\":%d,\"round_time\":%.1f,\"edits\":%d,\"churn\":%d,\"budget\":%d,",
+                g_CurrentMap.c_str(), m_InitialItems, m_Opt.rounds, m_Opt.roundTime, m_Opt.edits, m_Opt.churn, EntityBudget());
+            printf("\"entities\":{\"created\":%llu,\"removed\":%llu,\"peak_live\":%d,\"peak_in_use\":%d,\"per_round\":%.1f},",
+                (unsigned long long)created, (unsigned long long)removed, m_Be.peakLive, m_PeakInUse,
+                (double)created / (m_Opt.rounds ? m_Opt.rounds : 1));
+            printf("\"state\":{\"marked\":%llu,\"issued\":%llu,\"coalesced\":%llu},",
+                (unsigned long long)marked, (unsigned long long)issued, (unsigned long long)coalesced);
+            printf("\"engine_calls\":{");
+            for (int op = 0; op < MockBackend::OP_COUNT; ++op)
+            {
+                printf("%s\"%s\":%llu", op ? "," : "", MockBackend::OpName(op), (unsigned long long)m_Be.counts[op]);
+            }
+            printf("},\"cpu_ms\":{\"total\":%.3f,\"per_round\":%.4f", cpu * 1000.0, cpu * 1000.0 / (m_Opt.rounds ? m_Opt.rounds : 1));
+            for (int p = 0; p < SP_COUNT; ++p)
+            {
+                printf(",\"%s\":%.3f", g_SimPhaseNames[p], m_Cpu[p] * 1000.0);
+            }
+            printf("},\"wall_ms\":%.3f,\"edits_missed\":%d,\"errors\":%llu}\n", m_Wall * 1000.0, m_EditsMissed,
+                (unsigned long long)m_Be.errors);
+            return;
+        }
+
+        printf("map %s: %d items, %d rounds of %.0f s, %d joins/leaves and %d edits per round, budget %d\n",
+            g_CurrentMap.c_str(), m_InitialItems, m_Opt.rounds, m_Opt.roundTime, m_Opt.churn, m_Opt.edits, EntityBudget());
+        printf("entities:      created %llu, removed %llu (%.1f per round), peak live %d, peak in use %d\n",
+            (unsigned long long)created, (unsigned long long)removed, (double)created / (m_Opt.rounds ? m_Opt.rounds : 1),
+            m_Be.peakLive, m_PeakInUse);
+        printf("state changes: marked %llu, issued %llu, coalesced %llu (%.1f%%)\n",
+            (unsigned long long)marked, (unsigned long long)issued, (unsigned long long)coalesced, coalescedPct);
+        printf("engine calls: ");
+        for (int op = 0; op < MockBackend::OP_COUNT; ++op)
+        {
+            printf(" %s=%llu", MockBackend::OpName(op), (unsigned long long)m_Be.counts[op]);
+        }
+        printf("\ncpu:           %.3f ms total, %.4f ms per round (", cpu * 1000.0, cpu * 1000.0 / (m_Opt.rounds ? m_Opt.rounds : 1));
+        for (int p = 0; p < SP_COUNT; ++p)
+        {
+            printf("%s%s %.3f ms", p ? ", " : "", g_SimPhaseNames[p], m_Cpu[p] * 1000.0);
+        }
+        printf(")\nwall:          %.3f ms; %llu calls on dead entities; %d edits found no menu item\n", m_Wall * 1000.0,
+            (unsigned long long)m_Be.errors, m_EditsMissed);
+        for (const auto& kv : m_Be.stateByField)
+        {
+            printf("  %-52s %llu\n", kv.first.c_str(), (unsigned long long)kv.second);
+        }
+    }
+
+private:
+    int Uniform(int lo, int hi)
+    {
+        if (hi <= lo)
+        {
+            return lo;
+        }
+        return std::uniform_int_distribution<int>(lo, hi)(m_Rng);
+    }
+
+    float UniformF(float lo, float hi)
+    {
+        return std::uniform_real_distribution<float>(lo, hi)(m_Rng);
+    }
+
+    void RunFrames(double seconds)
+    {
+        CpuScope cs(m_Cpu[SP_FRAMES]);
+        m_Be.RunFor(seconds);
+    }
+
+    int Humans() const
+    {
+        int n = 0;
+        for (const MockBackend::Player& p : m_Be.players)
+        {
+            n += p.connected ? 1 : 0;
+        }
+        return n;
+    }
+
+    // The plugin runs PlayerCountChanged from a task a frame after the event;
+    // calling it here keeps its cost in the "players" phase.
+    void Join()
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            MockBackend::Player& p = m_Be.players[i];
+            if (!p.connected)
+            {
+                p.connected = true;
+                p.inGame = true;
+                p.team = 2 + (i & 1);
+                PlayerCountChanged(i, RPE_CONNECT_FULL);
+                return;
+            }
+        }
+    }
+
+    void Leave()
+    {
+        int n = Humans() - (m_Opt.edits > 0 ? 1 : 0);
+        if (n <= 0)
+        {
+            return;
+        }
+        int pick = Uniform(0, n - 1);
+        for (int i = 0; i < 64; ++i)
+        {
+            MockBackend::Player& p = m_Be.players[i];
+            if (p.connected && (i != ADMIN_SLOT || m_Opt.edits == 0) && pick-- == 0)
+            {
+                p = MockBackend::Player();
+                PlayerCountChanged(i, RPE_DISCONNECT);
+                return;
+            }
+        }
+    }
+
+    void PlayerEvent()
+    {
+        int n = Humans();
+        bool join = n <= m_Opt.minHumans || (n < m_Opt.maxHumans && Uniform(0, 1) == 0);
+        if (join)
+        {
+            Join();
+        }
+        else
+        {
+            Leave();
+        }
+    }
+
+    // One menu pick; an edit whose item is missing from the menu is counted
+    // rather than silently dropped, so a renamed key shows up in the report.
+    bool Pick(const char* key)
+    {
+        if (m_Be.Select(ADMIN_SLOT, key))
+        {
+            return true;
+        }
+        ++m_EditsMissed;
+        return false;
+    }
+
+    // A random enabled item of the open menu whose key starts with 'prefix'.
+    bool PickAny(const char* prefix)
+    {
+        const BpMenu* open = m_Be.OpenMenu(ADMIN_SLOT);
+        std::vector<std::string> keys;
+        for (size_t i = 0; open && i < open->items.size(); ++i)
+        {
+            if (open->items[i].enabled && !open->items[i].key.compare(0, strlen(prefix), prefix))
+            {
+                keys.push_back(open->items[i].key);
+            }
+        }
+        if (keys.empty())
+        {
+            ++m_EditsMissed;
+            return false;
+        }
+        return Pick(keys[Uniform(0, (int)keys.size() - 1)].c_str());
+    }
+
+    void AimAt(const BpVec& p)
+    {
+        MockBackend::Player& admin = m_Be.players[ADMIN_SLOT];
+        admin.aim = p;
+        admin.eye = p + BpVec(-128.0f, 0.0f, 64.0f);
+    }
+
+    void AdminEdit()
+    {
+        int n = (int)g_Items.size();
+        int op = n ? Uniform(0, 3) : 2;
+        if (op == 3 && n <= m_InitialItems / 2)
+        {
+            op = 2;
+        }
+        if (op == 2 && n >= m_InitialItems * 2 + 1)
+        {
+            op = 3;
+        }
+        int index = n ? Uniform(0, n - 1) : 0;
+        if (op != 2)
+        {
+            // What "edit" in the main menu opens for the item under the crosshair.
+            AimAt(g_Items[index].pos);
+            OpenItemMenu(ADMIN_SLOT, index);
+        }
+        static const char* moves[] = { "x;10", "x;-10", "y;10", "y;-10", "z;10", "z;-10" };
+        switch (op)
+        {
+            case 0:
+                if (Pick(g_Items[index].isWall ? "wallmove" : "move"))
+                {
+                    Pick(moves[Uniform(0, 5)]);
+                }
+                break;
+            case 1:
+                if (Pick(g_Items[index].isWall ? "beamcolor" : "itemcolor"))
+                {
+                    PickAny("c:");
+                }
+                break;
+            case 2:
+            {
+                BpVec base = n ? g_Items[index].pos : BpVec();
+                BpVec at = base + BpVec(UniformF(-256, 256), UniformF(-256, 256), 0);
+                AimAt(at);
+                OnBpCmd(ADMIN_SLOT, g_ConCmdBp.c_str());
+                bool wall = (n ? g_Items[index].isWall : true) || g_ModelDefs.empty();
+                if (!wall)
+                {
+                    if (Pick("place"))
+                    {
+                        PickAny("m:");
+                    }
+                }
+                else if (Pick("wall"))
+                {
+                    OnPlayerPing(ADMIN_SLOT, at);
+                    OnPlayerPing(ADMIN_SLOT, at + BpVec(UniformF(16, 128), UniformF(4, 16), 128));
+                }
+                break;
+            }
+            case 3:
+                Pick("delete");
+                break;
+        }
+        m_Be.CloseMenu(ADMIN_SLOT);
+    }
+
+    SimOptions m_Opt;
+    MockBackend m_Be;
+    std::mt19937 m_Rng;
+    int m_InitialItems = 0;
+    int m_PeakInUse = 0;
+    int m_EditsMissed = 0;
+    double m_Cpu[SP_COUNT] = {};
+    double m_Wall = 0.0;
+};
+
+static bool ParseRange(const char* s, int& lo, int& hi)
+{
+    return sscanf(s, "%d-%d", &lo, &hi) == 2 && lo >= 0 && hi >= lo && hi <= 64;
+}
+
+int main(int argc, char** argv)
+{
+    SimOptions opt;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* a = argv[i];
+        bool more = i + 1 < argc;
+        if (!strcmp(a, "--json"))
+        {
+            opt.json = true;
+        }
+        else if (!strcmp(a, "--verbose"))
+        {
+            opt.verbose = true;
+        }
+        else if (!strcmp(a, "--settings") && more)
+        {
+            opt.settings = argv[++i];
+        }
+        else if (!strcmp(a, "--rounds") && more)
+        {
+            opt.rounds = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--round-time") && more)
+        {
+            opt.roundTime = atof(argv[++i]);
+        }
+        else if (!strcmp(a, "--players") && more)
+        {
+            if (!ParseRange(argv[++i], opt.minHumans, opt.maxHumans))
+            {
+                fprintf(stderr, "bad --players range: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(a, "--churn") && more)
+        {
+            opt.churn = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--edits") && more)
+        {
+            opt.edits = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--min-players") && more)
+        {
+            opt.minPlayers = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--budget") && more)
+        {
+            opt.budget = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--seed") && more)
+        {
+            opt.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (a[0] != '-' && positional == 0)
+        {
+            opt.file = a;
+            ++positional;
+        }
+        else if (a[0] != '-' && positional == 1)
+        {
+            opt.map = a;
+            ++positional;
+        }
+        else
+        {
+            positional = -1;
+            break;
+        }
+    }
+    if (positional != 2 || opt.rounds <= 0 || opt.roundTime <= 0.0 || opt.churn < 0 || opt.edits < 0)
+    {
+        fprintf(stderr, "usage: %s <bp_data.ini> <map> [--settings FILE] [--rounds N] [--round-time S] [--players A-B]\n"
+            "       [--churn N] [--edits N] [--min-players N] [--budget N] [--seed N] [--verbose] [--json]\n", argv[0]);
+        return 1;
+    }
+
+    Simulation sim(opt);
+    if (!sim.Load())
+    {
+        return 1;
+    }
+    sim.Run();
+    sim.Report();
+    return 0;
+}